@@ -6,131 +6,391 @@
  * MIT License
  */
 
+#define _POSIX_C_SOURCE 199309L
+
 #include "hsm4c.h"
+#include "hsm4c_timer.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef HSM4C_TRACE
+#include "hsm4c_trace.h"
+#define TRACE(kind, sm, event, from, to, result) sc_trace_record_(kind, sm, event, from, to, result)
+#else
+#define TRACE(kind, sm, event, from, to, result) ((void)0)
+#endif
+
+#ifdef HSM4C_STATS
+#include "hsm4c_stats.h"
+#define STATS_START(sm, start) uint64_t const start = sc_stats_now_((sm)->chart->_stats)
+#define STATS(what, sm, ...) sc_stats_##what##_((sm)->chart->_stats, __VA_ARGS__)
+#define STATS_ACTIVE(sm, entered) stats_active(sm, entered)
+#else
+#define STATS_START(sm, start)
+#define STATS(what, sm, ...) ((void)0)
+#define STATS_ACTIVE(sm, entered) ((void)0)
+#endif
 
 /* -------- Private -------- */
 
-/** \brief Find common ancestor of two states. Must be same tree. */
-static State *fca(State const *const left, State const *const right) {
-  for (State const *_left = left; _left->config->parent != NULL; _left = _left->config->parent) {
-    for (State const *_right = right; _right->config->parent != NULL;
-         _right = _right->config->parent) {
-      if (_left->config->parent == _right->config->parent) {
-        return _left->config->parent;
-      }
+/** \brief No transition found. */
+#define NO_TRANSITION UINT16_MAX
+
+/** \brief Index of a state in the chart. */
+static StateId state_id(Chart const *chart, State const *s) { return (StateId)(s - chart->states); }
+
+/** \brief Find lowest common proper ancestor of two states in O(depth). Must be same tree. */
+static StateId fca(Chart const *const chart, StateId left, StateId right) {
+  StateId const *const parent = chart->_parent;
+  uint16_t const *const depth = chart->_depth;
+
+  left = parent[left];
+  right = parent[right];
+  if (left == SC_NO_STATE || right == SC_NO_STATE) {
+    return state_id(chart, chart->root);
+  }
+  for (; depth[left] > depth[right]; left = parent[left]) {
+  }
+  for (; depth[right] > depth[left]; right = parent[right]) {
+  }
+  for (; left != right; left = parent[left], right = parent[right]) {
+  }
+  return left;
+}
+
+/** \brief Child of `ancestor` on the branch of `s`. */
+static StateId child_towards(Chart const *const chart, StateId ancestor, StateId s) {
+  for (; chart->_parent[s] != ancestor; s = chart->_parent[s]) {
+  }
+  return s;
+}
+
+/** \brief Last active child of a state. SC_NO_STATE if none or not recorded. */
+static StateId history_of(Machine const *const sm, StateId id) {
+  StateId const slot = sm->chart->_history_slot[id];
+  return slot == SC_NO_STATE ? SC_NO_STATE : sm->_slots[slot];
+}
+
+/** \brief Record active child of a state if the chart needs it for history. */
+static void set_history(Machine *const sm, StateId id, StateId child) {
+  StateId const slot = sm->chart->_history_slot[id];
+  if (slot != SC_NO_STATE) {
+    sm->_slots[slot] = child;
+  }
+}
+
+/** \brief Set the active leaf and the depth indexed path of its ancestors. */
+static void set_leaf(Machine *const sm, StateId leaf) {
+  Chart const *const chart = sm->chart;
+  StateId *const path = &sm->_slots[chart->_path_slot];
+  sm->_leaf = leaf;
+  for (StateId s = leaf; s != SC_NO_STATE; s = chart->_parent[s]) {
+    path[chart->_depth[s]] = s;
+  }
+}
+
+/** \brief Arm the timers of a state which got entered. */
+static void arm_timers(Machine *const sm, StateId id) {
+  Chart const *const chart = sm->chart;
+  if (sm->_wheel && chart->num_timers) {
+    for (uint16_t k = chart->_timer_begin[id]; k != chart->_timer_begin[id + 1]; ++k) {
+      Transition const *t = chart->_transitions[chart->_timer_transition[k]];
+      sc_timer_arm_(sm->_wheel, &sm->_timers[k], t->after);
     }
   }
-  return NULL;
 }
 
-/** \brief Walk up a branch and call exit_fn(). end_ancestor MUST be a valid ancestor or NULL. */
-static void walk_up_exit(State const *const root, State const *start, State const *end_ancestor) {
-  for (; start != end_ancestor; start = start->config->parent) {
-    if (start->config->exit_fn) {
-      start->config->exit_fn(start);
+/** \brief Cancel the timers of a state which gets exited. */
+static void cancel_timers(Machine *const sm, StateId id) {
+  Chart const *const chart = sm->chart;
+  if (sm->_wheel && chart->num_timers) {
+    for (uint16_t k = chart->_timer_begin[id]; k != chart->_timer_begin[id + 1]; ++k) {
+      sc_timer_cancel_(sm->_wheel, &sm->_timers[k]);
     }
   }
 }
 
-/** \brief Walk up a branch and set active state to match the branch. end_ancestor MUST be a valid
- * ancestor or NULL. */
-static void walk_up_set_active_state(State *start, State const *end_ancestor) {
-  for (; start != end_ancestor; start = start->config->parent) {
-    start->config->parent->_active = start;
+/** \brief Enter a state: call its entry_fn(). */
+static void call_entry(Machine *const sm, StateId id) {
+  Chart const *const chart = sm->chart;
+  uint16_t const fn = chart->_compact_states[id].entry;
+  STATS_START(sm, start);
+  TRACE(SC_TRACE_ENTRY, sm, SC_NO_EVENT, id, SC_NO_STATE, false);
+  if (fn) {
+    ((entry_fn)chart->_functions[fn])(sm, &chart->states[id]);
+  }
+  STATS(entry, sm, id, start, fn != 0);
+  arm_timers(sm, id);
+  if (chart->_tick_slot && chart->_tick_slot[id] != SC_NO_STATE) {
+    sm->_slots[chart->_tick_slot[id]] = 0;
   }
 }
 
-/** \brief Walk down a branch and call entry_fn(). */
-static void walk_down_entry(State const * const start, State const * const end_child) {
-  if (!end_child || !start) {
-    return;
+/** \brief Exit a state: call its exit_fn(). */
+static void call_exit(Machine *const sm, StateId id) {
+  Chart const *const chart = sm->chart;
+  uint16_t const fn = chart->_compact_states[id].exit;
+  cancel_timers(sm, id);
+  STATS_START(sm, start);
+  TRACE(SC_TRACE_EXIT, sm, SC_NO_EVENT, id, SC_NO_STATE, false);
+  if (fn) {
+    ((exit_fn)chart->_functions[fn])(sm, &chart->states[id]);
+  }
+  STATS(exit, sm, id, start, fn != 0);
+}
+
+/** \brief Whether the run policy of a state lets the event through. Counts ticks. */
+static bool run_due(Machine *const sm, StateId id, Event const *e) {
+  Chart const *const chart = sm->chart;
+  EventType const type = e->type;
+  // Timeouts are internal: Their transition runs, run functions see the next event or tick
+  if (type == SC_TIMEOUT) {
+    return false;
+  }
+  if (chart->_run_events) {
+    // Events out of the bitmap only reach states without an event list
+    bool const due = type >= 0 && type < chart->num_events
+                         ? chart->_run_events[id * chart->_event_words + (size_t)type / 32] &
+                               (UINT32_C(1) << (type % 32))
+                         : chart->states[id].config->run_events == NULL;
+    if (!due) {
+      return false;
+    }
   }
+  if (type != SC_NO_EVENT || !chart->_tick_slot || chart->_tick_slot[id] == SC_NO_STATE) {
+    return true;
+  }
+  StateId *const ticks = &sm->_slots[chart->_tick_slot[id]];
+  if (++*ticks < chart->states[id].config->run_every) {
+    return false;
+  }
+  *ticks = 0;
+  return true;
+}
 
-  if (end_child != start) {
-    walk_down_entry(start, end_child->config->parent);
+/** \brief Call run_fn() of a state if it has one and its policy allows. Returns the request. */
+static State const *call_run(Machine *const sm, StateId id, Event const *e) {
+  Chart const *const chart = sm->chart;
+  uint16_t const fn = chart->_compact_states[id].run;
+  if (!fn) {
+    return NULL;
+  }
+  if (!run_due(sm, id, e)) {
+    STATS(run_skip, sm, id);
+    return NULL;
   }
+  STATS_START(sm, start);
+  State const *requested = ((run_fn)chart->_functions[fn])(sm, &chart->states[id], e);
+  STATS(run_fn, sm, id, start);
+  return requested;
+}
 
-  if (end_child && end_child->config->entry_fn) {
-    end_child->config->entry_fn(end_child);
+/** \brief Walk up a branch and call exit_fn(). end_ancestor MUST be a valid ancestor. */
+static void walk_up_exit(Machine *const sm, StateId start, StateId end_ancestor) {
+  Chart const *const chart = sm->chart;
+  for (; start != end_ancestor; start = chart->_parent[start]) {
+    call_exit(sm, start);
   }
 }
 
-/** \brief Walk down a branch and set initial state to active if present. */
-static State *walk_down_init(State *start) {
-  for (; start->config->initial != NULL; start = start->config->initial) {
-    start->_active = start->config->initial;
+/** \brief Set state as active child of its parent and call entry_fn() if requested. */
+static void activate_state(Machine *const sm, StateId id, bool entry) {
+  set_history(sm, sm->chart->_parent[id], id);
+  if (entry) {
+    call_entry(sm, id);
   }
-  start->_active = start->config->initial;
-  return start;
 }
 
-/** \brief Finds current active leaf in a branch. */
-static State *find_leaf(State const *start) {
-  State const *leaf;
-  for (leaf = start; leaf->_active != NULL; leaf = leaf->_active) {
+/** \brief Walk down a branch from below `ancestor` to `end_child`, activate and enter. */
+static void walk_down_entry(Machine *const sm, StateId ancestor, StateId end_child) {
+  if (end_child == ancestor) {
+    return;
+  }
+  walk_down_entry(sm, ancestor, sm->chart->_parent[end_child]);
+  activate_state(sm, end_child, true);
+}
+
+/** \brief Walk down a branch, set initial state to active and enter it. Returns the leaf. */
+static StateId walk_down_init(Machine *const sm, StateId start) {
+  Chart const *const chart = sm->chart;
+  State const *s = &chart->states[start];
+  for (; s->config->initial != NULL; s = s->config->initial) {
+    activate_state(sm, state_id(chart, s->config->initial), true);
+  }
+  set_history(sm, state_id(chart, s), SC_NO_STATE);
+  return state_id(chart, s);
+}
+
+/** \brief Finds last active leaf in a branch. */
+static StateId find_leaf(Machine const *const sm, StateId start) {
+  for (StateId child = history_of(sm, start); child != SC_NO_STATE;
+       child = history_of(sm, start)) {
+    start = child;
   }
-  return (State *)leaf;
+  return start;
 }
 
 /** \brief Finds root of statechart */
-static State *find_root(State const *start) {
+static State const *find_root(State const *start) {
   State const *root = NULL;
   for (root = start; root->config->parent != NULL; root = root->config->parent) {
   }
-  return (State *)root;
+  return root;
+}
+
+/** \brief Number of set bits. */
+static unsigned popcount32(uint32_t v) {
+#if defined(__GNUC__)
+  return (unsigned)__builtin_popcount(v);
+#else
+  unsigned n = 0;
+  for (; v; v &= v - 1) {
+    ++n;
+  }
+  return n;
+#endif
 }
 
-/** \brief Finds valid (matching or automatic) transition in active branch. */
-static Transition const *find_transition(State const *const root, EventType event) {
-  Transition const *transitions = root->config->transitions;
+/** \brief Index of the lowest set bit. `v` must not be 0. */
+static unsigned lowest_bit(uint32_t v) {
+#if defined(__GNUC__)
+  return (unsigned)__builtin_ctz(v);
+#else
+  unsigned n = 0;
+  for (; !(v & 1); v >>= 1) {
+    ++n;
+  }
+  return n;
+#endif
+}
 
-  for (State const *s = root->_active; s != NULL; s = s->config->parent) {
-    if (!s->config->transitions) {
-      continue;
+/** \brief Cached guard result is unknown. Never a valid stamp. */
+#define GUARD_UNKNOWN UINT16_MAX
+
+/** \brief Stamp of guard results kept until sc_signal(). Run stamps are below. */
+#define GUARD_KEEP 0x7FFE
+
+/**
+ * \brief Evaluate the guard of a transition, or reuse its cached result.
+ *
+ * Cached results are `stamp << 1 | result`, where stamp is the run they were computed in or
+ * GUARD_KEEP for guards depending on signals.
+ */
+static bool guard_passes(Machine const *const sm, uint16_t id, Event const *event) {
+  Chart const *const chart = sm->chart;
+  struct CompactTransition const *const t = &chart->_compact_transitions[id];
+  StateId const slot = chart->_guard_cache ? chart->_guard_cache[id] : SC_NO_STATE;
+  StateId stamp = 0;
+  if (slot != SC_NO_STATE) {
+    bool const keep = chart->_guard_signals[slot - chart->_guard_slot - 1];
+    stamp = keep ? GUARD_KEEP : sm->_slots[chart->_guard_slot];
+    if (sm->_slots[slot] >> 1 == stamp) {
+      return sm->_slots[slot] & 1;
     }
-    transitions = s->config->transitions;
-    for (Transition const *t = transitions; t->type != SC_TTYPE_TABLE_END; ++t) {
-      if (t->event == event || t->event == SC_NO_EVENT) {
-        if (transitions != root->config->transitions) {
-          if (!t->guard_fn || (t->guard_fn && t->guard_fn(root))) {
-            return t;
-          }
-        } else {
-          // Search from current state to root. TODO: Only needed when table is not sourced by state
-          for (State const *parent = root->_active; parent != NULL;
-               parent = parent->config->parent) {
-            if (t->from == parent) {
-              if (!t->guard_fn || (t->guard_fn && t->guard_fn(root))) {
-                return t;
-              }
-            }
-          }
-        }
+  }
+
+  bool const pass = ((guard_fn)chart->_functions[t->guard])(sm, event);
+  TRACE(SC_TRACE_GUARD, sm, event->type, t->from, t->to, pass);
+  if (slot != SC_NO_STATE) {
+    sm->_slots[slot] = (StateId)(stamp << 1 | pass);
+  }
+  return pass;
+}
+
+/** \brief New run stamp, so results of pure guards of the previous run are not reused. */
+static void next_guard_stamp(Machine *const sm) {
+  Chart const *const chart = sm->chart;
+  if (!chart->_guard_cache) {
+    return;
+  }
+  StateId *const stamp = &sm->_slots[chart->_guard_slot];
+  *stamp = (StateId)(*stamp + 1);
+  if (*stamp >= GUARD_KEEP) {
+    // Wrapped, old results could match new stamps
+    *stamp = 0;
+    for (size_t i = chart->_guard_slot + 1; i < chart->_config_slot; ++i) {
+      if (!chart->_guard_signals[i - chart->_guard_slot - 1]) {
+        sm->_slots[i] = GUARD_UNKNOWN;
       }
     }
   }
+}
 
-  return NULL;
+/** \brief The transition of a fired timer, if its source is in the branch of `leaf`. Returns id. */
+static uint16_t timed_transition(Machine const *const sm, StateId leaf, Event const *event) {
+  Chart const *const chart = sm->chart;
+  uint16_t const id = chart->_timer_transition[(Timer const *)event->data - sm->_timers];
+  struct CompactTransition const *t = &chart->_compact_transitions[id];
+  for (StateId s = leaf; s != SC_NO_STATE; s = chart->_parent[s]) {
+    if (s == t->from) {
+      return (!t->guard || guard_passes(sm, id, event)) ? id : NO_TRANSITION;
+    }
+  }
+  return NO_TRANSITION;
 }
 
-/** \brief run active state, return if a new state got returned, NULL otherwise. */
-static State *run_state(State const *const root, State *s, EventType e) {
-  if (s->config->run_fn) {
-    State *target_state = s->config->run_fn(s, e);
-    if (target_state && target_state != root->_active) {
-      return target_state;
+/**
+ * \brief Finds a valid transition for an event in the branch of `leaf`. Returns id.
+ *
+ * SC_NO_EVENT, and events out of the index, find automatic transitions.
+ */
+static uint16_t find_transition(Machine const *const sm, StateId leaf, Event const *event) {
+  Chart const *const chart = sm->chart;
+  EventType const type = event->type;
+  if (type == SC_TIMEOUT) {
+    return timed_transition(sm, leaf, event);
+  }
+  // Events outside the index have no transitions, they must not run automatic ones
+  if (type < 0 || type >= chart->num_events) {
+    return NO_TRANSITION;
+  }
+  size_t const e = (size_t)type;
+  uint32_t const *const bits = &chart->_handles[leaf * chart->_event_words];
+  uint32_t const bit = UINT32_C(1) << (e % 32);
+
+  // Most states have no automatic transitions: The completion check is this bit test
+  if (!(bits[e / 32] & bit)) {
+    return NO_TRANSITION;
+  }
+
+  // Rank of the event bit selects its candidate run
+  size_t run = chart->_run_base[leaf] + popcount32(bits[e / 32] & (bit - 1));
+  for (size_t w = 0; w < e / 32; ++w) {
+    run += popcount32(bits[w]);
+  }
+
+  for (uint32_t c = chart->_runs[run]; c != chart->_runs[run + 1]; ++c) {
+    uint16_t const id = chart->_candidates[c];
+    if (!chart->_compact_transitions[id].guard || guard_passes(sm, id, event)) {
+      if (chart->_hits) {
+        atomic_fetch_add_explicit(&chart->_hits[c], 1, memory_order_relaxed);
+      }
+      return id;
     }
   }
+
+  return NO_TRANSITION;
+}
+
+/** \brief run active state, return if a new state got returned, NULL otherwise. */
+static State const *run_state(Machine *const sm, State const *s, Event const *e) {
+  State const *target_state = call_run(sm, state_id(sm->chart, s), e);
+  if (target_state && target_state != &sm->chart->states[sm->_leaf]) {
+    TRACE(SC_TRACE_RUN_REQUEST, sm, e->type, state_id(sm->chart, s),
+          state_id(sm->chart, target_state), false);
+    return target_state;
+  }
   return NULL;
 }
 
 /** \brief See run_state. Do this for all states in a branch.  */
-static State *ancestors_run(State const *root, EventType event) {
-  for (State *s = root->_active; s != NULL; s = s->config->parent) {
-    State *requested_state = run_state(root, s, event);
+static State const *ancestors_run(Machine *const sm, Event const *event) {
+  for (State const *s = &sm->chart->states[sm->_leaf]; s != NULL; s = s->config->parent) {
+    State const *requested_state = run_state(sm, s, event);
     if (requested_state) {
       return requested_state;
     }
@@ -139,113 +399,1981 @@ static State *ancestors_run(State const *root, EventType event) {
 }
 
 /** \brief Depending on active state type, return target state. */
-static State *get_target_state_from_type(Transition const *const t) {
-  State *target_state = NULL;
-  switch (t->to->config->type) {
+static StateId get_target_state_from_type(Machine const *const sm, State const *const to) {
+  Chart const *const chart = sm->chart;
+  StateConfig const *const config = to->config;
+  StateId target_state = SC_NO_STATE;
+  switch (config->type) {
   case SC_TYPE_NORMAL:
   case SC_TYPE_CHOICE:
-    target_state = t->to;
+  case SC_TYPE_PARALLEL:
+    target_state = state_id(chart, to);
     break;
   case SC_TYPE_HISTORY:
-    if (!t->to->config->parent->_active) {
-      if (t->to->config->initial) {
-        target_state = t->to->config->initial;
+    target_state = history_of(sm, state_id(chart, config->parent));
+    if (target_state == SC_NO_STATE) {
+      if (config->initial) {
+        target_state = state_id(chart, config->initial);
       } else {
-        target_state = t->to->config->parent->config->initial;
+        target_state = state_id(chart, config->parent->config->initial);
       }
-    } else {
-      target_state = t->to->config->parent->_active;
     }
     break;
   case SC_TYPE_HISTORY_DEEP:
-    target_state = find_leaf(t->to->config->parent);
-    if (target_state == t->to->config->parent) {
-      target_state = t->to->config->initial;
+    target_state = find_leaf(sm, state_id(chart, config->parent));
+    if (target_state == state_id(chart, config->parent)) {
+      target_state = state_id(chart, config->initial ? config->initial
+                                                     : config->parent->config->initial);
     }
     break;
   case SC_TYPE_ROOT:
-    target_state = NULL;
+    target_state = SC_NO_STATE;
     break;
   }
   return target_state;
 }
 
-/* -------- Public -------- */
+/**
+ * \brief Stable sort of batch entries by the leaf of their machine.
+ *
+ * Two pass radix sort on the 16 bit leaf.
+ *
+ * \param order   Output. Entry indices ordered by leaf. [n]
+ * \param tmp     Scratch. [n]
+ */
+static void sort_by_leaf(MachineSet const *set, uint32_t const machines[], size_t n,
+                         uint32_t order[], uint32_t tmp[]) {
+  size_t count[256 + 1];
+
+  for (unsigned shift = 0; shift < 16; shift += 8) {
+    uint32_t *const out = shift ? order : tmp;
+    for (size_t b = 0; b <= 256; ++b) {
+      count[b] = 0;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      uint32_t const entry = shift ? tmp[i] : (uint32_t)i;
+      ++count[((set->leaf[machines[entry]] >> shift) & 0xFF) + 1];
+    }
+    for (size_t b = 1; b <= 256; ++b) {
+      count[b] += count[b - 1];
+    }
+    for (size_t i = 0; i < n; ++i) {
+      uint32_t const entry = shift ? tmp[i] : (uint32_t)i;
+      out[count[(set->leaf[machines[entry]] >> shift) & 0xFF]++] = entry;
+    }
+  }
+}
 
-State const *sc_init(State *root) {
-  root->_active = walk_down_init(root);
-  walk_down_entry(root, root->_active);
-  return root->_active;
+/** \brief No history recorded, no state active. */
+static void clear_slots(Chart const *const chart, StateId slots[]) {
+  for (size_t i = 0; i < chart->machine_slots; ++i) {
+    slots[i] = i < chart->_config_slot ? SC_NO_STATE : 0;
+  }
 }
 
-void sc_map_stateconfig_to_states(size_t num_states, State states[num_states],
-                                  StateConfig const statecfgs[num_states]) {
-  for (size_t i = 0; i < num_states; ++i) {
-    states[i].config = &statecfgs[i];
+/** \brief Machine view of a set member. Write back `_leaf` after use. */
+static Machine set_member(MachineSet const *set, uint32_t i) {
+  return (Machine){
+      .chart = set->chart,
+      .ctx = set->ctx ? set->ctx[i] : NULL,
+      ._slots = &set->slots[(size_t)i * set->chart->machine_slots],
+      ._leaf = set->leaf[i],
+  };
+}
+
+/** \brief Take a static transition along its precomputed path. */
+static void execute_path(Machine *const sm, struct CompactTransition const *t,
+                         struct TransitionPath const *path, Event const *event) {
+  // Exit all states on the active branch until boundary
+  walk_up_exit(sm, sm->_leaf, path->boundary);
+
+  // Transition
+  if (t->action) {
+    ((transition_fn)sm->chart->_functions[t->action])(sm, event);
+  }
+
+  // Entry target branch incl. target and its initial states
+  StateId const *const states = &sm->chart->_path_states[path->begin];
+  for (uint16_t i = 0; i < path->len; ++i) {
+    activate_state(sm, states[i], i >= path->skip);
+  }
+  set_history(sm, path->leaf, SC_NO_STATE);
+  set_leaf(sm, path->leaf);
+}
+
+/**
+ * \brief Take a transition whose target is only known at runtime.
+ *
+ * \param t     Transition from a table. NULL if requested by a run function.
+ * \param from  Source of the transition.
+ * \param to    Target. May be a history pseudo state.
+ * \param event Triggering event.
+ */
+static void execute_dynamic(Machine *const sm, Transition const *t, StateId from, State const *to,
+                            Event const *event) {
+  Chart const *const chart = sm->chart;
+
+  // Handle StateType
+  StateId const target = get_target_state_from_type(sm, to);
+
+  // Find common ancestor of source and target
+  StateId boundary = fca(chart, from, target);
+
+  // Local transitions keep the child of the common ancestor
+  if (t && t->type == SC_TTYPE_LOCAL) {
+    boundary = child_towards(chart, boundary, target);
+    activate_state(sm, boundary, false);
+  }
+
+  walk_up_exit(sm, sm->_leaf, boundary);
+
+  if (t && t->transition_fn) {
+    t->transition_fn(sm, event);
   }
+
+  walk_down_entry(sm, boundary, target);
+
+  // We might have not initialized this state yet
+  set_leaf(sm, walk_down_init(sm, target));
 }
 
-void sc_reset_state(State *state) { state->_active = NULL; }
+/* -------- Snapshots -------- */
 
-State const *sc_get_root(State const *s) { return find_root(s); }
+/** \brief Format version of sc_snapshot() blobs. */
+#define SNAPSHOT_VERSION 2
 
-State const *sc_run(State *root, EventType event) {
+/**
+ * \brief Header: version, number of states, slots and timers, active leaf, chart fingerprint.
+ * 16 bit each, the fingerprint takes two.
+ */
+#define SNAPSHOT_HEADER 7
 
-  Transition const *t = find_transition(root, event);
+/** \brief Remaining ticks of a timer which is not armed. */
+#define SNAPSHOT_UNARMED UINT64_MAX
 
-  if (!t) {
-    State *requested_state = ancestors_run(root, event);
-    if (requested_state) {
-      t = &(Transition const){.from = root->_active, .to = requested_state};
+static unsigned char *put_u16(unsigned char *p, uint16_t v) {
+  p[0] = (unsigned char)v;
+  p[1] = (unsigned char)(v >> 8);
+  return p + 2;
+}
+
+static unsigned char *put_u64(unsigned char *p, uint64_t v) {
+  for (unsigned i = 0; i < 8; ++i) {
+    p[i] = (unsigned char)(v >> (8 * i));
+  }
+  return p + 8;
+}
+
+static uint16_t get_u16(unsigned char const *p) { return (uint16_t)(p[0] | p[1] << 8); }
+
+static uint64_t get_u64(unsigned char const *p) {
+  uint64_t v = 0;
+  for (unsigned i = 8; i-- > 0;) {
+    v = v << 8 | p[i];
+  }
+  return v;
+}
+
+static uint32_t fnv_mix(uint32_t h, uint32_t v) { return (h ^ v) * 16777619u; }
+
+/** \brief FNV-1a hash of the hierarchy and transitions, so blobs only restore into their chart. */
+static uint32_t chart_fingerprint(Chart const *const chart) {
+  uint32_t h = 2166136261u;
+  h = fnv_mix(h, (uint32_t)chart->num_events);
+  h = fnv_mix(h, (uint32_t)chart->num_transitions);
+  for (size_t i = 0; i < chart->num_states; ++i) {
+    h = fnv_mix(h, chart->_parent[i]);
+    h = fnv_mix(h, chart->states[i].config->type);
+    h = fnv_mix(h, chart->_history_slot[i]);
+  }
+  for (size_t id = 0; id < chart->num_transitions; ++id) {
+    Transition const *const t = chart->_transitions[id];
+    h = fnv_mix(h, chart->_compact_transitions[id].from);
+    h = fnv_mix(h, chart->_compact_transitions[id].to);
+    h = fnv_mix(h, (uint32_t)t->event);
+    h = fnv_mix(h, t->type);
+  }
+  return h;
+}
+
+/* -------- Regions -------- */
+
+/** \brief Active configuration bitset of a machine. Followed by the scratch bitset. */
+static StateId *config_bits(Machine const *const sm) {
+  return &sm->_slots[sm->chart->_config_slot];
+}
+
+static bool bit_test(StateId const *bits, StateId id) { return bits[id / 16] & (1u << (id % 16)); }
+
+static void bit_set(StateId *bits, StateId id) { bits[id / 16] |= (StateId)(1u << (id % 16)); }
+
+static void bit_clear(StateId *bits, StateId id) { bits[id / 16] &= (StateId)~(1u << (id % 16)); }
+
+/** \brief Whether a child is a region or substate, not a pseudo state. */
+static bool is_substate(Chart const *const chart, StateId id) {
+  StateType const type = chart->states[id].config->type;
+  return type == SC_TYPE_NORMAL || type == SC_TYPE_PARALLEL;
+}
+
+static bool is_parallel(Chart const *const chart, StateId id) {
+  return chart->states[id].config->type == SC_TYPE_PARALLEL;
+}
+
+/** \brief First active child of a state. SC_NO_STATE if none. */
+static StateId active_child(Machine const *const sm, StateId id) {
+  Chart const *const chart = sm->chart;
+  StateId const *const active = config_bits(sm);
+  StateId c = chart->_first_child[id];
+  for (; c != SC_NO_STATE && !bit_test(active, c); c = chart->_next_sibling[c]) {
+  }
+  return c;
+}
+
+/** \brief Leaf of the first active region below `id`. */
+static StateId first_leaf(Machine const *const sm, StateId id) {
+  for (StateId c = active_child(sm, id); c != SC_NO_STATE; c = active_child(sm, id)) {
+    id = c;
+  }
+  return id;
+}
+
+/** \brief Activate a state, mark it as touched in this step and call entry_fn(). */
+static void enter_state(Machine *const sm, StateId id) {
+  StateId *const active = config_bits(sm);
+  bit_set(active, id);
+  bit_set(&active[sm->chart->_config_words], id);
+  activate_state(sm, id, true);
+}
+
+/** \brief Enter initial states, or all regions of a parallel state. `id` is active. */
+static void enter_default(Machine *const sm, StateId id) {
+  Chart const *const chart = sm->chart;
+  StateConfig const *const config = chart->states[id].config;
+  if (config->type == SC_TYPE_PARALLEL) {
+    for (StateId c = chart->_first_child[id]; c != SC_NO_STATE; c = chart->_next_sibling[c]) {
+      if (is_substate(chart, c)) {
+        enter_state(sm, c);
+        enter_default(sm, c);
+      }
     }
+  } else if (config->initial) {
+    StateId const c = state_id(chart, config->initial);
+    enter_state(sm, c);
+    enter_default(sm, c);
+  } else {
+    set_history(sm, id, SC_NO_STATE);
   }
+}
 
-  while (t) {
-    // Handle StateType
-    State *target_state = get_target_state_from_type(t);
+/** \brief Enter the last active children recursively (deep history). `id` is active. */
+static void enter_history(Machine *const sm, StateId id) {
+  Chart const *const chart = sm->chart;
+  if (is_parallel(chart, id)) {
+    for (StateId c = chart->_first_child[id]; c != SC_NO_STATE; c = chart->_next_sibling[c]) {
+      if (is_substate(chart, c)) {
+        enter_state(sm, c);
+        enter_history(sm, c);
+      }
+    }
+    return;
+  }
+  StateId const c = history_of(sm, id);
+  if (c == SC_NO_STATE) {
+    enter_default(sm, id);
+  } else {
+    enter_state(sm, c);
+    enter_history(sm, c);
+  }
+}
 
-    // Find common ancestor of active leaf and target
-    State *ca = fca(t->from, target_state);
+/** \brief Enter from below active `id` down to `target`, and the other regions on the way. */
+static void enter_path(Machine *const sm, StateId id, StateId target, bool deep) {
+  Chart const *const chart = sm->chart;
+  if (id == target) {
+    if (deep) {
+      enter_history(sm, id);
+    } else {
+      enter_default(sm, id);
+    }
+    return;
+  }
+  StateId const towards = child_towards(chart, id, target);
+  if (!is_parallel(chart, id)) {
+    enter_state(sm, towards);
+    enter_path(sm, towards, target, deep);
+    return;
+  }
+  for (StateId c = chart->_first_child[id]; c != SC_NO_STATE; c = chart->_next_sibling[c]) {
+    if (c == towards) {
+      enter_state(sm, c);
+      enter_path(sm, c, target, deep);
+    } else if (is_substate(chart, c)) {
+      enter_state(sm, c);
+      enter_default(sm, c);
+    }
+  }
+}
 
-    State *from_leaf = NULL;
+/** \brief Exit all active states below `id`, innermost first. */
+static void exit_below(Machine *const sm, StateId id) {
+  Chart const *const chart = sm->chart;
+  StateId *const active = config_bits(sm);
+  for (StateId c = chart->_first_child[id]; c != SC_NO_STATE; c = chart->_next_sibling[c]) {
+    if (bit_test(active, c)) {
+      exit_below(sm, c);
+      bit_clear(active, c);
+      call_exit(sm, c);
+    }
+  }
+}
 
-    from_leaf = root->_active;
+/** \brief Exit boundary of a transition. States below it are exited. */
+static StateId transition_boundary(Chart const *const chart, Transition const *t, StateId from,
+                                   StateId target) {
+  StateId boundary = fca(chart, from, target);
+  if (t && t->type == SC_TTYPE_LOCAL) {
+    boundary = child_towards(chart, boundary, target);
+  }
+  return boundary;
+}
 
-    // Set target branch active states to reach target
-    walk_up_set_active_state(target_state, ca);
+/**
+ * \brief Take a transition in a chart with regions.
+ *
+ * \param t     Transition from a table. NULL if requested by a run function.
+ * \param from  Source of the transition.
+ * \param to    Target. May be a pseudo state.
+ */
+static void execute_regions(Machine *const sm, Transition const *t, StateId from,
+                            State const *to, Event const *event) {
+  Chart const *const chart = sm->chart;
+  StateConfig const *const config = to->config;
+  StateId target = state_id(chart, to);
+  bool deep = false;
 
-    // Exit all states on the active branch until ancestor
-    if (t->type == SC_TTYPE_LOCAL) {
-      ca = ca->_active;
+  // Resolve history. History of a parallel state enters all its regions.
+  if (config->type == SC_TYPE_HISTORY || config->type == SC_TYPE_HISTORY_DEEP) {
+    StateId const parent = state_id(chart, config->parent);
+    StateId const last = history_of(sm, parent);
+    if (is_parallel(chart, parent)) {
+      target = parent;
+      deep = config->type == SC_TYPE_HISTORY_DEEP;
+    } else if (last != SC_NO_STATE) {
+      target = last;
+      deep = config->type == SC_TYPE_HISTORY_DEEP;
+      // Deep history targets the last active leaf, or the parallel state above it
+      for (StateId c = history_of(sm, target);
+           deep && c != SC_NO_STATE && !is_parallel(chart, target); c = history_of(sm, target)) {
+        target = c;
+      }
+    } else {
+      target = state_id(chart, config->initial ? config->initial : config->parent->config->initial);
     }
-    walk_up_exit(root, from_leaf, ca);
+  } else if (config->type == SC_TYPE_ROOT) {
+    target = state_id(chart, chart->root);
+  }
+
+  StateId const boundary = transition_boundary(chart, t, from, target);
+
+  // Block transitions of other regions which would exit this one
+  StateId *const touched = &config_bits(sm)[chart->_config_words];
+  for (StateId a = boundary; a != SC_NO_STATE; a = chart->_parent[a]) {
+    bit_set(touched, a);
+  }
+
+  exit_below(sm, boundary);
 
-    // Transition
-    if (t->transition_fn)
-      t->transition_fn(root);
+  if (t && t->transition_fn) {
+    t->transition_fn(sm, event);
+  }
+
+  enter_path(sm, boundary, target, deep);
+}
 
-    // Entry target branch incl. target
-    walk_down_entry(ca->_active, target_state);
+/** \brief Let every region leaf of the configuration take a transition. Returns if any did. */
+static bool dispatch_regions(Machine *const sm, Event const *event) {
+  Chart const *const chart = sm->chart;
+  StateId *const active = config_bits(sm);
+  StateId *const touched = &active[chart->_config_words];
+  bool taken = false;
 
-    // We might have not initialized this state yet
-    from_leaf = walk_down_init(target_state);
+  for (size_t w = 0; w < chart->_config_words; ++w) {
+    touched[w] = 0;
+  }
 
-    // Walk down until leaf
-    walk_down_entry(target_state->_active, from_leaf);
-    root->_active = from_leaf ? from_leaf : target_state;
-    t = NULL;
+  for (StateId id = 0; id < chart->num_states; ++id) {
+    // Only leaves which were active before this event and are still active
+    if (!bit_test(active, id) || bit_test(touched, id) || active_child(sm, id) != SC_NO_STATE) {
+      continue;
+    }
+    uint16_t const t = find_transition(sm, id, event);
+    if (t == NO_TRANSITION) {
+      continue;
+    }
+    Transition const *transition = chart->_transitions[t];
+    StateId const from = chart->_compact_transitions[t].from;
+    StateId const to = chart->_compact_transitions[t].to;
+    if (bit_test(touched, transition_boundary(chart, transition, from, to))) {
+      continue;
+    }
+    TRACE(SC_TRACE_TRANSITION, sm, event->type, from, to, false);
+    STATS(transition, sm, t);
+    execute_regions(sm, transition, from, &chart->states[to], event);
+    taken = true;
+  }
+  return taken;
+}
 
-    // Check transitions of current state with no event
-    t = find_transition(root, SC_NO_EVENT);
+/**
+ * \brief Run functions of all active states below and including `id`, children first.
+ *
+ * \param source  Output. Leaf below the state which requested a new state.
+ *
+ * \return        Requested state. NULL if none.
+ */
+static State const *run_active(Machine *const sm, StateId id, Event const *event,
+                               StateId *source) {
+  Chart const *const chart = sm->chart;
+  StateId const *const active = config_bits(sm);
 
-    // Run all "run" functions including parents, continue change if requested
-    if (!t) {
-      State *requested_state = ancestors_run(root, event);
-      if (requested_state) {
-        t = &(Transition const){.from = root->_active, .to = requested_state};
+  for (StateId c = chart->_first_child[id]; c != SC_NO_STATE; c = chart->_next_sibling[c]) {
+    if (bit_test(active, c)) {
+      State const *requested = run_active(sm, c, event, source);
+      if (requested) {
+        return requested;
       }
     }
   }
 
-  return root->_active;
+  State const *requested = call_run(sm, id, event);
+  StateId const rid = requested ? state_id(chart, requested) : SC_NO_STATE;
+  // Requesting an active leaf is no change
+  if (requested && !(bit_test(active, rid) && active_child(sm, rid) == SC_NO_STATE)) {
+    TRACE(SC_TRACE_RUN_REQUEST, sm, event->type, id, rid, false);
+    *source = first_leaf(sm, id);
+    return requested;
+  }
+  return NULL;
+}
+
+/** \brief One micro-step of a chart with regions. Returns whether the configuration changed. */
+static bool step_regions(Machine *const sm, Event const *trigger, Event const *event) {
+  if (dispatch_regions(sm, trigger)) {
+    return true;
+  }
+
+  // Run all "run" functions including parents, change if requested
+  StateId source = SC_NO_STATE;
+  State const *requested = run_active(sm, state_id(sm->chart, sm->chart->root), event, &source);
+  if (requested) {
+    execute_regions(sm, NULL, source, requested, event);
+    return true;
+  }
+  return false;
+}
+
+/** \brief sc_run() for charts with regions. */
+static State const *run_regions(Machine *const sm, Event const *event) {
+  static Event const no_event = {.type = SC_NO_EVENT};
+  Chart const *const chart = sm->chart;
+
+  for (Event const *trigger = event; step_regions(sm, trigger, event); trigger = &no_event) {
+  }
+
+  set_leaf(sm, first_leaf(sm, state_id(chart, chart->root)));
+  return &chart->states[sm->_leaf];
+}
+
+/* -------- Compile -------- */
+
+/** \brief Bump allocator for the compiled chart. Keeps counting when out of memory. */
+typedef struct Arena {
+  unsigned char *mem;
+  size_t size;
+  size_t used;
+} Arena;
+
+static void *arena_alloc(Arena *a, size_t count, size_t size, size_t align) {
+  size_t const offset = (a->used + align - 1) / align * align;
+  a->used = offset + count * size;
+  return (a->mem && a->used <= a->size) ? a->mem + offset : NULL;
+}
+
+/** \brief Whether `ancestor` is `s` or one of its ancestors. */
+static bool is_ancestor_or_self(State const *ancestor, State const *s) {
+  for (; s != NULL; s = s->config->parent) {
+    if (s == ancestor) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/** \brief Number of ancestors. */
+static uint16_t state_depth(State const *s) {
+  uint16_t depth = 0;
+  for (; s->config->parent != NULL; s = s->config->parent) {
+    ++depth;
+  }
+  return depth;
+}
+
+/** \brief Lowest common proper ancestor, root if either state is root. Compile time helper. */
+static State const *static_fca(Chart const *chart, State const *left, State const *right) {
+  for (State const *a = right->config->parent; a != NULL; a = a->config->parent) {
+    if (left->config->parent && is_ancestor_or_self(a, left->config->parent)) {
+      return a;
+    }
+  }
+  return chart->root;
+}
+
+/** \brief Whether the target of a transition is resolved at runtime. */
+static bool is_dynamic(Transition const *t) {
+  switch (t->to->config->type) {
+  case SC_TYPE_HISTORY:
+  case SC_TYPE_HISTORY_DEEP:
+  case SC_TYPE_ROOT:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * \brief Builds the activation path of a static transition.
+ *
+ * States below the common ancestor down to target, then the initial states of target.
+ *
+ * \param path  Path to fill. NULL to only count.
+ * \param out   Output for the states. NULL to only count.
+ *
+ * \return      Number of states in the path.
+ */
+static uint16_t static_path(Chart const *chart, Transition const *t, struct TransitionPath *path,
+                            StateId *out) {
+  State const *const ca = static_fca(chart, t->from, t->to);
+  uint16_t const below = (uint16_t)(state_depth(t->to) - state_depth(ca));
+  uint16_t n = below;
+
+  if (out) {
+    State const *s = t->to;
+    for (uint16_t i = below; i > 0; --i, s = s->config->parent) {
+      out[i - 1] = state_id(chart, s);
+    }
+  }
+  State const *leaf = t->to;
+  for (; leaf->config->initial != NULL; leaf = leaf->config->initial) {
+    if (out) {
+      out[n] = state_id(chart, leaf->config->initial);
+    }
+    ++n;
+  }
+
+  if (path) {
+    bool const local = t->type == SC_TTYPE_LOCAL;
+    path->boundary = local ? out[0] : state_id(chart, ca);
+    path->leaf = state_id(chart, leaf);
+    path->skip = local ? 1 : 0;
+    path->len = n;
+  }
+  return n;
+}
+
+/**
+ * \brief Whether the last active child of a state must be kept per machine.
+ *
+ * True for parents of history states and for all states with children below a deep history
+ * parent. Compile time helper.
+ */
+static bool needs_history(Chart const *chart, State const *s) {
+  bool has_children = false;
+  bool needed = false;
+  for (size_t i = 0; i < chart->num_states; ++i) {
+    StateConfig const *config = chart->states[i].config;
+    has_children |= config->parent == s;
+    needed |= config->type == SC_TYPE_HISTORY && config->parent == s;
+    needed |= config->type == SC_TYPE_HISTORY_DEEP && is_ancestor_or_self(config->parent, s);
+  }
+  return has_children && needed;
+}
+
+/** \brief Whether the guard result of a transition may be cached. */
+static bool caches_guard(Transition const *t) {
+  return t->guard_fn && (t->pure_guard || t->guard_signals);
+}
+
+/** \brief Number of entries in a transition table. */
+static size_t table_len(Transition const *table) {
+  size_t len = 0;
+  for (; table && table[len].type != SC_TTYPE_TABLE_END; ++len) {
+  }
+  return len;
+}
+
+/**
+ * \brief Collects candidate transitions for `leaf` being the active state and `event`.
+ *
+ * Mirrors the evaluation order of a linear search: Tables from leaf to root, each in table order.
+ * Root table entries only when sourced by a state of the active branch. Automatic transitions
+ * only for SC_NO_EVENT.
+ *
+ * \param first_id  First transition id of each state table. NULL to only count.
+ * \param out       Output for transition ids. NULL to only count.
+ *
+ * \return          Number of candidates.
+ */
+static size_t collect_candidates(Chart const *chart, State const *leaf, EventType event,
+                                 uint16_t const *first_id, uint16_t *out) {
+  size_t n = 0;
+  for (State const *s = leaf; s != NULL; s = s->config->parent) {
+    Transition const *table = s->config->transitions;
+    for (size_t i = 0, len = table_len(table); i < len; ++i) {
+      Transition const *t = &table[i];
+      // Time triggered transitions are only taken by their timer
+      if (t->event != event || t->after) {
+        continue;
+      }
+      if (s == chart->root && !is_ancestor_or_self(t->from, leaf)) {
+        continue;
+      }
+      if (out) {
+        out[n] = (uint16_t)(first_id[state_id(chart, s)] + i);
+      }
+      ++n;
+    }
+  }
+  return n;
+}
+
+/** \brief Any state or transition function, as kept in Chart._functions. */
+typedef void (*AnyFunction)(void);
+
+/** \brief Function `k` of a state: Entry, exit, run. */
+static AnyFunction state_function(State const *s, unsigned k) {
+  StateConfig const *const config = s->config;
+  return k == 0 ? (AnyFunction)config->entry_fn
+                : k == 1 ? (AnyFunction)config->exit_fn : (AnyFunction)config->run_fn;
+}
+
+/** \brief Function `k` of a transition: Guard, action. */
+static AnyFunction transition_function(Transition const *t, unsigned k) {
+  return k == 0 ? (AnyFunction)t->guard_fn : (AnyFunction)t->transition_fn;
+}
+
+/** \brief Whether a state function before function `k` of state `i` is `fn`. Compile helper. */
+static bool state_function_before(State const states[], size_t i, unsigned k, AnyFunction fn) {
+  for (size_t j = 0; j <= i; ++j) {
+    for (unsigned m = 0, len = j < i ? 3 : k; m < len; ++m) {
+      if (state_function(&states[j], m) == fn) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * \brief Whether a function before function `k` of entry `t` of table `i` is `fn`. Compile helper.
+ *
+ * All state functions come before the transition functions, see Chart._functions.
+ */
+static bool transition_function_before(State const states[], size_t num_states, size_t i,
+                                       size_t t, unsigned k, AnyFunction fn) {
+  if (state_function_before(states, num_states, 0, fn)) {
+    return true;
+  }
+  for (size_t j = 0; j <= i; ++j) {
+    Transition const *table = states[j].config->transitions;
+    for (size_t m = 0, len = j < i ? table_len(table) : t + 1; m < len; ++m) {
+      for (unsigned f = 0, n = j == i && m == t ? k : 2; f < n; ++f) {
+        if (transition_function(&table[m], f) == fn) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+/** \brief Index of a function in the table of distinct functions, added if new. 0 for NULL. */
+static uint16_t function_index(AnyFunction functions[], size_t *num_functions, AnyFunction fn) {
+  if (!fn) {
+    return 0;
+  }
+  size_t i = 1;
+  while (i < *num_functions && functions[i] != fn) {
+    ++i;
+  }
+  if (i == *num_functions) {
+    functions[(*num_functions)++] = fn;
+  }
+  return (uint16_t)i;
+}
+
+/** \brief Number of entries of a SC_NO_EVENT terminated event list. */
+static size_t event_list_len(EventType const *deferred) {
+  size_t len = 0;
+  while (deferred && deferred[len] != SC_NO_EVENT) {
+    ++len;
+  }
+  return len;
+}
+
+/**
+ * \brief Whether the branch of `leaf` defers an event
+ *
+ * The nearest state to the leaf which has a transition for the event or defers it decides, a
+ * transition wins within a state. Same table rules as collect_candidates().
+ */
+static bool defers_event(Chart const *chart, State const *leaf, EventType event) {
+  for (State const *s = leaf; s != NULL; s = s->config->parent) {
+    Transition const *table = s->config->transitions;
+    for (size_t i = 0, len = table_len(table); i < len; ++i) {
+      if (table[i].event == event && !table[i].after &&
+          (s != chart->root || is_ancestor_or_self(table[i].from, leaf))) {
+        return false;
+      }
+    }
+    EventType const *deferred = s->config->deferred;
+    for (size_t i = 0, len = event_list_len(deferred); i < len; ++i) {
+      if (deferred[i] == event) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/** \brief Whether a state needs a tick counter for its run function. */
+static bool counts_ticks(State const *s) {
+  return s->config->run_fn && s->config->run_every > 1 && !s->config->run_no_ticks;
+}
+
+/** \brief Whether a transition before entry `k` of table `i` caches `guard`. Compile helper. */
+static bool cached_before(State const states[], size_t i, size_t k, guard_fn guard) {
+  for (size_t j = 0; j <= i; ++j) {
+    Transition const *table = states[j].config->transitions;
+    for (size_t m = 0, len = j < i ? table_len(table) : k; m < len; ++m) {
+      if (caches_guard(&table[m]) && table[m].guard_fn == guard) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+size_t sc_compile(Chart *chart, size_t num_states, State const states[num_states], void *mem,
+                  size_t mem_size) {
+  Arena arena = {.mem = mem, .size = mem_size};
+
+  *chart = (Chart){.states = states, .num_states = num_states, .num_events = 1};
+
+  size_t num_transitions = 0;
+  size_t num_timers = 0;
+  bool regions = false;
+  bool deferral = false;
+  bool run_filter = false;
+  size_t num_ticked = 0;
+  bool exclusive = false;
+  for (size_t i = 0; i < num_states; ++i) {
+    if (states[i].config->type == SC_TYPE_ROOT) {
+      chart->root = &states[i];
+    }
+    regions |= states[i].config->type == SC_TYPE_PARALLEL;
+    Transition const *table = states[i].config->transitions;
+    for (size_t k = 0, len = table_len(table); k < len; ++k) {
+      if (table[k].event >= chart->num_events) {
+        chart->num_events = table[k].event + 1;
+      }
+      num_timers += table[k].after ? 1 : 0;
+      exclusive |= table[k].exclusive_guard;
+    }
+    num_transitions += table_len(table);
+    EventType const *deferred = states[i].config->deferred;
+    for (size_t k = 0, len = event_list_len(deferred); k < len; ++k) {
+      if (deferred[k] >= chart->num_events) {
+        chart->num_events = deferred[k] + 1;
+      }
+      deferral |= deferred[k] > 0;
+    }
+    EventType const *run_events = states[i].config->run_events;
+    for (size_t k = 0, len = event_list_len(run_events); k < len; ++k) {
+      if (run_events[k] >= chart->num_events) {
+        chart->num_events = run_events[k] + 1;
+      }
+    }
+    run_filter |= run_events || states[i].config->run_no_ticks;
+    num_ticked += counts_ticks(&states[i]);
+  }
+  chart->_event_words = ((size_t)chart->num_events + 31) / 32;
+
+  if (!chart->root || num_states >= SC_NO_STATE || num_transitions >= NO_TRANSITION) {
+    return SIZE_MAX;
+  }
+
+  // Measure candidate runs per (state, event) and static transition paths
+  size_t num_runs = 0;
+  size_t num_candidates = 0;
+  size_t num_path_states = 0;
+  size_t num_cached = 0;
+  size_t num_functions = 1;
+  for (size_t i = 0; i < num_states; ++i) {
+    for (unsigned k = 0; k < 3; ++k) {
+      AnyFunction const fn = state_function(&states[i], k);
+      num_functions += fn && !state_function_before(states, i, k, fn);
+    }
+  }
+  for (size_t i = 0; i < num_states; ++i) {
+    Transition const *table = states[i].config->transitions;
+    for (size_t k = 0, len = table_len(table); k < len; ++k) {
+      num_path_states += is_dynamic(&table[k]) ? 0 : static_path(chart, &table[k], NULL, NULL);
+      num_cached += caches_guard(&table[k]) && !cached_before(states, i, k, table[k].guard_fn);
+      for (unsigned f = 0; f < 2; ++f) {
+        AnyFunction const fn = transition_function(&table[k], f);
+        num_functions += fn && !transition_function_before(states, num_states, i, k, f, fn);
+      }
+    }
+  }
+  if (num_functions > UINT16_MAX) {
+    return SIZE_MAX;
+  }
+  for (size_t i = 0; i < num_states; ++i) {
+    for (EventType e = 0; e < chart->num_events; ++e) {
+      size_t const n = collect_candidates(chart, &states[i], e, NULL, NULL);
+      num_runs += n ? 1 : 0;
+      num_candidates += n;
+    }
+  }
+
+  Transition const **transitions =
+      arena_alloc(&arena, num_transitions, sizeof(*transitions), _Alignof(Transition const *));
+  uint16_t *first_id = arena_alloc(&arena, num_states, sizeof(*first_id), _Alignof(uint16_t));
+  uint32_t *handles =
+      arena_alloc(&arena, num_states * chart->_event_words, sizeof(*handles), _Alignof(uint32_t));
+  uint32_t *run_base = arena_alloc(&arena, num_states, sizeof(*run_base), _Alignof(uint32_t));
+  uint32_t *runs = arena_alloc(&arena, num_runs + 1, sizeof(*runs), _Alignof(uint32_t));
+  uint16_t *candidates =
+      arena_alloc(&arena, num_candidates, sizeof(*candidates), _Alignof(uint16_t));
+  StateId *parent = arena_alloc(&arena, num_states, sizeof(*parent), _Alignof(StateId));
+  uint16_t *depth = arena_alloc(&arena, num_states, sizeof(*depth), _Alignof(uint16_t));
+  bool *branch_runs = arena_alloc(&arena, num_states, sizeof(*branch_runs), _Alignof(bool));
+  struct CompactTransition *compact_transitions = arena_alloc(
+      &arena, num_transitions, sizeof(*compact_transitions), _Alignof(struct CompactTransition));
+  struct CompactState *compact_states =
+      arena_alloc(&arena, num_states, sizeof(*compact_states), _Alignof(struct CompactState));
+  AnyFunction *functions =
+      arena_alloc(&arena, num_functions, sizeof(*functions), _Alignof(AnyFunction));
+  struct TransitionPath *paths =
+      arena_alloc(&arena, num_transitions, sizeof(*paths), _Alignof(struct TransitionPath));
+  StateId *path_states =
+      arena_alloc(&arena, num_path_states, sizeof(*path_states), _Alignof(StateId));
+  StateId *history_slot = arena_alloc(&arena, num_states, sizeof(*history_slot), _Alignof(StateId));
+  StateId *first_child = NULL;
+  StateId *next_sibling = NULL;
+  if (regions) {
+    first_child = arena_alloc(&arena, num_states, sizeof(*first_child), _Alignof(StateId));
+    next_sibling = arena_alloc(&arena, num_states, sizeof(*next_sibling), _Alignof(StateId));
+  }
+  StateId *guard_cache = NULL;
+  uint32_t *guard_signals = NULL;
+  if (num_cached) {
+    guard_cache = arena_alloc(&arena, num_transitions, sizeof(*guard_cache), _Alignof(StateId));
+    guard_signals = arena_alloc(&arena, num_cached, sizeof(*guard_signals), _Alignof(uint32_t));
+  }
+  uint32_t *exclusive_runs = NULL;
+  if (exclusive) {
+    exclusive_runs =
+        arena_alloc(&arena, (num_runs + 31) / 32, sizeof(*exclusive_runs), _Alignof(uint32_t));
+  }
+  uint32_t *defers = NULL;
+  if (deferral) {
+    defers =
+        arena_alloc(&arena, num_states * chart->_event_words, sizeof(*defers), _Alignof(uint32_t));
+  }
+  uint32_t *run_events = NULL;
+  if (run_filter) {
+    run_events = arena_alloc(&arena, num_states * chart->_event_words, sizeof(*run_events),
+                             _Alignof(uint32_t));
+  }
+  StateId *tick_slot = NULL;
+  if (num_ticked) {
+    tick_slot = arena_alloc(&arena, num_states, sizeof(*tick_slot), _Alignof(StateId));
+  }
+  uint16_t *timer_begin = NULL;
+  uint16_t *timer_transition = NULL;
+  if (num_timers) {
+    timer_begin = arena_alloc(&arena, num_states + 1, sizeof(*timer_begin), _Alignof(uint16_t));
+    timer_transition =
+        arena_alloc(&arena, num_timers, sizeof(*timer_transition), _Alignof(uint16_t));
+  }
+
+  if (!history_slot || (regions && !next_sibling) || (num_cached && !guard_signals) ||
+      (exclusive && !exclusive_runs) || (deferral && !defers) || (run_filter && !run_events) ||
+      (num_ticked && !tick_slot) || (num_timers && !timer_transition)) {
+    return arena.used;
+  }
+
+  for (size_t i = 0; i < num_states; ++i) {
+    State const *p = states[i].config->parent;
+    parent[i] = p ? state_id(chart, p) : SC_NO_STATE;
+    depth[i] = state_depth(&states[i]);
+    branch_runs[i] = false;
+    for (State const *s = &states[i]; s != NULL; s = s->config->parent) {
+      branch_runs[i] |= s->config->run_fn != NULL;
+    }
+    history_slot[i] =
+        needs_history(chart, &states[i]) ? (StateId)chart->machine_slots++ : SC_NO_STATE;
+  }
+
+  // Active path, one slot per depth
+  uint16_t max_depth = 0;
+  for (size_t i = 0; i < num_states; ++i) {
+    max_depth = depth[i] > max_depth ? depth[i] : max_depth;
+  }
+  chart->_path_slot = chart->machine_slots;
+  chart->machine_slots += (size_t)max_depth + 1;
+
+  // Run stamp and one result per cached guard
+  chart->_guard_slot = chart->machine_slots;
+  chart->machine_slots += num_cached ? 1 + num_cached : 0;
+
+  // Children in state order and the active configuration, only used with regions
+  chart->_config_slot = chart->machine_slots;
+  if (regions) {
+    for (size_t i = 0; i < num_states; ++i) {
+      first_child[i] = SC_NO_STATE;
+    }
+    for (size_t i = num_states; i-- > 0;) {
+      next_sibling[i] = SC_NO_STATE;
+      if (parent[i] != SC_NO_STATE) {
+        next_sibling[i] = first_child[parent[i]];
+        first_child[parent[i]] = (StateId)i;
+      }
+    }
+    chart->_config_words = (num_states + 15) / 16;
+    chart->machine_slots += 2 * chart->_config_words;
+  }
+
+  // Bitmap of the event types waiting in the deferral storage
+  chart->_defer_slot = chart->machine_slots;
+  chart->machine_slots += deferral ? ((size_t)chart->num_events + 15) / 16 : 0;
+
+  // Tick counters of states whose run function skips ticks
+  for (size_t i = 0; num_ticked && i < num_states; ++i) {
+    tick_slot[i] = counts_ticks(&states[i]) ? (StateId)chart->machine_slots++ : SC_NO_STATE;
+  }
+
+  size_t id = 0;
+  size_t path_state = 0;
+  for (size_t i = 0; i < num_states; ++i) {
+    Transition const *table = states[i].config->transitions;
+    first_id[i] = (uint16_t)id;
+    for (size_t k = 0, len = table_len(table); k < len; ++k, ++id) {
+      transitions[id] = &table[k];
+      paths[id] = (struct TransitionPath){.dynamic = is_dynamic(&table[k])};
+      if (!paths[id].dynamic) {
+        paths[id].begin = (uint32_t)path_state;
+        path_state += static_path(chart, &table[k], &paths[id], &path_states[path_state]);
+      }
+    }
+  }
+
+  // Dense copies for the dispatch, functions by index
+  size_t function = 1;
+  functions[0] = NULL;
+  for (size_t i = 0; i < num_states; ++i) {
+    compact_states[i] = (struct CompactState){
+        .entry = function_index(functions, &function, state_function(&states[i], 0)),
+        .exit = function_index(functions, &function, state_function(&states[i], 1)),
+        .run = function_index(functions, &function, state_function(&states[i], 2)),
+    };
+  }
+  for (size_t t = 0; t < num_transitions; ++t) {
+    compact_transitions[t] = (struct CompactTransition){
+        .from = state_id(chart, transitions[t]->from),
+        .to = state_id(chart, transitions[t]->to),
+        .guard = function_index(functions, &function, transition_function(transitions[t], 0)),
+        .action = function_index(functions, &function, transition_function(transitions[t], 1)),
+    };
+  }
+
+  size_t run = 0;
+  size_t candidate = 0;
+  for (size_t i = 0; i < num_states; ++i) {
+    uint32_t *bits = &handles[i * chart->_event_words];
+    run_base[i] = (uint32_t)run;
+    for (size_t w = 0; w < chart->_event_words; ++w) {
+      bits[w] = 0;
+    }
+    for (EventType e = 0; e < chart->num_events; ++e) {
+      size_t const n = collect_candidates(chart, &states[i], e, first_id, &candidates[candidate]);
+      if (n) {
+        bits[e / 32] |= UINT32_C(1) << (e % 32);
+        runs[run++] = (uint32_t)candidate;
+        candidate += n;
+      }
+    }
+  }
+  runs[run] = (uint32_t)candidate;
+
+  // Runs of more than one candidate, all guarded and declared exclusive
+  for (size_t r = 0; exclusive && r < num_runs; ++r) {
+    bool any_order = runs[r + 1] - runs[r] > 1;
+    for (uint32_t c = runs[r]; any_order && c < runs[r + 1]; ++c) {
+      Transition const *t = transitions[candidates[c]];
+      any_order = t->guard_fn && t->exclusive_guard;
+    }
+    if (r % 32 == 0) {
+      exclusive_runs[r / 32] = 0;
+    }
+    exclusive_runs[r / 32] |= any_order ? UINT32_C(1) << (r % 32) : 0;
+  }
+
+  // One cached result per guard function, depending on the signals of all its transitions
+  size_t cached = 0;
+  for (size_t t = 0; num_cached && t < num_transitions; ++t) {
+    guard_cache[t] = SC_NO_STATE;
+    if (!caches_guard(transitions[t])) {
+      continue;
+    }
+    size_t k = 0;
+    for (; k < t && (guard_cache[k] == SC_NO_STATE ||
+                     transitions[k]->guard_fn != transitions[t]->guard_fn);
+         ++k) {
+    }
+    if (k == t) {
+      guard_signals[cached] = 0;
+      guard_cache[t] = (StateId)(chart->_guard_slot + 1 + cached++);
+    } else {
+      guard_cache[t] = guard_cache[k];
+    }
+    guard_signals[guard_cache[t] - chart->_guard_slot - 1] |= transitions[t]->guard_signals;
+  }
+
+  for (size_t i = 0; deferral && i < num_states; ++i) {
+    uint32_t *bits = &defers[i * chart->_event_words];
+    for (size_t w = 0; w < chart->_event_words; ++w) {
+      bits[w] = 0;
+    }
+    for (EventType e = 1; e < chart->num_events; ++e) {
+      if (defers_event(chart, &states[i], e)) {
+        bits[e / 32] |= UINT32_C(1) << (e % 32);
+      }
+    }
+  }
+
+  for (size_t i = 0; run_filter && i < num_states; ++i) {
+    uint32_t *bits = &run_events[i * chart->_event_words];
+    EventType const *list = states[i].config->run_events;
+    for (size_t w = 0; w < chart->_event_words; ++w) {
+      bits[w] = list ? 0 : UINT32_MAX;
+    }
+    for (size_t k = 0, len = event_list_len(list); k < len; ++k) {
+      if (list[k] > 0) {
+        bits[list[k] / 32] |= UINT32_C(1) << (list[k] % 32);
+      }
+    }
+    bits[0] = states[i].config->run_no_ticks ? bits[0] & ~UINT32_C(1) : bits[0] | 1;
+  }
+
+  // Timers grouped by the state whose entry arms them
+  size_t timer = 0;
+  for (size_t i = 0; num_timers && i < num_states; ++i) {
+    timer_begin[i] = (uint16_t)timer;
+    for (size_t t = 0; t < num_transitions; ++t) {
+      if (transitions[t]->after && transitions[t]->from == &states[i]) {
+        timer_transition[timer++] = (uint16_t)t;
+      }
+    }
+  }
+  if (num_timers) {
+    timer_begin[num_states] = (uint16_t)timer;
+  }
+
+  chart->num_transitions = num_transitions;
+  chart->_transitions = transitions;
+  chart->_compact_transitions = compact_transitions;
+  chart->_compact_states = compact_states;
+  chart->_functions = functions;
+  chart->_num_functions = num_functions;
+  chart->_handles = handles;
+  chart->_run_base = run_base;
+  chart->_runs = runs;
+  chart->_candidates = candidates;
+  chart->_num_runs = num_runs;
+  chart->_exclusive_runs = exclusive_runs;
+  chart->_parent = parent;
+  chart->_depth = depth;
+  chart->_branch_runs = branch_runs;
+  chart->_paths = paths;
+  chart->_path_states = path_states;
+  chart->_history_slot = history_slot;
+  chart->_first_child = first_child;
+  chart->_next_sibling = next_sibling;
+  chart->_guard_cache = guard_cache;
+  chart->_guard_signals = guard_signals;
+  chart->_defers = defers;
+  chart->_run_events = run_events;
+  chart->_tick_slot = tick_slot;
+  chart->num_timers = num_timers;
+  chart->_timer_begin = timer_begin;
+  chart->_timer_transition = timer_transition;
+
+  return arena.used;
+}
+
+/**
+ * \brief One micro-step of a chart without regions
+ *
+ * Takes a transition for `trigger`, else runs the run functions with `event`.
+ *
+ * \return  Whether the state changed, i.e. another micro-step is needed.
+ */
+static bool step_tree(Machine *const sm, Event const *trigger, Event const *event) {
+  Chart const *const chart = sm->chart;
+  uint16_t const t = find_transition(sm, sm->_leaf, trigger);
+
+  if (t == NO_TRANSITION) {
+    // Without run functions the check after a transition is a single bit test in most states
+    if (!chart->_branch_runs[sm->_leaf]) {
+      return false;
+    }
+    // Run all "run" functions including parents, change if requested
+    State const *requested_state = ancestors_run(sm, event);
+    if (!requested_state) {
+      return false;
+    }
+    // Transitions requested by run functions start at the active leaf
+    execute_dynamic(sm, NULL, sm->_leaf, requested_state, trigger);
+    return true;
+  }
+
+  struct CompactTransition const *transition = &chart->_compact_transitions[t];
+  TRACE(SC_TRACE_TRANSITION, sm, trigger->type, transition->from, transition->to, false);
+  STATS(transition, sm, t);
+  if (chart->_paths[t].dynamic) {
+    execute_dynamic(sm, chart->_transitions[t], transition->from, &chart->states[transition->to],
+                    trigger);
+  } else {
+    execute_path(sm, transition, &chart->_paths[t], trigger);
+  }
+  return true;
+}
+
+/** \brief sc_run() for charts without regions. */
+static State const *run_tree(Machine *const sm, Event const *event) {
+  static Event const no_event = {.type = SC_NO_EVENT};
+
+  // After the event, check transitions of the current state with no event
+  for (Event const *trigger = event; step_tree(sm, trigger, event); trigger = &no_event) {
+  }
+
+  return &sm->chart->states[sm->_leaf];
+}
+
+/** \brief Runs an event to completion. */
+static void run_event(Machine *const sm, Event const *event) {
+  next_guard_stamp(sm);
+  if (sm->chart->_config_words) {
+    run_regions(sm, event);
+  } else {
+    run_tree(sm, event);
+  }
+}
+
+/* -------- Adaptive order -------- */
+
+/** \brief Number of candidates of all runs. */
+static size_t num_candidates(Chart const *const chart) { return chart->_runs[chart->_num_runs]; }
+
+static uint32_t hits_of(Chart const *const chart, uint32_t c) {
+  return atomic_load_explicit(&chart->_hits[c], memory_order_relaxed);
+}
+
+static void set_hits(Chart const *const chart, uint32_t c, uint32_t hits) {
+  atomic_store_explicit(&chart->_hits[c], hits, memory_order_relaxed);
+}
+
+/** \brief Whether the candidates of a run can be tested in any order. */
+static bool is_exclusive_run(Chart const *const chart, size_t run) {
+  return chart->_exclusive_runs &&
+         (chart->_exclusive_runs[run / 32] & (UINT32_C(1) << (run % 32)));
+}
+
+/** \brief Candidates in the arena of sc_compile(), writable for exclusive runs. */
+static uint16_t *writable_candidates(Chart *const chart) { return (uint16_t *)chart->_candidates; }
+
+/** \brief Stable sort of a run by hits, most first. Returns whether the order changed. */
+static bool sort_run(Chart *const chart, size_t run) {
+  uint16_t *const candidates = writable_candidates(chart);
+  uint32_t const begin = chart->_runs[run];
+  bool changed = false;
+  for (uint32_t c = begin + 1; c < chart->_runs[run + 1]; ++c) {
+    uint16_t const id = candidates[c];
+    uint32_t const hits = hits_of(chart, c);
+    uint32_t k = c;
+    for (; k > begin && hits_of(chart, k - 1) < hits; --k) {
+      candidates[k] = candidates[k - 1];
+      set_hits(chart, k, hits_of(chart, k - 1));
+    }
+    candidates[k] = id;
+    set_hits(chart, k, hits);
+    changed |= k != c;
+  }
+  return changed;
+}
+
+/** \brief Whether a run of `order` only reorders the candidates of the chart. */
+static bool valid_order(Chart const *const chart, size_t run, uint16_t const order[]) {
+  uint32_t const begin = chart->_runs[run];
+  uint32_t const end = chart->_runs[run + 1];
+  bool const exclusive = is_exclusive_run(chart, run);
+  for (uint32_t c = begin; c < end; ++c) {
+    if (!exclusive && order[c] != chart->_candidates[c]) {
+      return false;
+    }
+    // Transition ids are unique within a run
+    size_t in_chart = 0;
+    size_t in_order = 0;
+    for (uint32_t k = begin; k < end; ++k) {
+      in_chart += chart->_candidates[k] == order[c];
+      in_order += order[k] == order[c];
+    }
+    if (in_chart != 1 || in_order != 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* -------- Deferred events -------- */
+
+static bool defer_bit(Chart const *const chart, StateId id, EventType type) {
+  uint32_t const *const bits = &chart->_defers[id * chart->_event_words];
+  return bits[type / 32] & (UINT32_C(1) << (type % 32));
+}
+
+/** \brief Whether the active configuration defers an event type. With regions any leaf may. */
+static bool is_deferred(Machine const *const sm, EventType type) {
+  Chart const *const chart = sm->chart;
+  if (!chart->_defers || type <= 0 || type >= chart->num_events) {
+    return false;
+  }
+  if (!chart->_config_words) {
+    return defer_bit(chart, sm->_leaf, type);
+  }
+  StateId const *const active = config_bits(sm);
+  for (StateId id = 0; id < chart->num_states; ++id) {
+    if (bit_test(active, id) && active_child(sm, id) == SC_NO_STATE &&
+        defer_bit(chart, id, type)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/** \brief Number of 16 bit words of the bitmap of waiting event types. 0 if nothing defers. */
+static size_t waiting_words(Chart const *const chart) {
+  return chart->_defers ? ((size_t)chart->num_events + 15) / 16 : 0;
+}
+
+/** \brief Recomputes the bitmap of event types in the deferral storage. */
+static void mark_deferred(Machine *const sm) {
+  Chart const *const chart = sm->chart;
+  StateId *const waiting = &sm->_slots[chart->_defer_slot];
+  for (size_t w = 0; w < waiting_words(chart); ++w) {
+    waiting[w] = 0;
+  }
+  for (size_t i = 0; i < sm->_deferred_count; ++i) {
+    bit_set(waiting, (StateId)sm->_deferred[i].type);
+  }
+}
+
+/** \brief Stores an event if the configuration defers it. Returns whether it is not to be run. */
+static bool defer(Machine *const sm, Event const *event) {
+  if (!sm->_deferred_capacity || !is_deferred(sm, event->type)) {
+    return false;
+  }
+  if (sm->_deferred_count == sm->_deferred_capacity) {
+    sm->_deferred_dropped++;
+    return true;
+  }
+  sm->_deferred[sm->_deferred_count++] = *event;
+  bit_set(&sm->_slots[sm->chart->_defer_slot], (StateId)event->type);
+  return true;
+}
+
+/**
+ * \brief Runs the oldest stored event which the configuration no longer defers
+ *
+ * Only the bitmap of waiting types is tested, the storage is searched when one of them is free.
+ *
+ * \return  Whether an event ran.
+ */
+static bool recall(Machine *const sm) {
+  Chart const *const chart = sm->chart;
+  StateId const *const waiting = &sm->_slots[chart->_defer_slot];
+  if (!sm->_deferred_count) {
+    return false;
+  }
+
+  bool any = false;
+  for (size_t w = 0; !any && w < waiting_words(chart); ++w) {
+    for (uint32_t bits = waiting[w]; bits && !any; bits &= bits - 1) {
+      any = !is_deferred(sm, (EventType)(16 * w + lowest_bit(bits)));
+    }
+  }
+  if (!any) {
+    return false;
+  }
+
+  size_t i = 0;
+  while (i < sm->_deferred_count && is_deferred(sm, sm->_deferred[i].type)) {
+    ++i;
+  }
+  if (i == sm->_deferred_count) {
+    return false;
+  }
+  Event const event = sm->_deferred[i];
+  for (--sm->_deferred_count; i < sm->_deferred_count; ++i) {
+    sm->_deferred[i] = sm->_deferred[i + 1];
+  }
+  mark_deferred(sm);
+
+  TRACE(SC_TRACE_EVENT, sm, event.type, sm->_leaf, SC_NO_STATE, false);
+  run_event(sm, &event);
+  return true;
+}
+
+/* -------- Stepping -------- */
+
+/** \brief No stepped run pending. */
+#define STEP_IDLE 0
+/** \brief sc_begin() event not processed yet. */
+#define STEP_EVENT 1
+/** \brief Completion steps pending. */
+#define STEP_COMPLETION 2
+
+/** \brief Monotonic nanoseconds for sc_run_budget(). */
+static uint64_t monotonic_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * \brief FNV-1a hash of the configuration of a machine: Leaf, history and active regions
+ *
+ * The path follows from the leaf. Guard cache, deferral bitmap and tick counters are left out,
+ * they do not decide which state the machine is in.
+ */
+static uint32_t configuration_key(Machine const *const sm) {
+  Chart const *const chart = sm->chart;
+  uint32_t h = fnv_mix(2166136261u, sm->_leaf);
+  for (size_t i = 0; i < chart->_path_slot; ++i) {
+    h = fnv_mix(h, sm->_slots[i]);
+  }
+  for (size_t w = 0; w < chart->_config_words; ++w) {
+    h = fnv_mix(h, config_bits(sm)[w]);
+  }
+  return h;
+}
+
+/**
+ * \brief Brent's cycle detection over the configurations after each micro-step
+ *
+ * Remembers the configuration at every power of two steps. Seeing it again means the steps
+ * since then form a cycle, found within two rounds of the cycle.
+ */
+static bool detect_cycle(Machine *const sm) {
+  uint32_t const key = configuration_key(sm);
+  // Keys of different configurations may collide, those of different leaves do not count
+  if (sm->_cycle_length && key == sm->_cycle_key && sm->_leaf == sm->_cycle_leaf) {
+    return true;
+  }
+  if (sm->_cycle_length == sm->_cycle_power) {
+    sm->_cycle_key = key;
+    sm->_cycle_leaf = sm->_leaf;
+    sm->_cycle_power = sm->_cycle_power ? 2 * sm->_cycle_power : 1;
+    sm->_cycle_length = 0;
+  }
+  ++sm->_cycle_length;
+  return false;
+}
+
+/* -------- Event queue -------- */
+
+/** \brief Coalescing policy of an event type. */
+static CoalescePolicy coalesce_policy(Machine const *const sm, EventType type) {
+  if (!sm->_coalesce || type <= 0 || type >= sm->chart->num_events) {
+    return SC_COALESCE_NONE;
+  }
+  return sm->_coalesce[type];
+}
+
+/** \brief Merges a posted event into the queued one of its type. Returns whether it did. */
+static bool coalesce(Machine *const sm, Event const *event) {
+  CoalescePolicy const policy = coalesce_policy(sm, event->type);
+  if (policy == SC_COALESCE_NONE || sm->_coalesce_queued[event->type] == SC_NO_STATE) {
+    return false;
+  }
+  Event *const queued = &sm->_queue[sm->_coalesce_queued[event->type]];
+  if (policy == SC_COALESCE_LATEST) {
+    *queued = *event;
+  } else if (policy == SC_COALESCE_COUNT) {
+    queued->count++;
+  }
+  sm->_coalesced[event->type]++;
+  return true;
+}
+
+/** \brief Remembers where a newly queued event is, so later ones of its type can merge. */
+static void track_queued(Machine *const sm, uint16_t index) {
+  Event *const event = &sm->_queue[index];
+  CoalescePolicy const policy = coalesce_policy(sm, event->type);
+  if (policy == SC_COALESCE_NONE) {
+    return;
+  }
+  sm->_coalesce_queued[event->type] = index;
+  if (policy == SC_COALESCE_COUNT) {
+    event->count = 1;
+  }
+}
+
+/** \brief Forgets the queued events of all types. */
+static void forget_queued(Machine *const sm) {
+  for (EventType e = 0; sm->_coalesce && e < sm->chart->num_events; ++e) {
+    sm->_coalesce_queued[e] = SC_NO_STATE;
+  }
+}
+
+/* -------- Snapshot checks -------- */
+
+/** \brief Bit of a state in a configuration bitset as stored in a snapshot. */
+static bool snapshot_bit(unsigned char const *bits, StateId id) {
+  return get_u16(&bits[2 * (id / 16)]) & (1u << (id % 16));
+}
+
+/**
+ * \brief Whether a stored configuration is one the machine can be in, `leaf` its first leaf
+ *
+ * Every active state has an active parent. Parallel states have all regions active, other
+ * states one substate, or none if they have no initial state.
+ */
+static bool valid_snapshot_configuration(Chart const *const chart, unsigned char const *bits,
+                                         StateId leaf) {
+  StateId const root = state_id(chart, chart->root);
+  if (!snapshot_bit(bits, root)) {
+    return false;
+  }
+  for (size_t id = chart->num_states; id < 16 * chart->_config_words; ++id) {
+    if (snapshot_bit(bits, (StateId)id)) {
+      return false;
+    }
+  }
+  for (StateId id = 0; id < chart->num_states; ++id) {
+    if (!snapshot_bit(bits, id)) {
+      continue;
+    }
+    if (id != root && (!is_substate(chart, id) || !snapshot_bit(bits, chart->_parent[id]))) {
+      return false;
+    }
+    size_t active = 0;
+    size_t substates = 0;
+    for (StateId c = chart->_first_child[id]; c != SC_NO_STATE; c = chart->_next_sibling[c]) {
+      substates += is_substate(chart, c);
+      active += snapshot_bit(bits, c);
+    }
+    StateConfig const *const config = chart->states[id].config;
+    if (config->type == SC_TYPE_PARALLEL ? active != substates
+                                         : active > 1 || (!active && config->initial)) {
+      return false;
+    }
+  }
+
+  // Like first_leaf(): Down the first active child
+  StateId first = root;
+  for (StateId c = root; c != SC_NO_STATE;) {
+    first = c;
+    for (c = chart->_first_child[first]; c != SC_NO_STATE && !snapshot_bit(bits, c);
+         c = chart->_next_sibling[c]) {
+    }
+  }
+  return first == leaf;
+}
+
+/** \brief Whether leaf, history and active configuration of a snapshot fit the chart. */
+static bool valid_snapshot_states(Chart const *const chart, unsigned char const *slots,
+                                  StateId leaf) {
+  if (leaf >= chart->num_states || chart->states[leaf].config->type != SC_TYPE_NORMAL ||
+      chart->states[leaf].config->initial) {
+    return false;
+  }
+  for (StateId id = 0; id < chart->num_states; ++id) {
+    StateId const slot = chart->_history_slot[id];
+    StateId const child = slot != SC_NO_STATE ? get_u16(&slots[2 * slot]) : SC_NO_STATE;
+    if (child != SC_NO_STATE && (child >= chart->num_states || chart->_parent[child] != id ||
+                                 !is_substate(chart, child))) {
+      return false;
+    }
+  }
+  return !chart->_config_words ||
+         valid_snapshot_configuration(chart, &slots[2 * chart->_config_slot], leaf);
+}
+
+/* -------- Statistics -------- */
+
+#ifdef HSM4C_STATS
+/**
+ * \brief Counts the active states as entered or exited now, without entry or exit functions.
+ *
+ * For sc_init() and sc_restore(), which replace the active states of a running machine. Keeps
+ * the residency of the replaced states from growing on.
+ */
+static void stats_active(Machine *const sm, bool entered) {
+  Chart const *const chart = sm->chart;
+  ChartStats *const stats = chart->_stats;
+  StateId const root_id = state_id(chart, chart->root);
+  if (!stats) {
+    return;
+  }
+  uint64_t const now = sc_stats_now_(stats);
+  if (chart->_config_words) {
+    for (StateId id = 0; bit_test(config_bits(sm), root_id) && id < chart->num_states; ++id) {
+      if (bit_test(config_bits(sm), id)) {
+        entered ? sc_stats_entry_(stats, id, now, false) : sc_stats_exit_(stats, id, now, false);
+      }
+    }
+  } else if (sm->_leaf != root_id) {
+    // Before the first sc_init() the leaf is the root, nothing was entered
+    for (StateId id = sm->_leaf; id != SC_NO_STATE; id = chart->_parent[id]) {
+      entered ? sc_stats_entry_(stats, id, now, false) : sc_stats_exit_(stats, id, now, false);
+    }
+  }
+}
+#endif
+
+/* -------- Public -------- */
+
+size_t sc_learn_order(Chart *chart, void *mem, size_t mem_size) {
+  size_t const size = chart->_exclusive_runs ? num_candidates(chart) * sizeof(*chart->_hits) : 0;
+  chart->_hits = NULL;
+  if (!mem || !size || size > mem_size) {
+    return size;
+  }
+
+  _Atomic uint32_t *const hits = mem;
+  for (size_t c = 0; c < num_candidates(chart); ++c) {
+    atomic_init(&hits[c], 0);
+  }
+  chart->_hits = hits;
+  return size;
+}
+
+size_t sc_adapt_order(Chart *chart) {
+  if (!chart->_hits) {
+    return 0;
+  }
+  size_t changed = 0;
+  for (size_t run = 0; run < chart->_num_runs; ++run) {
+    changed += is_exclusive_run(chart, run) && sort_run(chart, run);
+  }
+  for (uint32_t c = 0; c < num_candidates(chart); ++c) {
+    set_hits(chart, c, hits_of(chart, c) / 2);
+  }
+  return changed;
+}
+
+size_t sc_export_order(Chart const *chart, uint16_t order[], size_t len) {
+  size_t const n = num_candidates(chart);
+  for (size_t c = 0; order && n <= len && c < n; ++c) {
+    order[c] = chart->_candidates[c];
+  }
+  return n;
+}
+
+bool sc_import_order(Chart *chart, uint16_t const order[], size_t len) {
+  if (len != num_candidates(chart)) {
+    return false;
+  }
+  for (size_t run = 0; run < chart->_num_runs; ++run) {
+    if (!valid_order(chart, run, order)) {
+      return false;
+    }
+  }
+
+  // Only exclusive runs differ, charts without are left untouched
+  for (size_t run = 0; run < chart->_num_runs; ++run) {
+    if (!is_exclusive_run(chart, run)) {
+      continue;
+    }
+    for (uint32_t c = chart->_runs[run]; c < chart->_runs[run + 1]; ++c) {
+      writable_candidates(chart)[c] = order[c];
+      if (chart->_hits) {
+        set_hits(chart, c, 0);
+      }
+    }
+  }
+  return true;
+}
+
+void sc_machine_init(Machine *sm, Chart const *chart, StateId slots[], void *ctx) {
+  *sm = (Machine){.chart = chart, .ctx = ctx, ._slots = slots};
+  clear_slots(chart, slots);
+  set_leaf(sm, state_id(chart, chart->root));
+}
+
+void sc_set_init(MachineSet *set, Chart const *chart, uint32_t count, StateId leaf[],
+                 StateId slots[], void *ctx[]) {
+  *set = (MachineSet){.chart = chart, .count = count, .leaf = leaf, .slots = slots, .ctx = ctx};
+  for (uint32_t i = 0; i < count; ++i) {
+    Machine sm = set_member(set, i);
+    clear_slots(chart, sm._slots);
+    set_leaf(&sm, state_id(chart, chart->root));
+    leaf[i] = sm._leaf;
+  }
+}
+
+void sc_init_batch(MachineSet *set) {
+  for (uint32_t i = 0; i < set->count; ++i) {
+    Machine sm = set_member(set, i);
+    sc_init(&sm);
+    set->leaf[i] = sm._leaf;
+  }
+}
+
+void sc_run_batch(MachineSet *set, uint32_t const machines[], EventType const events[], size_t n,
+                  StateId leaves[], uint32_t scratch[]) {
+  uint32_t *const order = scratch;
+
+  sort_by_leaf(set, machines, n, order, &scratch[n]);
+
+  for (size_t k = 0; k < n; ++k) {
+    uint32_t const entry = order[k];
+    uint32_t const i = machines[entry];
+    Machine sm = set_member(set, i);
+    sc_run(&sm, events[entry]);
+    set->leaf[i] = sm._leaf;
+    if (leaves) {
+      leaves[entry] = sm._leaf;
+    }
+  }
+}
+
+void sc_machine_deferral(Machine *sm, Event events[], uint16_t capacity) {
+  sm->_deferred = events;
+  sm->_deferred_capacity = capacity;
+  sm->_deferred_count = 0;
+  sm->_deferred_dropped = 0;
+  mark_deferred(sm);
+}
+
+size_t sc_deferred_count(Machine const *sm) { return sm->_deferred_count; }
+
+uint32_t sc_deferred_dropped(Machine const *sm) { return sm->_deferred_dropped; }
+
+void sc_machine_queue(Machine *sm, Event queue[], uint16_t capacity) {
+  sm->_queue = queue;
+  sm->_queue_capacity = capacity;
+  sm->_queue_head = 0;
+  sm->_queue_count = 0;
+  forget_queued(sm);
+}
+
+void sc_machine_coalescing(Machine *sm, CoalescePolicy const policy[], uint16_t queued[],
+                           uint32_t coalesced[]) {
+  sm->_coalesce = policy;
+  sm->_coalesce_queued = queued;
+  sm->_coalesced = coalesced;
+  for (EventType e = 0; e < sm->chart->num_events; ++e) {
+    coalesced[e] = 0;
+  }
+  forget_queued(sm);
+  // Events already queued merge like posted ones
+  for (uint16_t k = 0; k < sm->_queue_count; ++k) {
+    uint32_t index = (uint32_t)sm->_queue_head + k;
+    if (index >= sm->_queue_capacity) {
+      index -= sm->_queue_capacity;
+    }
+    track_queued(sm, (uint16_t)index);
+  }
+}
+
+State const *sc_init(Machine *sm) {
+  Chart const *const chart = sm->chart;
+  State const *root = chart->root;
+  StateId const root_id = state_id(chart, root);
+
+  // Nothing is active yet, timers and deferred events of a previous run are stale
+  STATS_ACTIVE(sm, false);
+  for (size_t k = 0; sm->_wheel && k < chart->num_timers; ++k) {
+    sc_timer_cancel_(sm->_wheel, &sm->_timers[k]);
+  }
+  sm->_deferred_count = 0;
+  mark_deferred(sm);
+
+  if (chart->_config_words) {
+    StateId *const active = config_bits(sm);
+    for (size_t w = 0; w < chart->_config_words; ++w) {
+      active[w] = 0;
+    }
+    bit_set(active, root_id);
+  }
+  call_entry(sm, root_id);
+  if (chart->_config_words) {
+    enter_default(sm, root_id);
+    set_leaf(sm, first_leaf(sm, root_id));
+  } else {
+    set_leaf(sm, walk_down_init(sm, root_id));
+  }
+  return &chart->states[sm->_leaf];
+}
+
+void sc_map_stateconfig_to_states(size_t num_states, State states[num_states],
+                                  StateConfig const statecfgs[num_states]) {
+  for (size_t i = 0; i < num_states; ++i) {
+    states[i].config = &statecfgs[i];
+  }
+}
+
+void sc_reset_state(Machine *sm, State const *state) {
+  set_history(sm, state_id(sm->chart, state), SC_NO_STATE);
+}
+
+State const *sc_get_root(State const *s) { return find_root(s); }
+
+size_t sc_snapshot_size(Chart const *chart) {
+  return 2 * (SNAPSHOT_HEADER + chart->machine_slots) + 8 * chart->num_timers;
+}
+
+size_t sc_snapshot(Machine const *sm, void *buf, size_t size) {
+  Chart const *const chart = sm->chart;
+  size_t const needed = sc_snapshot_size(chart);
+  if (size < needed) {
+    return 0;
+  }
+
+  unsigned char *p = buf;
+  p = put_u16(p, SNAPSHOT_VERSION);
+  p = put_u16(p, (uint16_t)chart->num_states);
+  p = put_u16(p, (uint16_t)chart->machine_slots);
+  p = put_u16(p, (uint16_t)chart->num_timers);
+  p = put_u16(p, sm->_leaf);
+  uint32_t const fingerprint = chart_fingerprint(chart);
+  p = put_u16(p, (uint16_t)fingerprint);
+  p = put_u16(p, (uint16_t)(fingerprint >> 16));
+  for (size_t i = 0; i < chart->machine_slots; ++i) {
+    // Cached guards may depend on anything outside the machine, see sc_restore()
+    bool const guard = i >= chart->_guard_slot && i < chart->_config_slot;
+    p = put_u16(p, guard ? GUARD_UNKNOWN : sm->_slots[i]);
+  }
+  for (size_t k = 0; k < chart->num_timers; ++k) {
+    Timer const *const timer = sm->_wheel ? &sm->_timers[k] : NULL;
+    bool const armed = timer && timer->_prev;
+    p = put_u64(p, armed ? timer->_deadline - sm->_wheel->_now : SNAPSHOT_UNARMED);
+  }
+  return needed;
+}
+
+bool sc_restore(Machine *sm, void const *buf, size_t size) {
+  Chart const *const chart = sm->chart;
+  unsigned char const *const p = buf;
+  if (size != sc_snapshot_size(chart) || get_u16(p) != SNAPSHOT_VERSION ||
+      get_u16(p + 2) != chart->num_states || get_u16(p + 4) != chart->machine_slots ||
+      get_u16(p + 6) != chart->num_timers ||
+      (get_u16(p + 10) | (uint32_t)get_u16(p + 12) << 16) != chart_fingerprint(chart)) {
+    return false;
+  }
+
+  StateId const leaf = get_u16(p + 8);
+  unsigned char const *const slots = p + 2 * SNAPSHOT_HEADER;
+  unsigned char const *const timers = slots + 2 * chart->machine_slots;
+  if (!valid_snapshot_states(chart, slots, leaf)) {
+    return false;
+  }
+  for (size_t k = 0; k < chart->num_timers; ++k) {
+    uint64_t const remaining = get_u64(&timers[8 * k]);
+    if (remaining != SNAPSHOT_UNARMED && remaining > UINT32_MAX) {
+      return false;
+    }
+  }
+
+  STATS_ACTIVE(sm, false);
+  // Path, scratch configuration and deferral bitmap follow from the rest. Guards are asked again.
+  clear_slots(chart, sm->_slots);
+  size_t const scratch = chart->_config_slot + chart->_config_words;
+  size_t const ticks = chart->_defer_slot + waiting_words(chart);
+  for (size_t i = 0; i < chart->machine_slots; ++i) {
+    if (i < chart->_path_slot || (i >= chart->_config_slot && i < scratch) || i >= ticks) {
+      sm->_slots[i] = get_u16(&slots[2 * i]);
+    }
+  }
+  set_leaf(sm, leaf);
+  STATS_ACTIVE(sm, true);
+  // Deferred events are not part of a snapshot, the machine keeps its own
+  mark_deferred(sm);
+  for (size_t k = 0; sm->_wheel && k < chart->num_timers; ++k) {
+    uint64_t const remaining = get_u64(&timers[8 * k]);
+    sc_timer_cancel_(sm->_wheel, &sm->_timers[k]);
+    if (remaining != SNAPSHOT_UNARMED) {
+      sc_timer_arm_(sm->_wheel, &sm->_timers[k], (uint32_t)remaining);
+    }
+  }
+  return true;
+}
+
+void sc_signal(Machine *sm, uint32_t signals) {
+  Chart const *const chart = sm->chart;
+  for (size_t i = chart->_guard_slot + 1; chart->_guard_cache && i < chart->_config_slot; ++i) {
+    if (chart->_guard_signals[i - chart->_guard_slot - 1] & signals) {
+      sm->_slots[i] = GUARD_UNKNOWN;
+    }
+  }
+}
+
+bool sc_is_in(Machine const *sm, State const *state) {
+  Chart const *const chart = sm->chart;
+  StateId const id = state_id(chart, state);
+  uint16_t const depth = chart->_depth[id];
+  if (chart->_config_words) {
+    return bit_test(config_bits(sm), id);
+  }
+  return depth <= chart->_depth[sm->_leaf] && sm->_slots[chart->_path_slot + depth] == id;
+}
+
+StateId const *sc_active_path(Machine const *sm, size_t *len) {
+  *len = (size_t)sm->chart->_depth[sm->_leaf] + 1;
+  return &sm->_slots[sm->chart->_path_slot];
+}
+
+State const *sc_run(Machine *sm, EventType event) {
+  return sc_run_event(sm, &(Event const){.type = event});
+}
+
+State const *sc_run_event(Machine *sm, Event const *event) {
+  STATS_START(sm, start);
+  TRACE(SC_TRACE_EVENT, sm, event->type, sm->_leaf, SC_NO_STATE, false);
+
+  if (!defer(sm, event)) {
+    run_event(sm, event);
+    while (recall(sm)) {
+    }
+  }
+
+  STATS(run, sm, start);
+  return &sm->chart->states[sm->_leaf];
+}
+
+void sc_begin(Machine *sm, Event const *event) {
+  TRACE(SC_TRACE_EVENT, sm, event->type, sm->_leaf, SC_NO_STATE, false);
+  next_guard_stamp(sm);
+  sm->_event = *event;
+  sm->_step = STEP_EVENT;
+  sm->_cycle_power = 0;
+  sm->_cycle_length = 0;
+}
+
+StepResult sc_step(Machine *sm) {
+  static Event const no_event = {.type = SC_NO_EVENT};
+  Chart const *const chart = sm->chart;
+  if (sm->_step == STEP_IDLE) {
+    return SC_STEP_DONE;
+  }
+
+  Event const *const trigger = sm->_step == STEP_EVENT ? &sm->_event : &no_event;
+  bool changed;
+  if (chart->_config_words) {
+    changed = step_regions(sm, trigger, &sm->_event);
+    set_leaf(sm, first_leaf(sm, state_id(chart, chart->root)));
+  } else {
+    changed = step_tree(sm, trigger, &sm->_event);
+  }
+
+  if (!changed) {
+    sm->_step = STEP_IDLE;
+    return SC_STEP_DONE;
+  }
+  sm->_step = STEP_COMPLETION;
+  return detect_cycle(sm) ? SC_STEP_CYCLE : SC_STEP_PENDING;
+}
+
+StepResult sc_run_budget(Machine *sm, size_t max_steps, uint64_t max_ns) {
+  uint64_t const start = max_ns ? monotonic_ns() : 0;
+  StepResult result = sm->_step == STEP_IDLE ? SC_STEP_DONE : SC_STEP_PENDING;
+  for (size_t n = 0; n < max_steps && result == SC_STEP_PENDING; ++n) {
+    result = sc_step(sm);
+    if (max_ns && monotonic_ns() - start >= max_ns) {
+      break;
+    }
+  }
+  return result;
+}
+
+bool sc_post(Machine *sm, EventType event) {
+  return sc_post_event(sm, &(Event const){.type = event});
+}
+
+bool sc_post_front(Machine *sm, EventType event) {
+  return sc_post_front_event(sm, &(Event const){.type = event});
+}
+
+bool sc_post_event(Machine *sm, Event const *event) {
+  if (coalesce(sm, event)) {
+    return true;
+  }
+  if (sm->_queue_count == sm->_queue_capacity) {
+    return false;
+  }
+  uint32_t tail = (uint32_t)sm->_queue_head + sm->_queue_count;
+  if (tail >= sm->_queue_capacity) {
+    tail -= sm->_queue_capacity;
+  }
+  sm->_queue[tail] = *event;
+  sm->_queue_count++;
+  track_queued(sm, (uint16_t)tail);
+  return true;
+}
+
+bool sc_post_front_event(Machine *sm, Event const *event) {
+  if (sm->_queue_count == sm->_queue_capacity) {
+    return false;
+  }
+  sm->_queue_head = sm->_queue_head ? sm->_queue_head - 1 : sm->_queue_capacity - 1;
+  sm->_queue[sm->_queue_head] = *event;
+  sm->_queue_count++;
+  // Not merged either way, later posts keep merging into the queued event at the back
+  if (coalesce_policy(sm, event->type) == SC_COALESCE_COUNT) {
+    sm->_queue[sm->_queue_head].count = 1;
+  }
+  return true;
+}
+
+size_t sc_dispatch_all(Machine *sm) {
+  size_t processed = 0;
+
+  if (sm->_dispatching) {
+    return 0;
+  }
+  sm->_dispatching = true;
+
+  while (sm->_queue_count) {
+    // Copy out, the slot may be reused by posts while running
+    Event const event = sm->_queue[sm->_queue_head];
+    if (coalesce_policy(sm, event.type) != SC_COALESCE_NONE &&
+        sm->_coalesce_queued[event.type] == sm->_queue_head) {
+      sm->_coalesce_queued[event.type] = SC_NO_STATE;
+    }
+    sm->_queue_head = sm->_queue_head + 1 == sm->_queue_capacity ? 0 : sm->_queue_head + 1;
+    sm->_queue_count--;
+    sc_run_event(sm, &event);
+    processed++;
+  }
+
+  sm->_dispatching = false;
+  return processed;
+}
+
+void sc_execute_dynamic_(Machine *sm, Transition const *t, State const *to, Event const *event) {
+  execute_dynamic(sm, t, t ? state_id(sm->chart, t->from) : sm->_leaf, to, event);
 }
@@ -16,9 +16,14 @@
  * - History and Deep History pseudo states with initial state.
  * - Choice pseudo states.
  * - Relatively easy table based syntax. (See tests).
- *
- * Does not support:
- * - Parallel states
+ * - Any number of machines running one shared, read only chart.
+ * - Orthogonal regions (parallel states).
+ * - Time triggered transitions. See hsm4c_timer.h.
+ * - Deferred events.
+ * - Event queue with per type coalescing.
+ * - Run functions polled on every n-th tick or for selected events only.
+ * - Evaluation order of exclusive transitions adapted to the traffic.
+ * - Lock-free event inbox for other threads and signal handlers. See hsm4c_inbox.h.
  *
  * (C) 2023 David Bongartz
  * MIT License
@@ -28,12 +33,24 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 typedef struct State State;
 typedef struct StateConfig StateConfig;
 typedef struct Transition Transition;
+typedef struct Chart Chart;
+typedef struct Machine Machine;
+typedef struct ChartStats ChartStats;
+typedef struct TimerWheel TimerWheel;
+typedef struct Timer Timer;
 typedef int EventType;
 
+/** \brief Index of a state in the state array of a chart */
+typedef uint16_t StateId;
+
+/** \brief No state. E.g. parent of root. */
+#define SC_NO_STATE ((StateId)UINT16_MAX)
+
 /** \brief State Types */
 typedef enum StateType {
   /** \brief Default (compund) state type */
@@ -76,6 +93,15 @@ typedef enum StateType {
    * Must have no parent (NULL).
    */
   SC_TYPE_ROOT,
+
+  /**
+   * \brief Parallel state with orthogonal regions.
+   *
+   * Every child which is not a pseudo state is a region. All regions are active at the same time
+   * and get every event, in state array order. A transition in a region blocks transitions of
+   * the other regions which would exit it within the same event. Initial is ignored.
+   */
+  SC_TYPE_PARALLEL,
 } StateType;
 
 /** \brief Transition Types */
@@ -99,59 +125,104 @@ typedef enum TransitionType {
 
 /** \brief Special events. Must be <= 0 */
 typedef enum ScEvents {
-  /** \brief Use this for event-less / automatic transitions. */
+  /**
+   * \brief Use this for event-less / automatic transitions.
+   *
+   * Automatic transitions are checked after every transition and by `sc_run()` with SC_NO_EVENT,
+   * not by lookups for other events.
+   */
   SC_NO_EVENT = 0,
+  /**
+   * \brief A timer of a time triggered transition fired. Data is the Timer. Library only.
+   *
+   * Never passed to run functions.
+   */
+  SC_TIMEOUT = -1,
 } ScEvents;
 
+/** \brief How a posted event merges with a queued one of its type. */
+typedef enum CoalescePolicy {
+  /** \brief Every posted event is queued (default). */
+  SC_COALESCE_NONE = 0,
+  /** \brief The posted event replaces the queued one, which keeps its place in the queue. */
+  SC_COALESCE_LATEST,
+  /** \brief The queued event counts the posts it stands for in `count`. Keeps the first payload. */
+  SC_COALESCE_COUNT,
+  /** \brief The posted event is dropped. */
+  SC_COALESCE_DROP,
+} CoalescePolicy;
+
+/**
+ * \brief Event with optional payload
+ *
+ * Passed by reference to run functions, guards and transition actions. The payload is never
+ * copied by the library, it must stay valid until the event has been processed.
+ */
+typedef struct Event {
+  /** \brief Event type. Must be positive or one of ScEvents */
+  EventType type;
+  /** \brief Payload size in bytes */
+  uint32_t size;
+  /** \brief Number of posts merged into this event by SC_COALESCE_COUNT. Otherwise as posted. */
+  uint32_t count;
+  /** \brief Payload. E.g. in a caller arena. (optional) */
+  void const *data;
+} Event;
+
 /**
  * \brief Entry function prototype.
  *
+ * \param sm  Machine
  * \param s   Current state
  */
-typedef void (*entry_fn)(State const *s);
+typedef void (*entry_fn)(Machine *sm, State const *s);
 
 /**
  * \brief Run function prototype.
  *
+ * \param sm  Machine
  * \param s   Current state.
- * \param e   Event of transition if any. SC_NO_EVENT if not in transition.
+ * \param e   Event being processed. Type SC_NO_EVENT if none.
  *
  * \return    Valid state to trigger immediate transition. NULL to not change state.
  *
  * \attention Transition in run are not visible in the transition table.
  *            Be careful with this.
  */
-typedef State *(*run_fn)(State const *s, EventType e);
+typedef State const *(*run_fn)(Machine *sm, State const *s, Event const *e);
 
 /**
  * \brief Exit function prototype.
  *
+ * \param sm  Machine
  * \param s   Current state
  */
-typedef void (*exit_fn)(State const *s);
+typedef void (*exit_fn)(Machine *sm, State const *s);
 
 /**
  * \brief Transition action prototype.
  *
- * \param s   Root state
+ * \param sm  Machine
+ * \param e   Triggering event. Type SC_NO_EVENT for automatic transitions.
  */
-typedef void (*transition_fn)(State const *root);
+typedef void (*transition_fn)(Machine *sm, Event const *e);
 
 /**
  * \brief Guard prototype.
  *
- * \param s   Root state
+ * \param sm  Machine
+ * \param e   Triggering event. Type SC_NO_EVENT for automatic transitions.
  *
  * \return    true if transition should be taken. false otherwise.
  */
-typedef bool (*guard_fn)(State const *root);
+typedef bool (*guard_fn)(Machine const *sm, Event const *e);
 
 /** \brief Transition class */
 struct Transition {
   /** \brief Source state of transition. Must be a valid state. */
-  State *const from;
+  State const *const from;
   /** \brief Target state of transition. Must be a valid state. */
-  State *const to;
+  State const *const to;
   /** \brief Event the transition reacts to. Must be positive or one of ScEvents */
   EventType const event;
   /** \brief Transition function. Will be called after all exits, before all entrys */
@@ -160,6 +231,34 @@ struct Transition {
   guard_fn const guard_fn;
   /** \brief Transition type. Default: External */
   TransitionType type;
+  /**
+   * \brief Time trigger in wheel ticks. 0 for none. (optional)
+   *
+   * If set, the transition is taken `after` ticks after `from` was entered, if `from` is still
+   * active and the guard passes. `event` is ignored. Needs sc_machine_timers().
+   */
+  uint32_t after;
+  /**
+   * \brief Guard result can be reused within one sc_run(). (optional)
+   *
+   * The guard must not depend on the event or on anything changed while the event runs. It is
+   * called at most once per run for all transitions declaring it pure.
+   */
+  bool pure_guard;
+  /**
+   * \brief Application signals the guard result depends on. Implies pure_guard. (optional)
+   *
+   * Bits of application defined signals. The result is kept across runs until sc_signal()
+   * reports a change of one of them.
+   */
+  uint32_t guard_signals;
+  /**
+   * \brief Guard never passes together with other guards checked for the same event. (optional)
+   *
+   * Transitions checked for the same event in the same state can be tested in any order if all
+   * of them are guarded and declare this. See sc_adapt_order().
+   */
+  bool exclusive_guard;
 };
 
 /** \brief Use this to indicate the end of the transition table. */
@@ -175,39 +274,489 @@ struct StateConfig {
   /** \brief Entry function. After transition guard. (optional) */
   exit_fn const exit_fn;
   /** \brief Parent state. Must be statchart root or NULL if this is root state. (mandatory) */
-  State *const parent;
+  State const *const parent;
   /** \brief Initial state. When target is this state, also transition into initial. (optional) */
-  State *const initial;
+  State const *const initial;
   /** \brief State type. See StateType description. (optional) */
   StateType type;
-    /** \brief State transition table. Only used on root node currently. */
+  /** \brief State transition table. Last element must be SC_TRANSITIONS_END. (optional) */
   Transition const *transitions;
+  /**
+   * \brief Events deferred while the state is active. Terminated by SC_NO_EVENT. (optional)
+   *
+   * Substates inherit the deferral unless they or a state between have a transition for the
+   * event. A transition of the state itself takes precedence. See sc_machine_deferral().
+   */
+  EventType const *deferred;
+  /**
+   * \brief Call run_fn only on every `run_every`-th tick. 0 or 1 for every tick. (optional)
+   *
+   * A tick is a call with event SC_NO_EVENT. Ticks are counted from the entry of the state.
+   */
+  uint16_t run_every;
+  /**
+   * \brief Events run_fn is called for besides ticks. Terminated by SC_NO_EVENT. (optional)
+   *
+   * NULL for all events. An empty list calls run_fn on ticks only.
+   */
+  EventType const *run_events;
+  /** \brief Do not call run_fn on ticks. (optional) */
+  bool run_no_ticks;
 };
 
-/** \brief State class */
+/** \brief State class. Read only after sc_map_stateconfig_to_states(). */
 struct State {
   StateConfig const *config;
+};
+
+/** \brief Precomputed execution of a transition. Built by sc_compile(). Private. */
+struct TransitionPath {
+  /** \brief Exit from the active leaf up to this state (exclusive). */
+  StateId boundary;
+  /** \brief Active leaf after the transition. */
+  StateId leaf;
+  /** \brief Leading path states which get activated but not entered (local transitions). */
+  uint16_t skip;
+  /** \brief Number of states in the path. */
+  uint16_t len;
+  /** \brief First path state in Chart._path_states. */
+  uint32_t begin;
+  /** \brief Target is only known at runtime (history). Path is not used then. */
+  bool dynamic;
+};
+
+/**
+ * \brief Transition as the dispatch reads it. Built by sc_compile(). Private.
+ *
+ * 8 bytes instead of a Transition with its pointers, eight fit into a cache line.
+ */
+struct CompactTransition {
+  /** \brief Source state */
+  StateId from;
+  /** \brief Target state */
+  StateId to;
+  /** \brief Guard, index into Chart._functions. 0 if none. */
+  uint16_t guard;
+  /** \brief Transition function, index into Chart._functions. 0 if none. */
+  uint16_t action;
+};
+
+/** \brief State functions as indices into Chart._functions, 0 if none. Private. */
+struct CompactState {
+  /** \brief Entry function */
+  uint16_t entry;
+  /** \brief Exit function */
+  uint16_t exit;
+  /** \brief Run function */
+  uint16_t run;
+};
+
+/**
+ * \brief Compiled statechart
+ *
+ * Built once by `sc_compile()` from a state array. Holds a per-state dispatch index so that
+ * `sc_run()` only looks at transitions which can match the event. Read only after compilation
+ * and shared by all Machines running it. All members starting with an underscore are private.
+ */
+struct Chart {
+  /** \brief Root state of the statechart */
+  State const *root;
+  /** \brief All states of the statechart. Every state referenced by the chart must be in here. */
+  State const *states;
+  /** \brief Number of states */
+  size_t num_states;
+  /** \brief Number of transitions of all tables. Transition ids are their index in table order. */
+  size_t num_transitions;
+  /** \brief Events `0 .. num_events - 1` are indexed. Others find no transitions. */
+  EventType num_events;
+  /** \brief Number of StateId slots every Machine needs. See sc_machine_init(). */
+  size_t machine_slots;
+  /** \brief Number of time triggered transitions. Timers every Machine needs, see hsm4c_timer.h */
+  size_t num_timers;
+
+  /** \brief All transitions of all tables, in table order. Indexed by transition id. */
+  Transition const *const *_transitions;
+  /** \brief Number of 32 bit words of an event bitmap */
+  size_t _event_words;
+  /** \brief Per state bitmap of events which have candidates. [num_states * _event_words] */
+  uint32_t const *_handles;
+  /** \brief Per state offset into _runs for its first set bitmap bit. [num_states] */
+  uint32_t const *_run_base;
+  /** \brief Per set bitmap bit: begin of its candidate run in _candidates. One extra at end. */
+  uint32_t const *_runs;
+  /** \brief Candidate transition ids in evaluation order. */
+  uint16_t const *_candidates;
+  /** \brief Number of candidate runs */
+  size_t _num_runs;
+  /** \brief Bitmap of candidate runs which can be tested in any order. NULL if none. */
+  uint32_t const *_exclusive_runs;
+  /** \brief Hits per candidate. NULL if not learning, see sc_learn_order(). */
+  _Atomic uint32_t *_hits;
+
+  /** \brief Parent of each state. SC_NO_STATE for root. [num_states] */
+  StateId const *_parent;
+  /** \brief Depth of each state. Root is 0. [num_states] */
+  uint16_t const *_depth;
+  /** \brief Whether a state or one of its ancestors has a run function. [num_states] */
+  bool const *_branch_runs;
+  /** \brief Dense copy of each transition. Indexed by transition id. */
+  struct CompactTransition const *_compact_transitions;
+  /** \brief Dense function references of each state. [num_states] */
+  struct CompactState const *_compact_states;
+  /**
+   * \brief Distinct state and transition functions, cast back to their type when called
+   *
+   * Element 0 is NULL. Order: Entry, exit and run function of each state, then guard and action
+   * of each transition by id, each function at its first use. [_num_functions]
+   */
+  void (*const *_functions)(void);
+  /** \brief Number of _functions */
+  size_t _num_functions;
+  /** \brief Exit boundary and entry path of each transition. Indexed by transition id. */
+  struct TransitionPath const *_paths;
+  /** \brief States activated by static transitions, below the common ancestor down to leaf. */
+  StateId const *_path_states;
+  /** \brief Machine slot keeping the last active child of a state, SC_NO_STATE if not needed. */
+  StateId const *_history_slot;
 
-  /** \brief Active child state. On root node this is always a leaf */
-  State *_active;
+  /** \brief Machine slots of the active path, one per depth. */
+  size_t _path_slot;
+  /** \brief Machine slot of the run stamp, followed by the cached guard results. */
+  size_t _guard_slot;
+  /** \brief Machine slots of the bitmap of deferred event types, `(num_events + 15) / 16` words. */
+  size_t _defer_slot;
+  /** \brief Number of 16 bit words of an active configuration. 0 if the chart has no regions. */
+  size_t _config_words;
+  /** \brief Machine slot of the active configuration bitset, followed by a scratch bitset. */
+  size_t _config_slot;
+  /** \brief First child of each state. SC_NO_STATE if none. [num_states] (regions only) */
+  StateId const *_first_child;
+  /** \brief Next sibling of each state. SC_NO_STATE if none. [num_states] (regions only) */
+  StateId const *_next_sibling;
 
+  /** \brief First timer of each state. Timers of a state are armed on entry. [num_states + 1] */
+  uint16_t const *_timer_begin;
+  /** \brief Transition id of each timer, grouped by source state. [num_timers] */
+  uint16_t const *_timer_transition;
+  /** \brief Machine slot caching the guard of each transition. SC_NO_STATE if not cached. */
+  StateId const *_guard_cache;
+  /** \brief Signals each cached guard depends on, 0 if only pure. [number of cached guards] */
+  uint32_t const *_guard_signals;
+  /** \brief Per state bitmap of deferred events. [num_states * _event_words] NULL if none. */
+  uint32_t const *_defers;
+  /** \brief Per state bitmap of events reaching run_fn. [num_states * _event_words] NULL: all */
+  uint32_t const *_run_events;
+  /** \brief Machine slot counting ticks of each state, SC_NO_STATE if none. NULL if none at all. */
+  StateId const *_tick_slot;
+
+  /** \brief Attached statistics. NULL if none. See hsm4c_stats.h. */
+  ChartStats *_stats;
+};
+
+/**
+ * \brief Statechart instance
+ *
+ * Runtime state of one machine running a shared Chart: The active leaf, its ancestors and the last
+ * active child of the states needed for history. Charts with regions also keep the set of active
+ * states.
+ * Everything else is in the Chart.
+ */
+struct Machine {
+  /** \brief Chart this machine runs */
+  Chart const *chart;
+  /** \brief User context. Not used by the library. */
+  void *ctx;
+  /**
+   * \brief Machine slots. [chart->machine_slots]
+   *
+   * History, active path, guard cache, active configuration, bitmap of deferred events and tick
+   * counters, as laid out by the chart.
+   */
+  StateId *_slots;
+  /** \brief Event queue. [_queue_capacity] See sc_machine_queue(). */
+  Event *_queue;
+  /** \brief Queue size */
+  uint16_t _queue_capacity;
+  /** \brief Index of the oldest queued event */
+  uint16_t _queue_head;
+  /** \brief Number of queued events */
+  uint16_t _queue_count;
+  /** \brief Active leaf. Leaf of the first active region if the chart has regions. */
+  StateId _leaf;
+  /** \brief sc_dispatch_all() in progress */
+  bool _dispatching;
+  /** \brief Policy per event type. [chart->num_events] NULL if none. */
+  CoalescePolicy const *_coalesce;
+  /** \brief Queue index of the queued event per type, SC_NO_STATE if none. [chart->num_events] */
+  uint16_t *_coalesce_queued;
+  /** \brief Number of merged events per type. [chart->num_events] */
+  uint32_t *_coalesced;
+  /** \brief Deferred events, oldest first. [_deferred_capacity] See sc_machine_deferral(). */
+  Event *_deferred;
+  /** \brief Deferral storage size */
+  uint16_t _deferred_capacity;
+  /** \brief Number of deferred events */
+  uint16_t _deferred_count;
+  /** \brief Number of deferred events dropped because the storage was full */
+  uint32_t _deferred_dropped;
+  /** \brief Wheel of the timers. NULL if none. See sc_machine_timers(). */
+  TimerWheel *_wheel;
+  /** \brief Timer of each time triggered transition. [chart->num_timers] */
+  Timer *_timers;
+  /** \brief Event of the stepped run. See sc_begin(). */
+  Event _event;
+  /** \brief Progress of the stepped run */
+  uint8_t _step;
+  /** \brief Configuration remembered by the cycle detector */
+  uint32_t _cycle_key;
+  /** \brief Leaf of the remembered configuration, and with it the active path */
+  StateId _cycle_leaf;
+  /** \brief Steps between remembered configurations, doubles */
+  uint32_t _cycle_power;
+  /** \brief Steps since the configuration was remembered */
+  uint32_t _cycle_length;
 };
 
+/**
+ * \brief Many machines of one chart in structure-of-arrays layout
+ *
+ * Runtime state of machine `i` is `leaf[i]`, `slots[i * chart->machine_slots ...]` and `ctx[i]`.
+ * Used with `sc_run_batch()` to dispatch bursts of events over many machines.
+ */
+typedef struct MachineSet {
+  /** \brief Chart all machines run */
+  Chart const *chart;
+  /** \brief Number of machines */
+  uint32_t count;
+  /** \brief Active leaf per machine. [count] */
+  StateId *leaf;
+  /**
+   * \brief Machine slots, machine after machine. [count * chart->machine_slots]
+   *
+   * History, active path, guard cache, active configuration, bitmap of deferred events and tick
+   * counters of each machine, as laid out by the chart.
+   */
+  StateId *slots;
+  /** \brief User context per machine. [count] (optional) */
+  void **ctx;
+} MachineSet;
+
+/** \brief Result of a micro-step */
+typedef enum StepResult {
+  /** \brief The event ran to completion. Nothing pending. */
+  SC_STEP_DONE = 0,
+  /** \brief More micro-steps pending. */
+  SC_STEP_PENDING,
+  /**
+   * \brief More micro-steps pending, and they went through a configuration seen before
+   *
+   * Automatic transitions or run functions go in circles and will do so forever, unless a guard
+   * or run function depends on data outside the machine. Configurations are compared by active
+   * states and history only, tick counters of StateConfig.run_every are not.
+   */
+  SC_STEP_CYCLE,
+} StepResult;
+
+/** \brief Number of uint32_t scratch entries `sc_run_batch()` needs for `n` events. */
+#define SC_BATCH_SCRATCH(n) (2 * (n))
+
+/**
+ * \brief Compiles a statechart
+ *
+ * Builds the dispatch index for all states in `states`: For every state and event the
+ * transitions which can match (own table, ancestor tables and root table entries sourced by the
+ * branch) are listed in the order `sc_run()` has to evaluate them. Automatic transitions only
+ * make up the list of SC_NO_EVENT, the completion check after a transition, so event lookups do
+ * not test them. Call once on startup, after `sc_map_stateconfig_to_states()`.
+ *
+ * Also precomputes the depth of every state and, for every transition not targeting a history
+ * state, the exit boundary and the flat list of states to enter. Those transitions then run as
+ * straight loops without searching the common ancestor.
+ *
+ * Dispatch reads transitions and state functions from dense copies with 16 bit state and
+ * function indices, not through the pointers of the tables.
+ *
+ * The index is placed into `mem`. Call with `mem` NULL to query the required size.
+ *
+ * \param chart         Chart to compile into.
+ * \param num_states    Number of states.
+ * \param states        All states. Must contain exactly one SC_TYPE_ROOT state. The chart keeps
+ *                      a pointer to them.
+ * \param mem           Memory for the dispatch index. Must be aligned for pointers.
+ * \param mem_size      Size of `mem` in bytes.
+ *
+ * \return              Required size in bytes. Chart is usable if this is <= mem_size.
+ *                      SIZE_MAX if the chart has no root, more than UINT16_MAX - 1 states,
+ *                      transitions or distinct functions.
+ */
+size_t sc_compile(Chart *chart, size_t num_states, State const states[num_states], void *mem,
+                  size_t mem_size);
+
+/**
+ * \brief Starts counting hits of interchangeable transitions
+ *
+ * Counts which transition is taken in every list of candidates whose guards are all declared
+ * exclusive. Counters are relaxed atomics, machines of the chart can keep running on any thread.
+ *
+ * \param chart     Compiled chart.
+ * \param mem       Memory for the counters. Must be aligned for uint32_t. NULL to stop counting.
+ * \param mem_size  Size of `mem` in bytes.
+ *
+ * \return          Required size in bytes, 0 if the chart has no exclusive candidates. Counting
+ *                  if `mem` is set and this is <= mem_size.
+ */
+size_t sc_learn_order(Chart *chart, void *mem, size_t mem_size);
+
+/**
+ * \brief Tests the most taken interchangeable transitions first
+ *
+ * Sorts every list of exclusive candidates by hits, stable, and halves the hits so that recent
+ * traffic weighs more on the next call. Call periodically while no machine runs the chart.
+ * Charts not built by `sc_compile()` keep their order.
+ *
+ * \return  Number of lists whose order changed.
+ */
+size_t sc_adapt_order(Chart *chart);
+
+/**
+ * \brief Copies the evaluation order of all candidates
+ *
+ * \param order  Output. NULL to query the size.
+ * \param len    Number of elements of `order`.
+ *
+ * \return       Number of candidates. Copied if this is <= len.
+ */
+size_t sc_export_order(Chart const *chart, uint16_t order[], size_t len);
+
+/**
+ * \brief Applies an exported evaluation order, e.g. one learned on a test bench
+ *
+ * \return  Whether the order was applied: It is from the same chart and only reorders lists of
+ *          exclusive candidates.
+ */
+bool sc_import_order(Chart *chart, uint16_t const order[], size_t len);
+
+/**
+ * \brief Binds a machine to a chart and clears its history
+ *
+ * Does not call any state functions. Use `sc_init()` afterwards.
+ *
+ * \param sm            Machine to initialize.
+ * \param chart         Compiled statechart. Can be shared by any number of machines.
+ * \param slots         Per machine storage of `chart->machine_slots` entries.
+ * \param ctx           User context. Available as `sm->ctx` in all state and transition functions.
+ */
+void sc_machine_init(Machine *sm, Chart const *chart, StateId slots[], void *ctx);
+
+/**
+ * \brief Attaches an event queue to a machine
+ *
+ * Drops all queued events. Needed by `sc_post()`, `sc_post_front()` and `sc_dispatch_all()`.
+ *
+ * \param sm            Machine.
+ * \param queue         Storage for `capacity` events.
+ * \param capacity      Maximum number of queued events.
+ */
+void sc_machine_queue(Machine *sm, Event queue[], uint16_t capacity);
+
+/**
+ * \brief Merges posted events with queued ones of the same type
+ *
+ * Applies to `sc_post()` and `sc_post_event()`, not to front posts. An event of a type with a
+ * policy other than SC_COALESCE_NONE is merged into the queued event of its type, if there is
+ * one which has not been taken for processing yet. Finding it is a table lookup. Merging also
+ * succeeds when the queue is full.
+ *
+ * Call after `sc_machine_queue()`. Types outside of `[1, chart->num_events)` are never merged.
+ *
+ * \param sm          Machine.
+ * \param policy      Policy per event type.
+ * \param queued      Storage for `chart->num_events` queue indices. Private.
+ * \param coalesced   Counters of merged events per type. Zeroed.
+ */
+void sc_machine_coalescing(Machine *sm, CoalescePolicy const policy[], uint16_t queued[],
+                           uint32_t coalesced[]);
+
+/**
+ * \brief Attaches storage for deferred events to a machine
+ *
+ * An event which the active configuration defers (see StateConfig.deferred) is stored instead of
+ * processed. After every event ran to completion, the stored events which are no longer deferred
+ * are processed in the order they arrived. Checking costs a bitmap test per deferred event type,
+ * the stored events are only searched when one of them can be processed.
+ *
+ * Without storage nothing is deferred. If the storage is full a deferred event is dropped and
+ * counted, see sc_deferred_dropped().
+ * Events are copied, their payload must stay valid until they are processed. The step API
+ * (sc_begin()) neither defers nor recalls.
+ *
+ * \param sm          Machine.
+ * \param events      Storage for `capacity` events.
+ * \param capacity    Maximum number of deferred events.
+ */
+void sc_machine_deferral(Machine *sm, Event events[], uint16_t capacity);
+
+/** \brief Number of deferred events waiting */
+size_t sc_deferred_count(Machine const *sm);
+
+/** \brief Number of deferred events dropped because the storage was full. Zeroed on attach. */
+uint32_t sc_deferred_dropped(Machine const *sm);
+
 /**
  * \brief Initialized a statechart
  *
- * This does only initialize the root tree.
- * To reset all states please iterate with `sc_reset_state()`.
+ * This does only initialize the root tree. History is kept.
+ * To reset history please use `sc_reset_state()` or `sc_machine_init()`.
  *
- * \param root          Statechart root state.
- * \param transitions   Transition table. Last element must be SC_TRANSITIONS_END.
+ * \param sm            Machine.
  *
  * \return              Leaf state after init.
  */
-State const *sc_init(State *root);
+State const *sc_init(Machine *sm);
+
+/**
+ * \brief Binds a machine set to a chart and clears the history of all machines
+ *
+ * Does not call any state functions. Use `sc_init_batch()` afterwards.
+ *
+ * \param set     Machine set to initialize.
+ * \param chart   Compiled statechart.
+ * \param count   Number of machines.
+ * \param leaf    Storage for `count` leaves.
+ * \param slots   Storage for `count * chart->machine_slots` slots.
+ * \param ctx     User context per machine. May be NULL.
+ */
+void sc_set_init(MachineSet *set, Chart const *chart, uint32_t count, StateId leaf[],
+                 StateId slots[], void *ctx[]);
+
+/** \brief Like `sc_init()` for every machine of the set, in machine order. */
+void sc_init_batch(MachineSet *set);
+
+/**
+ * \brief Runs a burst of events over many machines
+ *
+ * Same as calling `sc_run()` for every (machine, event) pair, except for the order between
+ * different machines: Events are grouped by the active leaf their machine had when the batch
+ * started, so machines in the same state share the same dispatch index entries while they are hot
+ * in cache. Events for the same machine keep their order, so every machine sees the exact same
+ * callbacks as with `sc_run()`.
+ *
+ * State and transition functions get a Machine view of the set member which is only valid during
+ * the call and has no event queue, no timers and no deferral storage: Events the configuration
+ * defers are processed right away, like by a machine without sc_machine_deferral().
+ *
+ * \param set         Machines.
+ * \param machines    Machine index of every event.
+ * \param events      Events.
+ * \param n           Number of events.
+ * \param leaves      Output. Leaf of the machine after its event. [n] (optional)
+ * \param scratch     Scratch memory. [SC_BATCH_SCRATCH(n)]
+ */
+void sc_run_batch(MachineSet *set, uint32_t const machines[], EventType const events[], size_t n,
+                  StateId leaves[], uint32_t scratch[]);
 
-/** \brief Resets the given state */
-void sc_reset_state(State *state);
+/** \brief Resets the history of the given state */
+void sc_reset_state(Machine *sm, State const *state);
 
 /** \brief Map StateConfigs and State if using tables to define them */
 void sc_map_stateconfig_to_states(size_t num_states, State states[num_states],
@@ -216,14 +765,181 @@ void sc_map_stateconfig_to_states(size_t num_states, State states[num_states],
 /**
  * \brief Runs one iteration of the statechart
  *
- * \param root    Statechart root state.
+ * \param sm      Machine.
  * \param event   Event to pass to the statechart.
  *                Events <= 0 are used internally.
  *                E.g. SC_NO_EVENT is 0
  *
+ * \return        State after one iteration. With regions the leaf of the first active region,
+ *                use `sc_is_in()` for the others.
+ *
+ * \attention     Runs until no automatic transition or run function changes the state. Use
+ *                `sc_begin()` and `sc_run_budget()` to bound the time spent.
+ */
+State const *sc_run(Machine *sm, EventType event);
+
+/**
+ * \brief Like `sc_run()`, for an event with payload
+ *
+ * \param sm      Machine.
+ * \param event   Event. Passed as is to all state and transition functions.
+ *
  * \return        State after one iteration.
  */
-State const *sc_run(State *root, EventType event);
+State const *sc_run_event(Machine *sm, Event const *event);
+
+/**
+ * \brief Starts a stepped run of an event
+ *
+ * Like `sc_run_event()`, but nothing runs until `sc_step()` or `sc_run_budget()`. A pending
+ * stepped run is dropped. Do not call `sc_run()` while a stepped run is pending.
+ *
+ * \param sm      Machine.
+ * \param event   Event. Copied, its payload must stay valid until the run is done.
+ */
+void sc_begin(Machine *sm, Event const *event);
+
+/**
+ * \brief Runs one micro-step of the run started by `sc_begin()`
+ *
+ * A micro-step takes one transition, or calls the run functions and takes the transition one of
+ * them requested. `sc_run()` loops over micro-steps until one changes nothing, which may take
+ * arbitrarily long. Stepping keeps every call bounded.
+ *
+ * \param sm      Machine.
+ *
+ * \return        SC_STEP_DONE once a micro-step changed nothing, or if no run is pending.
+ */
+StepResult sc_step(Machine *sm);
+
+/**
+ * \brief Runs micro-steps until done, a cycle is found or the budget is used up
+ *
+ * \param sm          Machine.
+ * \param max_steps   Maximum number of micro-steps.
+ * \param max_ns      Maximum time in nanoseconds, checked after each micro-step. 0 for none.
+ *
+ * \return            Result of the last micro-step. SC_STEP_PENDING if the budget ran out.
+ */
+StepResult sc_run_budget(Machine *sm, size_t max_steps, uint64_t max_ns);
+
+/**
+ * \brief Queues an event at the back of the machine queue
+ *
+ * Callable from state and transition functions. The event is processed by `sc_dispatch_all()`
+ * after the current event ran to completion.
+ *
+ * \param sm      Machine.
+ * \param event   Event.
+ *
+ * \return        false if the queue is full or the machine has none. true if merged, see
+ *                sc_machine_coalescing().
+ */
+bool sc_post(Machine *sm, EventType event);
+
+/**
+ * \brief Like `sc_post()`, but the event is processed before all queued events
+ *
+ * The event is never merged, see sc_machine_coalescing(): It is queued on its own even if an
+ * event of its type is queued, and later posts do not merge into it. Merging would move it to
+ * the back, or move older events to the front.
+ */
+bool sc_post_front(Machine *sm, EventType event);
+
+/**
+ * \brief Like `sc_post()`, for an event with payload
+ *
+ * The event is copied into the queue slot, its payload is not.
+ */
+bool sc_post_event(Machine *sm, Event const *event);
+
+/** \brief Like `sc_post_front()`, for an event with payload */
+bool sc_post_front_event(Machine *sm, Event const *event);
+
+/**
+ * \brief Runs all queued events, including the ones posted while running
+ *
+ * Every event runs to completion with `sc_run()` before the next one is taken from the queue.
+ * Calls from within state and transition functions return immediately, the outer call continues.
+ *
+ * \param sm      Machine.
+ *
+ * \return        Number of events processed.
+ */
+size_t sc_dispatch_all(Machine *sm);
+
+/**
+ * \brief Reports a change of application signals guards depend on
+ *
+ * Forgets the cached results of all guards declaring one of `signals` in `guard_signals`. They
+ * are called again when needed.
+ *
+ * \param sm        Machine.
+ * \param signals   Bits of the changed signals.
+ */
+void sc_signal(Machine *sm, uint32_t signals);
+
+/**
+ * \brief Whether a machine is in a state, i.e. the state is active. O(1).
+ *
+ * Meant for guards. Unspecified for the states being exited or entered during a transition.
+ */
+bool sc_is_in(Machine const *sm, State const *state);
+
+/**
+ * \brief Active states from root down to the active leaf. O(1).
+ *
+ * With regions the path of the first active region. Valid until the next run.
+ *
+ * \param sm      Machine.
+ * \param len     Output. Number of states in the path, depth of the leaf + 1.
+ *
+ * \return        State ids indexed by depth. Index `chart->states` with them.
+ */
+StateId const *sc_active_path(Machine const *sm, size_t *len);
+
+/**
+ * \brief Size of a snapshot of a machine of the chart, in bytes
+ *
+ * The same for all machines of a chart: A header with the active leaf and a fingerprint of the
+ * chart, all machine slots and the remaining ticks of every timer.
+ */
+size_t sc_snapshot_size(Chart const *chart);
+
+/**
+ * \brief Writes the runtime state of a machine into a byte blob
+ *
+ * Saves the active configuration, the history of all states and the remaining ticks of armed
+ * timers. The blob holds state indices in little endian byte order, no pointers, so it can be
+ * restored in another process running the same chart.
+ *
+ * \param sm      Machine. Not running.
+ * \param buf     Output.
+ * \param size    Size of `buf` in bytes.
+ *
+ * \return        Bytes written, `sc_snapshot_size()`. 0 if `buf` is too small.
+ */
+size_t sc_snapshot(Machine const *sm, void *buf, size_t size);
+
+/**
+ * \brief Restores the runtime state of a machine from a snapshot
+ *
+ * No state functions are called. Timers are armed with their remaining ticks on the wheel of
+ * `sm`, see sc_machine_timers(). Event queue and context of `sm` are kept.
+ *
+ * The snapshot must come from a machine of the same chart, compared by a fingerprint of its
+ * hierarchy and transitions. Leaf, history and active configuration are checked to be a state
+ * the machine can be in; the active path is rebuilt from the leaf. Cached guard results are not
+ * restored, guards are evaluated again.
+ *
+ * \param sm      Machine initialized with `sc_machine_init()` for the chart of the snapshot.
+ * \param buf     Snapshot from `sc_snapshot()`.
+ * \param size    Size of the snapshot in bytes.
+ *
+ * \return        false if the snapshot does not fit the chart or is corrupt. `sm` is unchanged
+ *                then.
+ */
+bool sc_restore(Machine *sm, void const *buf, size_t size);
 
 /**
  * \brief Get the root of any state
@@ -233,3 +949,16 @@ State const *sc_run(State *root, EventType event);
  * \return        Root state.
  */
 State const *sc_get_root(State const *s);
+
+/**
+ * \brief Takes a transition whose target is only known at runtime
+ *
+ * Private. Used by engines generated with `hsm4c_gen --switch` for history targets and states
+ * requested by run functions, so those behave exactly like in sc_run().
+ *
+ * \param sm      Machine of a chart without regions.
+ * \param t       Transition from a table. NULL if requested by a run function.
+ * \param to      Target. May be a history pseudo state.
+ * \param event   Triggering event.
+ */
+void sc_execute_dynamic_(Machine *sm, Transition const *t, State const *to, Event const *event);
@@ -0,0 +1,191 @@
+/**
+ * \brief Implementation of the sharded executor
+ * \file
+ *
+ * Mailboxes are bounded MPSC rings (hsm4c_ring.h): Producers claim a position with a CAS on the
+ * tail, the worker takes the entries in position order.
+ *
+ * (C) 2023 David Bongartz
+ * MIT License
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "hsm4c_executor.h"
+
+#include <sched.h>
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+
+/* -------- Private -------- */
+
+/** \brief Idle polls before the worker starts sleeping. */
+#define IDLE_SPINS 64
+
+/** \brief Sleep of an idle worker in ns. */
+#define IDLE_SLEEP_NS 50000
+
+/** \brief Take the next published entry. Only called by the owning worker. */
+static bool mailbox_take(ExecutorWorker *w, uint32_t *machine, Event *event) {
+  size_t pos;
+  if (!sc_ring_peek_(&w->_mailbox, &pos)) {
+    return false;
+  }
+  ExecutorMessage const *const msg = sc_ring_cell_(&w->_mailbox, pos);
+  *machine = msg->_machine;
+  *event = msg->_event;
+  sc_ring_pop_(&w->_mailbox, pos);
+  return true;
+}
+
+/** \brief Claim a position and publish an entry. Callable by any thread. */
+static bool mailbox_put(ExecutorWorker *w, uint32_t machine, Event const *event) {
+  size_t pos;
+  if (!sc_ring_claim_(&w->_mailbox, &pos)) {
+    // Worker did not free this cell yet
+    return false;
+  }
+  ExecutorMessage *const msg = sc_ring_cell_(&w->_mailbox, pos);
+  msg->_machine = machine;
+  msg->_event = *event;
+  sc_ring_publish_(&w->_mailbox, pos);
+  return true;
+}
+
+/** \brief Pin the calling thread to a CPU if supported. */
+static void pin_to_cpu(uint32_t index) {
+#if defined(__linux__)
+  long const cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (cpus > 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(index % (uint32_t)cpus, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+#else
+  (void)index;
+#endif
+}
+
+/** \brief Worker thread. Runs events until stopped and drained. */
+static void *worker_main(void *arg) {
+  ExecutorWorker *const w = arg;
+  Executor *const ex = w->_executor;
+  unsigned idle = 0;
+
+  if (ex->_config.pin_threads) {
+    pin_to_cpu(w->_index);
+  }
+
+  for (;;) {
+    uint32_t machine;
+    Event event;
+
+    if (mailbox_take(w, &machine, &event)) {
+      sc_run_event(&ex->_config.machines[machine], &event);
+      sc_dispatch_all(&ex->_config.machines[machine]);
+      atomic_fetch_add_explicit(&w->_processed, 1, memory_order_relaxed);
+      idle = 0;
+      continue;
+    }
+
+    // Nothing published. Done if stopped and every claimed position got taken.
+    if (atomic_load_explicit(&ex->_stopping, memory_order_acquire) &&
+        sc_ring_drained_(&w->_mailbox)) {
+      return NULL;
+    }
+
+    if (++idle < IDLE_SPINS) {
+      sched_yield();
+    } else {
+      nanosleep(&(struct timespec){.tv_nsec = IDLE_SLEEP_NS}, NULL);
+    }
+  }
+}
+
+/* -------- Public -------- */
+
+bool sc_executor_start(Executor *ex, ExecutorConfig const *config) {
+  uint32_t const capacity = config->mailbox_capacity;
+
+  if (!config->num_workers || !capacity || (capacity & (capacity - 1))) {
+    return false;
+  }
+
+  ex->_config = *config;
+  atomic_init(&ex->_accepting, true);
+  atomic_init(&ex->_stopping, false);
+  atomic_init(&ex->_producers, 0);
+
+  for (uint32_t i = 0; i < config->num_workers; ++i) {
+    ExecutorWorker *w = &config->workers[i];
+    w->_executor = ex;
+    w->_index = i;
+    sc_ring_init_(&w->_mailbox, &config->mailboxes[(size_t)i * capacity], sizeof(ExecutorMessage),
+                  capacity);
+    atomic_init(&w->_posted, 0);
+    atomic_init(&w->_processed, 0);
+    atomic_init(&w->_rejected, 0);
+  }
+
+  for (uint32_t i = 0; i < config->num_workers; ++i) {
+    if (pthread_create(&config->workers[i]._thread, NULL, worker_main, &config->workers[i])) {
+      ex->_config.num_workers = i;
+      sc_executor_stop(ex);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool sc_executor_post(Executor *ex, uint32_t machine, EventType event) {
+  return sc_executor_post_event(ex, machine, &(Event const){.type = event});
+}
+
+bool sc_executor_post_event(Executor *ex, uint32_t machine, Event const *event) {
+  ExecutorWorker *const w = &ex->_config.workers[machine % ex->_config.num_workers];
+  bool queued = false;
+
+  // Announce the post before checking for stop, so stop can wait for it
+  atomic_fetch_add(&ex->_producers, 1);
+  if (machine < ex->_config.num_machines && atomic_load(&ex->_accepting)) {
+    queued = mailbox_put(w, machine, event);
+  }
+  atomic_fetch_sub_explicit(&ex->_producers, 1, memory_order_release);
+
+  atomic_fetch_add_explicit(queued ? &w->_posted : &w->_rejected, 1, memory_order_relaxed);
+  return queued;
+}
+
+void sc_executor_stop(Executor *ex) {
+  atomic_store(&ex->_accepting, false);
+  while (atomic_load(&ex->_producers)) {
+    sched_yield();
+  }
+  // Only the first call joins, also after a failed start which stopped already
+  if (atomic_exchange_explicit(&ex->_stopping, true, memory_order_acq_rel)) {
+    return;
+  }
+  for (uint32_t i = 0; i < ex->_config.num_workers; ++i) {
+    pthread_join(ex->_config.workers[i]._thread, NULL);
+  }
+}
+
+void sc_executor_stats(Executor const *ex, uint32_t worker, ExecutorStats *stats) {
+  uint32_t const first = worker == UINT32_MAX ? 0 : worker;
+  uint32_t const last = worker == UINT32_MAX ? ex->_config.num_workers : worker + 1;
+
+  *stats = (ExecutorStats){0};
+  for (uint32_t i = first; i < last; ++i) {
+    ExecutorWorker const *w = &ex->_config.workers[i];
+    uint64_t const processed = atomic_load_explicit(&w->_processed, memory_order_relaxed);
+    uint64_t const posted = atomic_load_explicit(&w->_posted, memory_order_relaxed);
+    stats->posted += posted;
+    stats->processed += processed;
+    stats->rejected += atomic_load_explicit(&w->_rejected, memory_order_relaxed);
+    stats->queue_depth += posted > processed ? posted - processed : 0;
+  }
+}
@@ -0,0 +1,142 @@
+/**
+ * \brief Sharded multi-threaded executor for statechart machines
+ * \file
+ *
+ * Runs many machines on a fixed number of worker threads.
+ *
+ * - Machine `i` is owned by worker `i % num_workers` for the lifetime of the executor.
+ *   All its events are processed by that worker, one after the other (run-to-completion).
+ *   Events a machine posts to its own queue (`sc_post()`) are dispatched right after.
+ * - Every worker has a bounded lock-free MPSC mailbox. Any thread can post, posting never blocks
+ *   or locks. Events from one producer to one machine are processed in posting order.
+ *   Payloads are not copied, see `sc_executor_post_event()`.
+ * - Workers can be pinned to CPUs (Linux only).
+ *
+ * All memory is provided by the caller. Needs POSIX threads and C11 atomics.
+ *
+ * (C) 2023 David Bongartz
+ * MIT License
+ */
+
+#pragma once
+
+#include "hsm4c.h"
+#include "hsm4c_ring.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct Executor Executor;
+
+/** \brief Mailbox entry. Private. */
+typedef struct ExecutorMessage {
+  /** \brief Sequence for the lock-free handover. */
+  atomic_size_t _seq;
+  /** \brief Target machine index. */
+  uint32_t _machine;
+  /** \brief Event to run. The payload stays with the producer. */
+  Event _event;
+} ExecutorMessage;
+
+/** \brief Worker thread. All members private, use `sc_executor_stats()`. */
+typedef struct ExecutorWorker {
+  Executor *_executor;
+  pthread_t _thread;
+  uint32_t _index;
+  /** \brief Bounded MPSC ring of ExecutorMessage. [mailbox_capacity] */
+  Ring_ _mailbox;
+  atomic_uint_fast64_t _posted;
+  atomic_uint_fast64_t _processed;
+  atomic_uint_fast64_t _rejected;
+} ExecutorWorker;
+
+/** \brief Executor setup. */
+typedef struct ExecutorConfig {
+  /** \brief Machines to run. Must be initialized with `sc_machine_init()` and `sc_init()`. */
+  Machine *machines;
+  /** \brief Number of machines. */
+  uint32_t num_machines;
+  /** \brief Worker storage. [num_workers] */
+  ExecutorWorker *workers;
+  /** \brief Number of worker threads. */
+  uint32_t num_workers;
+  /** \brief Mailbox storage. [num_workers * mailbox_capacity] */
+  ExecutorMessage *mailboxes;
+  /** \brief Entries per worker mailbox. Must be a power of two. */
+  uint32_t mailbox_capacity;
+  /** \brief Pin worker `i` to CPU `i % number of CPUs`. Ignored if not supported. */
+  bool pin_threads;
+} ExecutorConfig;
+
+/** \brief Executor. All members private. */
+struct Executor {
+  ExecutorConfig _config;
+  atomic_bool _accepting;
+  atomic_bool _stopping;
+  /** \brief Posts in progress. Stop waits for them before draining. */
+  atomic_uint _producers;
+};
+
+/** \brief Counters of an executor or one worker. Snapshots, may be slightly stale. */
+typedef struct ExecutorStats {
+  /** \brief Events accepted into a mailbox. */
+  uint64_t posted;
+  /** \brief Events run to completion. */
+  uint64_t processed;
+  /** \brief Events rejected because the mailbox was full or the executor stopped. */
+  uint64_t rejected;
+  /** \brief Events currently waiting in mailboxes. */
+  uint64_t queue_depth;
+} ExecutorStats;
+
+/**
+ * \brief Starts the worker threads
+ *
+ * \param ex      Executor.
+ * \param config  Setup. Copied.
+ *
+ * \return        true on success. false if a thread could not be started or config is invalid.
+ */
+bool sc_executor_start(Executor *ex, ExecutorConfig const *config);
+
+/**
+ * \brief Posts an event to a machine. Lock-free, callable from any thread.
+ *
+ * \param ex        Executor.
+ * \param machine   Machine index.
+ * \param event     Event. Run with `sc_run()` on the owning worker.
+ *
+ * \return          true if queued. false if the mailbox is full or the executor is stopping.
+ */
+bool sc_executor_post(Executor *ex, uint32_t machine, EventType event);
+
+/**
+ * \brief Like `sc_executor_post()`, for an event with payload
+ *
+ * The event is copied into the mailbox, its payload is not. The producer keeps owning the
+ * payload: It must stay valid and unchanged until the event has been processed, and may only be
+ * released by the machine handling it or after `sc_executor_stop()`. Everything the producer
+ * wrote before posting is visible to the worker. Run with `sc_run_event()`.
+ */
+bool sc_executor_post_event(Executor *ex, uint32_t machine, Event const *event);
+
+/**
+ * \brief Stops accepting events, processes all queued events and joins the workers.
+ *
+ * Further calls return right away, also after `sc_executor_start()` failed. Not to be called
+ * from several threads at once.
+ *
+ * \param ex  Executor.
+ */
+void sc_executor_stop(Executor *ex);
+
+/**
+ * \brief Reads counters
+ *
+ * \param ex      Executor.
+ * \param worker  Worker index or UINT32_MAX for the sum of all workers.
+ * \param stats   Output.
+ */
+void sc_executor_stats(Executor const *ex, uint32_t worker, ExecutorStats *stats);
@@ -0,0 +1,42 @@
+/**
+ * \brief Lock-free event inbox of a machine
+ * \file
+ *
+ * (C) 2023 David Bongartz
+ * MIT License
+ */
+
+#include "hsm4c_inbox.h"
+
+/* -------- Public -------- */
+
+bool sc_inbox_init(Inbox *inbox, Machine *sm, InboxSlot slots[], size_t capacity,
+                   bool multi_producer) {
+  inbox->_machine = sm;
+  inbox->_multi_producer = multi_producer;
+  return sc_ring_init_(&inbox->_ring, slots, sizeof(*slots), capacity);
+}
+
+bool sc_post_from_isr(Inbox *inbox, Event const *event) {
+  size_t pos;
+  // A single producer claims wait-free, several ones compete with a compare and swap
+  if (!(inbox->_multi_producer ? sc_ring_claim_(&inbox->_ring, &pos)
+                               : sc_ring_claim_single_(&inbox->_ring, &pos))) {
+    return false;
+  }
+  ((InboxSlot *)sc_ring_cell_(&inbox->_ring, pos))->_event = *event;
+  sc_ring_publish_(&inbox->_ring, pos);
+  return true;
+}
+
+size_t sc_inbox_drain(Inbox *inbox, size_t max_events) {
+  size_t n = 0;
+  size_t pos;
+  while (n < max_events && sc_ring_peek_(&inbox->_ring, &pos)) {
+    Event const event = ((InboxSlot *)sc_ring_cell_(&inbox->_ring, pos))->_event;
+    sc_ring_pop_(&inbox->_ring, pos);
+    sc_run_event(inbox->_machine, &event);
+    ++n;
+  }
+  return n;
+}
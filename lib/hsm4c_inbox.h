@@ -0,0 +1,91 @@
+/**
+ * \brief Lock-free event inbox of a machine
+ * \file
+ *
+ * Hands events to a machine owned by another thread without locks. Producers post from any
+ * context, also from signal handlers and realtime threads. The owning thread drains the inbox
+ * before or between its own `sc_run()` calls, so events run on that thread only.
+ *
+ * - Single producer inbox: Posting is wait-free, a bounded number of steps.
+ * - Multi producer inbox: Posting is lock-free. A producer only retries when another one claimed
+ *   the same slot first.
+ * - Posting never blocks. It fails if the inbox is full.
+ * - Events of one producer are drained in posting order.
+ *
+ * Memory ordering: Everything a producer wrote before posting is visible to the state and
+ * transition functions processing the event (release on publish, acquire on drain). The payload
+ * is not copied, it must stay valid until the event has been drained.
+ *
+ * Producers in signal handlers need lock-free `atomic_size_t`. A single producer inbox must not
+ * be posted to from a signal handler interrupting a post to the same inbox.
+ *
+ * (C) 2023 David Bongartz
+ * MIT License
+ */
+
+#pragma once
+
+#include "hsm4c.h"
+#include "hsm4c_ring.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** \brief Inbox entry. Private. */
+typedef struct InboxSlot {
+  /** \brief Sequence for the lock-free handover. */
+  atomic_size_t _seq;
+  /** \brief Event to run. */
+  Event _event;
+} InboxSlot;
+
+/** \brief Event inbox of one machine. All members are private. */
+typedef struct Inbox {
+  /** \brief Machine the events are run on */
+  Machine *_machine;
+  /** \brief Producers claim positions with a compare and swap */
+  bool _multi_producer;
+  /** \brief Bounded ring of InboxSlot, drained by the owning thread */
+  Ring_ _ring;
+} Inbox;
+
+/**
+ * \brief Initializes an empty inbox of a machine
+ *
+ * Call before producers start posting.
+ *
+ * \param inbox           Inbox.
+ * \param sm              Machine the events are run on.
+ * \param slots           Storage for `capacity` entries.
+ * \param capacity        Number of entries. Must be a power of two.
+ * \param multi_producer  Whether more than one thread or handler posts.
+ *
+ * \return                false if capacity is not a power of two.
+ */
+bool sc_inbox_init(Inbox *inbox, Machine *sm, InboxSlot slots[], size_t capacity,
+                   bool multi_producer);
+
+/**
+ * \brief Posts an event. Never blocks or locks, callable from signal handlers.
+ *
+ * \param inbox   Inbox.
+ * \param event   Event. Copied, the payload is not.
+ *
+ * \return        true if posted. false if the inbox is full.
+ */
+bool sc_post_from_isr(Inbox *inbox, Event const *event);
+
+/**
+ * \brief Runs posted events on the machine. Only call from the thread owning the machine.
+ *
+ * Every event is run with `sc_run_event()` in posting order. Stops at the first event a producer
+ * has claimed but not yet published, it is drained by the next call.
+ *
+ * \param inbox       Inbox.
+ * \param max_events  Maximum number of events to run. Bounds the call while producers post.
+ *
+ * \return            Number of events run.
+ */
+size_t sc_inbox_drain(Inbox *inbox, size_t max_events);
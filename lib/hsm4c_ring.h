@@ -0,0 +1,114 @@
+/**
+ * \brief Bounded lock-free ring of the inbox and the executor mailboxes. Private.
+ * \file
+ *
+ * Producers claim a position, write the cell and publish it by storing the position + 1 to its
+ * sequence (release). The consumer reads cells in position order as soon as their sequence is
+ * published (acquire) and hands the cell back to producers by advancing the sequence by the
+ * capacity.
+ *
+ * Cells are caller defined structs starting with an `atomic_size_t` sequence. Only one thread
+ * consumes.
+ *
+ * (C) 2023 David Bongartz
+ * MIT License
+ */
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** \brief Ring state. Private. */
+typedef struct Ring_ {
+  /** \brief Cells. [_capacity] */
+  unsigned char *_cells;
+  /** \brief Size of one cell in bytes */
+  size_t _stride;
+  /** \brief Number of cells, a power of two */
+  size_t _capacity;
+  /** \brief Position of the next claim */
+  _Alignas(64) atomic_size_t _tail;
+  /** \brief Position of the next taken cell. Only touched by the consumer. */
+  _Alignas(64) atomic_size_t _head;
+} Ring_;
+
+/** \brief Sequence of the cell at a position. */
+static inline atomic_size_t *sc_ring_seq_(Ring_ const *r, size_t pos) {
+  return (atomic_size_t *)(void *)&r->_cells[(pos & (r->_capacity - 1)) * r->_stride];
+}
+
+/** \brief Empty ring. Returns false if capacity is not a power of two. */
+static inline bool sc_ring_init_(Ring_ *r, void *cells, size_t stride, size_t capacity) {
+  if (!capacity || (capacity & (capacity - 1))) {
+    return false;
+  }
+  r->_cells = cells;
+  r->_stride = stride;
+  r->_capacity = capacity;
+  atomic_init(&r->_tail, 0);
+  atomic_init(&r->_head, 0);
+  for (size_t k = 0; k < capacity; ++k) {
+    atomic_init(sc_ring_seq_(r, k), k);
+  }
+  return true;
+}
+
+/** \brief Cell at a claimed or taken position. */
+static inline void *sc_ring_cell_(Ring_ const *r, size_t pos) { return sc_ring_seq_(r, pos); }
+
+/** \brief Claims a position, only producer: Wait-free. Returns false if full. */
+static inline bool sc_ring_claim_single_(Ring_ *r, size_t *pos) {
+  *pos = atomic_load_explicit(&r->_tail, memory_order_relaxed);
+  if (atomic_load_explicit(sc_ring_seq_(r, *pos), memory_order_acquire) != *pos) {
+    // Consumer did not take this cell yet
+    return false;
+  }
+  atomic_store_explicit(&r->_tail, *pos + 1, memory_order_relaxed);
+  return true;
+}
+
+/** \brief Claims a position, any number of producers: Lock-free. Returns false if full. */
+static inline bool sc_ring_claim_(Ring_ *r, size_t *pos) {
+  *pos = atomic_load_explicit(&r->_tail, memory_order_relaxed);
+  for (;;) {
+    size_t const seq = atomic_load_explicit(sc_ring_seq_(r, *pos), memory_order_acquire);
+    intptr_t const diff = (intptr_t)seq - (intptr_t)*pos;
+
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&r->_tail, pos, *pos + 1, memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        return true;
+      }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      *pos = atomic_load_explicit(&r->_tail, memory_order_relaxed);
+    }
+  }
+}
+
+/** \brief Publishes the written cell of a claimed position. */
+static inline void sc_ring_publish_(Ring_ *r, size_t pos) {
+  atomic_store_explicit(sc_ring_seq_(r, pos), pos + 1, memory_order_release);
+}
+
+/** \brief Position of the next published cell. Returns false if there is none. */
+static inline bool sc_ring_peek_(Ring_ *r, size_t *pos) {
+  *pos = atomic_load_explicit(&r->_head, memory_order_relaxed);
+  return atomic_load_explicit(sc_ring_seq_(r, *pos), memory_order_acquire) == *pos + 1;
+}
+
+/** \brief Hands the peeked cell back to producers. */
+static inline void sc_ring_pop_(Ring_ *r, size_t pos) {
+  atomic_store_explicit(sc_ring_seq_(r, pos), pos + r->_capacity, memory_order_release);
+  atomic_store_explicit(&r->_head, pos + 1, memory_order_relaxed);
+}
+
+/** \brief Whether every claimed position has been taken. Only called by the consumer. */
+static inline bool sc_ring_drained_(Ring_ *r) {
+  return atomic_load_explicit(&r->_tail, memory_order_acquire) ==
+         atomic_load_explicit(&r->_head, memory_order_relaxed);
+}
@@ -0,0 +1,122 @@
+/**
+ * \brief Per-state and per-transition counters and latency histograms
+ * \file
+ *
+ * (C) 2023 David Bongartz
+ * MIT License
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "hsm4c_stats.h"
+
+#include <string.h>
+#include <time.h>
+
+/* -------- Private -------- */
+
+/** \brief Default timestamp source. Monotonic nanoseconds. */
+static uint64_t monotonic_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t load(_Atomic uint64_t const *counter) {
+  return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+static void copy_histogram(StatsCounters_ const *h, StatsHistogram *out) {
+  for (size_t i = 0; i < SC_STATS_BUCKETS; ++i) {
+    out->count[i] = load(&h->count[i]);
+  }
+  out->total = load(&h->total);
+}
+
+/** \brief Id of a transition. num_transitions if not in the chart. */
+static size_t transition_id(Chart const *chart, Transition const *transition) {
+  size_t id = 0;
+  while (id < chart->num_transitions && chart->_transitions[id] != transition) {
+    ++id;
+  }
+  return id;
+}
+
+/* -------- Public -------- */
+
+size_t sc_stats_attach(Chart *chart, ChartStats *stats, void *mem, size_t mem_size,
+                       uint64_t (*clock)(void)) {
+  size_t const states_size = chart->num_states * sizeof(StateCounters_);
+  size_t const size = states_size + chart->num_transitions * sizeof(_Atomic uint64_t);
+  if (!mem || size > mem_size) {
+    return size;
+  }
+
+  memset(mem, 0, size);
+  memset(stats, 0, sizeof(*stats));
+  stats->_clock = clock ? clock : monotonic_ns;
+  stats->_states = mem;
+  stats->_transition_hits = (_Atomic uint64_t *)((char *)mem + states_size);
+  chart->_stats = stats;
+  return size;
+}
+
+void sc_stats_detach(Chart *chart) { chart->_stats = NULL; }
+
+void sc_stats_run(Chart const *chart, StatsHistogram *out) {
+  *out = (StatsHistogram){0};
+  if (chart->_stats) {
+    copy_histogram(&chart->_stats->_run, out);
+  }
+}
+
+uint64_t sc_stats_transition(Chart const *chart, Transition const *transition) {
+  size_t const id = transition_id(chart, transition);
+  if (!chart->_stats || id == chart->num_transitions) {
+    return 0;
+  }
+  return load(&chart->_stats->_transition_hits[id]);
+}
+
+void sc_stats_state(Chart const *chart, State const *state, StateStats *out) {
+  *out = (StateStats){0};
+  ChartStats const *const stats = chart->_stats;
+  if (!stats) {
+    return;
+  }
+
+  StateCounters_ const *const s = &stats->_states[state - chart->states];
+  out->entries = load(&s->entries);
+  out->exits = load(&s->exits);
+  // Every active instance still misses its exit timestamp, count it as exited now
+  out->residency = load(&s->residency) + (out->entries - out->exits) * stats->_clock();
+  out->runs = load(&s->runs);
+  out->run_skips = load(&s->run_skips);
+  copy_histogram(&s->entry_fn, &out->entry_fn);
+  copy_histogram(&s->exit_fn, &out->exit_fn);
+  copy_histogram(&s->run_fn, &out->run_fn);
+}
+
+uint64_t sc_stats_quantile(StatsHistogram const *h, double q) {
+  uint64_t n = 0;
+  for (size_t i = 0; i < SC_STATS_BUCKETS; ++i) {
+    n += h->count[i];
+  }
+  if (!n) {
+    return 0;
+  }
+
+  uint64_t const rank = (uint64_t)(q * (double)(n - 1));
+  uint64_t seen = 0;
+  size_t i = 0;
+  for (; i < SC_STATS_BUCKETS - 1; ++i) {
+    seen += h->count[i];
+    if (seen > rank) {
+      break;
+    }
+  }
+  if (i == SC_STATS_BUCKETS - 1) {
+    return UINT64_MAX;
+  }
+  return i ? ((uint64_t)1 << i) - 1 : 0;
+}
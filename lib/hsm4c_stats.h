@@ -0,0 +1,220 @@
+/**
+ * \brief Per-state and per-transition counters and latency histograms
+ * \file
+ *
+ * Counts how often every transition of a chart is taken, how long its states are active and how
+ * often their run functions are called or skipped, and keeps log2 bucketed latency histograms of
+ * `sc_run()` and of every entry, exit and run function.
+ * Statistics are kept per Chart, summed over all machines running it.
+ *
+ * Compiled in only if the library is built with `HSM4C_STATS` defined. Otherwise every counting
+ * point is removed by the preprocessor. With it defined, a chart without attached statistics
+ * costs one pointer test per counting point.
+ *
+ * Counters are relaxed atomics, so machines of one chart can run on any number of threads and
+ * the sc_stats_*() readers can be called at any time without stopping them. A snapshot taken
+ * while machines run is not consistent across counters.
+ *
+ * (C) 2023 David Bongartz
+ * MIT License
+ */
+
+#pragma once
+
+#include "hsm4c.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** \brief Number of histogram buckets */
+#define SC_STATS_BUCKETS 32
+
+/**
+ * \brief Latency histogram
+ *
+ * Bucket 0 counts durations of 0 ticks, bucket `i` durations of `2^(i-1) .. 2^i - 1` ticks. The
+ * last bucket also counts everything longer.
+ */
+typedef struct StatsHistogram {
+  /** \brief Number of durations per bucket */
+  uint64_t count[SC_STATS_BUCKETS];
+  /** \brief Sum of all durations in ticks */
+  uint64_t total;
+} StatsHistogram;
+
+/** \brief Statistics of one state */
+typedef struct StateStats {
+  /** \brief Number of times the state was entered */
+  uint64_t entries;
+  /** \brief Number of times the state was exited */
+  uint64_t exits;
+  /** \brief Ticks the state was active, summed over all machines */
+  uint64_t residency;
+  /** \brief Number of run function calls */
+  uint64_t runs;
+  /** \brief Number of run function calls skipped by the run policy of the state */
+  uint64_t run_skips;
+  /** \brief Latency of the entry function */
+  StatsHistogram entry_fn;
+  /** \brief Latency of the exit function */
+  StatsHistogram exit_fn;
+  /** \brief Latency of the run function */
+  StatsHistogram run_fn;
+} StateStats;
+
+/** \brief Live histogram. Private, read with sc_stats_*(). */
+typedef struct StatsCounters_ {
+  _Atomic uint64_t count[SC_STATS_BUCKETS];
+  _Atomic uint64_t total;
+} StatsCounters_;
+
+/** \brief Live statistics of one state. Private, read with sc_stats_state(). */
+typedef struct StateCounters_ {
+  _Atomic uint64_t entries;
+  _Atomic uint64_t exits;
+  /** \brief Sum of exit timestamps minus sum of entry timestamps */
+  _Atomic uint64_t residency;
+  _Atomic uint64_t runs;
+  _Atomic uint64_t run_skips;
+  StatsCounters_ entry_fn;
+  StatsCounters_ exit_fn;
+  StatsCounters_ run_fn;
+} StateCounters_;
+
+/** \brief Statistics attached to a chart. All members are private. */
+struct ChartStats {
+  /** \brief Timestamp source */
+  uint64_t (*_clock)(void);
+  /** \brief Latency of sc_run() */
+  StatsCounters_ _run;
+  /** \brief Hits per transition id. [chart->num_transitions] */
+  _Atomic uint64_t *_transition_hits;
+  /** \brief [chart->num_states] */
+  StateCounters_ *_states;
+};
+
+/**
+ * \brief Attaches statistics to a chart
+ *
+ * Attach before the first `sc_init()` of a machine running the chart: A state's residency only
+ * adds up correctly if its entry was counted.
+ *
+ * `sc_init()` of a running machine counts its active states as exited, `sc_restore()` also counts
+ * the restored ones as entered. Their entry and exit latencies are not counted.
+ *
+ * \param chart     Compiled chart.
+ * \param stats     Statistics to initialize.
+ * \param mem       Memory for the counters. Must be aligned for uint64_t.
+ * \param mem_size  Size of `mem` in bytes.
+ * \param clock     Timestamp source, e.g. a cycle counter. NULL for a monotonic clock in
+ *                  nanoseconds.
+ *
+ * \return          Required size in bytes. Attached if this is <= mem_size.
+ */
+size_t sc_stats_attach(Chart *chart, ChartStats *stats, void *mem, size_t mem_size,
+                       uint64_t (*clock)(void));
+
+/** \brief Detaches statistics from a chart. */
+void sc_stats_detach(Chart *chart);
+
+/** \brief Copies the histogram of sc_run() latency. Zero if no statistics are attached. */
+void sc_stats_run(Chart const *chart, StatsHistogram *out);
+
+/** \brief Number of times a transition of the chart was taken. */
+uint64_t sc_stats_transition(Chart const *chart, Transition const *transition);
+
+/**
+ * \brief Copies the statistics of a state
+ *
+ * The residency includes the time the state is active in machines right now.
+ */
+void sc_stats_state(Chart const *chart, State const *state, StateStats *out);
+
+/**
+ * \brief Duration below which a fraction of the histogram lies
+ *
+ * \param h   Histogram.
+ * \param q   Fraction, 0 .. 1.
+ *
+ * \return    Upper bound of the bucket containing the quantile, in ticks. 0 if empty, UINT64_MAX
+ *            if in the last bucket.
+ */
+uint64_t sc_stats_quantile(StatsHistogram const *h, double q);
+
+/* -------- Counting points. Private, used by the library. -------- */
+
+static inline uint64_t sc_stats_now_(ChartStats const *stats) {
+  return stats ? stats->_clock() : 0;
+}
+
+static inline void sc_stats_add_(_Atomic uint64_t *counter, uint64_t v) {
+  atomic_fetch_add_explicit(counter, v, memory_order_relaxed);
+}
+
+static inline void sc_stats_latency_(StatsCounters_ *h, uint64_t ticks) {
+  unsigned bucket = 0;
+#if defined(__GNUC__)
+  bucket = ticks ? 64 - (unsigned)__builtin_clzll(ticks) : 0;
+#else
+  for (uint64_t t = ticks; t; t >>= 1) {
+    ++bucket;
+  }
+#endif
+  sc_stats_add_(&h->count[bucket < SC_STATS_BUCKETS ? bucket : SC_STATS_BUCKETS - 1], 1);
+  sc_stats_add_(&h->total, ticks);
+}
+
+/** \brief State entered at `start`, entry function (if `called`) returned now. */
+static inline void sc_stats_entry_(ChartStats *stats, StateId id, uint64_t start, bool called) {
+  if (stats) {
+    StateCounters_ *const s = &stats->_states[id];
+    sc_stats_add_(&s->entries, 1);
+    sc_stats_add_(&s->residency, 0 - start);
+    if (called) {
+      sc_stats_latency_(&s->entry_fn, stats->_clock() - start);
+    }
+  }
+}
+
+/** \brief State exited at `start`, exit function (if `called`) returned now. */
+static inline void sc_stats_exit_(ChartStats *stats, StateId id, uint64_t start, bool called) {
+  if (stats) {
+    StateCounters_ *const s = &stats->_states[id];
+    sc_stats_add_(&s->exits, 1);
+    sc_stats_add_(&s->residency, start);
+    if (called) {
+      sc_stats_latency_(&s->exit_fn, stats->_clock() - start);
+    }
+  }
+}
+
+/** \brief Run function of a state called at `start` returned now. */
+static inline void sc_stats_run_fn_(ChartStats *stats, StateId id, uint64_t start) {
+  if (stats) {
+    sc_stats_add_(&stats->_states[id].runs, 1);
+    sc_stats_latency_(&stats->_states[id].run_fn, stats->_clock() - start);
+  }
+}
+
+/** \brief Run function of a state not called, nothing to do for the event. */
+static inline void sc_stats_run_skip_(ChartStats *stats, StateId id) {
+  if (stats) {
+    sc_stats_add_(&stats->_states[id].run_skips, 1);
+  }
+}
+
+/** \brief sc_run() called at `start` returns now. */
+static inline void sc_stats_run_(ChartStats *stats, uint64_t start) {
+  if (stats) {
+    sc_stats_latency_(&stats->_run, stats->_clock() - start);
+  }
+}
+
+/** \brief Transition taken. */
+static inline void sc_stats_transition_(ChartStats *stats, uint16_t id) {
+  if (stats) {
+    sc_stats_add_(&stats->_transition_hits[id], 1);
+  }
+}
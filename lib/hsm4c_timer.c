@@ -0,0 +1,151 @@
+/**
+ * \brief Time triggered transitions on a hierarchical timing wheel
+ * \file
+ *
+ * (C) 2023 David Bongartz
+ * MIT License
+ */
+
+#include "hsm4c_timer.h"
+
+#include <stdbool.h>
+
+/* -------- Private -------- */
+
+_Static_assert(SC_WHEEL_BITS * SC_WHEEL_LEVELS > 32, "every `after` must fit into the wheel");
+
+/** \brief Ticks covered by the levels below `level`. */
+static uint64_t level_span(unsigned level) { return UINT64_C(1) << (SC_WHEEL_BITS * level); }
+
+static unsigned lowest_bit(uint64_t v) {
+#if defined(__GNUC__)
+  return (unsigned)__builtin_ctzll(v);
+#else
+  unsigned n = 0;
+  for (; !(v & 1); v >>= 1) {
+    ++n;
+  }
+  return n;
+#endif
+}
+
+/** \brief Takes all timers of a slot and inserts them again, relative to the current tick. */
+static void relink(TimerWheel *wheel, unsigned slot) {
+  Timer *timer = wheel->_slots[slot];
+  wheel->_slots[slot] = NULL;
+  if (slot != SC_WHEEL_OVERFLOW) {
+    wheel->_occupied[slot / SC_WHEEL_SLOTS] &= ~(UINT64_C(1) << (slot % SC_WHEEL_SLOTS));
+  }
+  while (timer) {
+    Timer *const next = timer->_next;
+    sc_timer_link_(wheel, timer);
+    timer = next;
+  }
+}
+
+/** \brief Moves the slots the current tick just reached down the levels. */
+static void cascade(TimerWheel *wheel) {
+  uint64_t const now = wheel->_now;
+  if (now % level_span(SC_WHEEL_LEVELS) == 0) {
+    relink(wheel, SC_WHEEL_OVERFLOW);
+  }
+  for (unsigned level = SC_WHEEL_LEVELS - 1; level > 0; --level) {
+    if (now % level_span(level) == 0) {
+      relink(wheel, level * SC_WHEEL_SLOTS +
+                        (unsigned)((now >> (SC_WHEEL_BITS * level)) & (SC_WHEEL_SLOTS - 1)));
+    }
+  }
+}
+
+/**
+ * \brief Next tick after the current one at which a timer fires or a slot cascades
+ *
+ * Levels below the first occupied one are empty, so everything up to the start of its next
+ * occupied slot can be skipped.
+ */
+static uint64_t next_event(TimerWheel const *wheel) {
+  uint64_t const now = wheel->_now;
+  for (unsigned level = 0; level < SC_WHEEL_LEVELS; ++level) {
+    unsigned const digit = (unsigned)((now >> (SC_WHEEL_BITS * level)) & (SC_WHEEL_SLOTS - 1));
+    uint64_t const later =
+        digit + 1 < SC_WHEEL_SLOTS ? wheel->_occupied[level] & (~UINT64_C(0) << (digit + 1)) : 0;
+    if (later) {
+      uint64_t const block = now - now % level_span(level + 1);
+      return block + lowest_bit(later) * level_span(level);
+    }
+  }
+  if (wheel->_slots[SC_WHEEL_OVERFLOW]) {
+    return now - now % level_span(SC_WHEEL_LEVELS) + level_span(SC_WHEEL_LEVELS);
+  }
+  return UINT64_MAX;
+}
+
+static uint64_t earliest_in(Timer const *timer) {
+  uint64_t deadline = UINT64_MAX;
+  for (; timer; timer = timer->_next) {
+    deadline = timer->_deadline < deadline ? timer->_deadline : deadline;
+  }
+  return deadline;
+}
+
+/** \brief Runs the machine of a due timer with its SC_TIMEOUT event. */
+static void fire(Timer *timer) {
+  sc_run_event(timer->_machine, &(Event const){.type = SC_TIMEOUT, .data = timer});
+}
+
+/* -------- Public -------- */
+
+void sc_wheel_init(TimerWheel *wheel, uint64_t now) { *wheel = (TimerWheel){._now = now}; }
+
+void sc_machine_timers(Machine *sm, TimerWheel *wheel, Timer timers[]) {
+  sm->_wheel = wheel;
+  sm->_timers = timers;
+  for (size_t k = 0; k < sm->chart->num_timers; ++k) {
+    timers[k] = (Timer){._machine = sm};
+  }
+}
+
+size_t sc_wheel_advance(TimerWheel *wheel, uint64_t now) {
+  size_t fired = 0;
+  if (now < wheel->_now) {
+    return 0;
+  }
+
+  for (;;) {
+    // Everything in the level 0 slot of the current tick is due. Timers armed meanwhile are later.
+    Timer **const due = &wheel->_slots[wheel->_now % SC_WHEEL_SLOTS];
+    while (*due) {
+      Timer *const timer = *due;
+      sc_timer_cancel_(wheel, timer);
+      fire(timer);
+      ++fired;
+    }
+    if (wheel->_now == now) {
+      break;
+    }
+    uint64_t const next = next_event(wheel);
+    wheel->_now = next < now ? next : now;
+    cascade(wheel);
+  }
+  return fired;
+}
+
+uint64_t sc_next_deadline(TimerWheel const *wheel) {
+  uint64_t const now = wheel->_now;
+  for (unsigned level = 0; level < SC_WHEEL_LEVELS; ++level) {
+    uint64_t const occupied = wheel->_occupied[level];
+    if (!occupied) {
+      continue;
+    }
+    // Level 0 slots hold a single deadline each, higher ones a range
+    unsigned const digit = (unsigned)((now >> (SC_WHEEL_BITS * level)) & (SC_WHEEL_SLOTS - 1));
+    unsigned const slot = lowest_bit(occupied & (~UINT64_C(0) << digit));
+    if (level == 0) {
+      return now - now % SC_WHEEL_SLOTS + slot;
+    }
+    return earliest_in(wheel->_slots[level * SC_WHEEL_SLOTS + slot]);
+  }
+  return earliest_in(wheel->_slots[SC_WHEEL_OVERFLOW]);
+}
+
+uint64_t sc_wheel_now(TimerWheel const *wheel) { return wheel->_now; }
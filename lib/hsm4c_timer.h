@@ -0,0 +1,165 @@
+/**
+ * \brief Time triggered transitions on a hierarchical timing wheel
+ * \file
+ *
+ * A transition with `after` set is taken `after` ticks after its source state was entered, as
+ * long as the source stays active. Its timer is armed when the source is entered and cancelled
+ * when it is exited, both in O(1). One TimerWheel serves any number of machines.
+ *
+ * The wheel has no clock of its own. Time only moves with `sc_wheel_advance()`, in ticks of any
+ * unit, so tests drive it with a plain counter. For tickless sleeping ask `sc_next_deadline()`
+ * when to advance next.
+ *
+ * A wheel and all machines attached to it must be used from one thread. Do not advance a wheel
+ * from state or transition functions.
+ *
+ * (C) 2023 David Bongartz
+ * MIT License
+ */
+
+#pragma once
+
+#include "hsm4c.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** \brief Bits of the deadline per wheel level */
+#define SC_WHEEL_BITS 6
+/** \brief Slots per wheel level */
+#define SC_WHEEL_SLOTS (1u << SC_WHEEL_BITS)
+/** \brief Number of levels. Covers 2^36 ticks, every `after` fits. */
+#define SC_WHEEL_LEVELS 6
+/** \brief Slot of timers whose deadline crosses the range of the top level. */
+#define SC_WHEEL_OVERFLOW (SC_WHEEL_LEVELS * SC_WHEEL_SLOTS)
+
+/** \brief Timer of one time triggered transition of one machine. All members are private. */
+struct Timer {
+  /** \brief Next timer in the slot */
+  Timer *_next;
+  /** \brief Link pointing to this timer. NULL if not armed. */
+  Timer **_prev;
+  /** \brief Tick at which the timer fires */
+  uint64_t _deadline;
+  /** \brief Machine owning the timer */
+  Machine *_machine;
+  /** \brief Wheel slot */
+  uint16_t _slot;
+};
+
+/**
+ * \brief Hierarchical timing wheel. All members are private.
+ *
+ * Level `l` holds timers whose deadline first differs from the current tick in bits
+ * `6 * l .. 6 * l + 5`, in the slot given by those bits of the deadline. A higher level slot is
+ * moved down a level when the current tick reaches it.
+ */
+struct TimerWheel {
+  /** \brief Current tick */
+  uint64_t _now;
+  /** \brief Bitmap of non-empty slots per level */
+  uint64_t _occupied[SC_WHEEL_LEVELS];
+  /** \brief Timer lists, level after level, then the overflow list */
+  Timer *_slots[SC_WHEEL_OVERFLOW + 1];
+};
+
+/**
+ * \brief Initializes a wheel without timers
+ *
+ * \param wheel   Wheel.
+ * \param now     Current tick.
+ */
+void sc_wheel_init(TimerWheel *wheel, uint64_t now);
+
+/**
+ * \brief Attaches timers of a wheel to a machine
+ *
+ * Call after `sc_machine_init()` and before `sc_init()`. Without timers attached, time triggered
+ * transitions are never taken. The machine must not move in memory while attached.
+ *
+ * \param sm      Machine.
+ * \param wheel   Wheel serving the timers.
+ * \param timers  Storage for `sm->chart->num_timers` timers.
+ */
+void sc_machine_timers(Machine *sm, TimerWheel *wheel, Timer timers[]);
+
+/**
+ * \brief Moves time forward and takes all time triggered transitions due until then
+ *
+ * Every due timer runs its machine with a SC_TIMEOUT event. Timers due at the same tick fire in
+ * an unspecified but deterministic order. Timers armed by those runs fire in the same call if
+ * they are due by `now`.
+ *
+ * \param wheel   Wheel.
+ * \param now     Current tick. Nothing happens if it is before the wheel time.
+ *
+ * \return        Number of timers fired.
+ */
+size_t sc_wheel_advance(TimerWheel *wheel, uint64_t now);
+
+/**
+ * \brief Tick of the earliest armed timer
+ *
+ * Looks at one bitmap per level and at most one slot list.
+ *
+ * \return        UINT64_MAX if no timer is armed.
+ */
+uint64_t sc_next_deadline(TimerWheel const *wheel);
+
+/** \brief Current tick of the wheel, as of the last sc_wheel_advance(). */
+uint64_t sc_wheel_now(TimerWheel const *wheel);
+
+/* -------- Arm and cancel. Private, used by the library. -------- */
+
+/** \brief Slot for a deadline, relative to the current tick. */
+static inline unsigned sc_timer_slot_(TimerWheel const *wheel, uint64_t deadline) {
+  uint64_t const diff = deadline ^ wheel->_now;
+  unsigned level = 0;
+  while (level < SC_WHEEL_LEVELS && diff >> (SC_WHEEL_BITS * (level + 1))) {
+    ++level;
+  }
+  if (level == SC_WHEEL_LEVELS) {
+    return SC_WHEEL_OVERFLOW;
+  }
+  return level * SC_WHEEL_SLOTS +
+         (unsigned)((deadline >> (SC_WHEEL_BITS * level)) & (SC_WHEEL_SLOTS - 1));
+}
+
+/** \brief Inserts an unarmed timer at the slot of its deadline. */
+static inline void sc_timer_link_(TimerWheel *wheel, Timer *timer) {
+  unsigned const slot = sc_timer_slot_(wheel, timer->_deadline);
+  Timer **const head = &wheel->_slots[slot];
+  timer->_slot = (uint16_t)slot;
+  timer->_next = *head;
+  timer->_prev = head;
+  if (*head) {
+    (*head)->_prev = &timer->_next;
+  }
+  *head = timer;
+  if (slot != SC_WHEEL_OVERFLOW) {
+    wheel->_occupied[slot / SC_WHEEL_SLOTS] |= UINT64_C(1) << (slot % SC_WHEEL_SLOTS);
+  }
+}
+
+/** \brief Disarms a timer. Nothing happens if it is not armed. */
+static inline void sc_timer_cancel_(TimerWheel *wheel, Timer *timer) {
+  if (!timer->_prev) {
+    return;
+  }
+  *timer->_prev = timer->_next;
+  if (timer->_next) {
+    timer->_next->_prev = timer->_prev;
+  }
+  unsigned const slot = timer->_slot;
+  if (slot != SC_WHEEL_OVERFLOW && !wheel->_slots[slot]) {
+    wheel->_occupied[slot / SC_WHEEL_SLOTS] &= ~(UINT64_C(1) << (slot % SC_WHEEL_SLOTS));
+  }
+  timer->_prev = NULL;
+}
+
+/** \brief (Re)arms a timer to fire `ticks` after the current tick. */
+static inline void sc_timer_arm_(TimerWheel *wheel, Timer *timer, uint32_t ticks) {
+  sc_timer_cancel_(wheel, timer);
+  timer->_deadline = wheel->_now + ticks;
+  sc_timer_link_(wheel, timer);
+}
@@ -0,0 +1,76 @@
+/**
+ * \brief Binary transition trace buffer and decoder
+ * \file
+ *
+ * (C) 2023 David Bongartz
+ * MIT License
+ */
+
+#include "hsm4c_trace.h"
+
+#include <stdio.h>
+
+/* -------- Private -------- */
+
+_Thread_local TraceBuffer *sc_trace_buffer_ = NULL;
+
+static char const *const kind_names[] = {
+    [SC_TRACE_EVENT] = "event",
+    [SC_TRACE_GUARD] = "guard",
+    [SC_TRACE_TRANSITION] = "transition",
+    [SC_TRACE_RUN_REQUEST] = "run request",
+    [SC_TRACE_ENTRY] = "entry",
+    [SC_TRACE_EXIT] = "exit",
+};
+
+/** \brief Name of a state, its index if it has none. */
+static char const *state_name(Chart const *chart, StateId id, char buf[8]) {
+  if (id < chart->num_states && chart->states[id].config->name) {
+    return chart->states[id].config->name;
+  }
+  snprintf(buf, 8, "#%u", (unsigned)id);
+  return buf;
+}
+
+/* -------- Public -------- */
+
+void sc_trace_attach(TraceBuffer *buf, TraceRecord records[], uint32_t capacity,
+                     uint64_t (*clock)(void)) {
+  if (buf) {
+    *buf = (TraceBuffer){.records = records, .capacity = capacity, .clock = clock};
+  }
+  sc_trace_buffer_ = buf;
+}
+
+size_t sc_trace_dump(TraceBuffer const *buf, TraceRecord out[], size_t max) {
+  uint64_t const written = buf->written;
+  uint64_t n = written < buf->capacity ? written : buf->capacity;
+  n = n < max ? n : max;
+  for (uint64_t i = 0; i < n; ++i) {
+    out[i] = buf->records[(written - n + i) & (buf->capacity - 1)];
+  }
+  return (size_t)n;
+}
+
+int sc_trace_decode(Chart const *chart, TraceRecord const *record, char *text, size_t size) {
+  char from_buf[8];
+  char to_buf[8];
+  char const *const from = state_name(chart, record->from, from_buf);
+  char const *const to = state_name(chart, record->to, to_buf);
+  char const *const kind =
+      record->kind < sizeof(kind_names) / sizeof(*kind_names) ? kind_names[record->kind] : "?";
+
+  switch ((TraceKind)record->kind) {
+  case SC_TRACE_GUARD:
+    return snprintf(text, size, "%llu %p %s %d: %s -> %s = %s",
+                    (unsigned long long)record->timestamp, record->machine, kind, record->event,
+                    from, to, record->result ? "true" : "false");
+  case SC_TRACE_TRANSITION:
+  case SC_TRACE_RUN_REQUEST:
+    return snprintf(text, size, "%llu %p %s %d: %s -> %s", (unsigned long long)record->timestamp,
+                    record->machine, kind, record->event, from, to);
+  default:
+    return snprintf(text, size, "%llu %p %s %d: %s", (unsigned long long)record->timestamp,
+                    record->machine, kind, record->event, from);
+  }
+}
@@ -0,0 +1,133 @@
+/**
+ * \brief Binary transition trace
+ * \file
+ *
+ * Records what `sc_run()` did into a per-thread ring buffer of fixed size binary records: Events,
+ * guard outcomes, transitions, state changes requested by run functions and entry/exit of states.
+ *
+ * Compiled in only if the library is built with `HSM4C_TRACE` defined. Otherwise every trace
+ * point is removed by the preprocessor. Recording costs one thread local load when no buffer is
+ * attached, and a record store with a plain counter increment when one is.
+ *
+ * Every thread writes only its own buffer, so recording needs no locks or atomics. Dump a buffer
+ * from its thread, or from another one once its thread stopped running machines.
+ *
+ * (C) 2023 David Bongartz
+ * MIT License
+ */
+
+#pragma once
+
+#include "hsm4c.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** \brief Kind of a trace record */
+typedef enum TraceKind {
+  /** \brief sc_run() got an event. from: active leaf. */
+  SC_TRACE_EVENT,
+  /** \brief Guard evaluated. from/to: transition, result: guard outcome. */
+  SC_TRACE_GUARD,
+  /** \brief Transition taken. from/to: transition. */
+  SC_TRACE_TRANSITION,
+  /** \brief Run function requested a state. from: state of the run function, to: requested. */
+  SC_TRACE_RUN_REQUEST,
+  /** \brief State entered. from: state. */
+  SC_TRACE_ENTRY,
+  /** \brief State exited. from: state. */
+  SC_TRACE_EXIT,
+} TraceKind;
+
+/** \brief One trace record. 32 bytes. */
+typedef struct TraceRecord {
+  /** \brief TraceBuffer clock, or sequence number if it has none */
+  uint64_t timestamp;
+  /** \brief Machine. Only for identification. */
+  void const *machine;
+  /** \brief Event of the sc_run() the record belongs to */
+  EventType event;
+  /** \brief State index. See TraceKind. */
+  StateId from;
+  /** \brief State index. See TraceKind. SC_NO_STATE if unused. */
+  StateId to;
+  /** \brief TraceKind */
+  uint8_t kind;
+  /** \brief Guard outcome */
+  uint8_t result;
+} TraceRecord;
+
+/** \brief Ring buffer of one thread. Oldest records get overwritten. */
+typedef struct TraceBuffer {
+  /** \brief Storage. [capacity] */
+  TraceRecord *records;
+  /** \brief Number of records. Power of two. */
+  uint32_t capacity;
+  /** \brief Number of records ever written. */
+  uint64_t written;
+  /** \brief Timestamp source. NULL to use the sequence number. */
+  uint64_t (*clock)(void);
+  /** \brief Event of the current sc_run() */
+  EventType event;
+} TraceBuffer;
+
+/** \brief Buffer of the calling thread. NULL if not tracing. Private, use sc_trace_attach(). */
+extern _Thread_local TraceBuffer *sc_trace_buffer_;
+
+/**
+ * \brief Starts tracing the machines run by the calling thread into a buffer
+ *
+ * \param buf       Buffer to initialize. NULL to stop tracing.
+ * \param records   Storage. [capacity]
+ * \param capacity  Number of records. Must be a power of two.
+ * \param clock     Timestamp source, e.g. a cycle counter. NULL to use a sequence number.
+ */
+void sc_trace_attach(TraceBuffer *buf, TraceRecord records[], uint32_t capacity,
+                     uint64_t (*clock)(void));
+
+/**
+ * \brief Copies the buffered records, oldest first
+ *
+ * \param buf   Buffer.
+ * \param out   Output. [max]
+ * \param max   Maximum number of records to copy. The newest ones are copied.
+ *
+ * \return      Number of records copied.
+ */
+size_t sc_trace_dump(TraceBuffer const *buf, TraceRecord out[], size_t max);
+
+/**
+ * \brief Formats one record as text using the state names of the chart
+ *
+ * \param chart   Chart the traced machine runs.
+ * \param record  Record.
+ * \param text    Output. Always terminated.
+ * \param size    Size of text.
+ *
+ * \return        Length of the text as by snprintf().
+ */
+int sc_trace_decode(Chart const *chart, TraceRecord const *record, char *text, size_t size);
+
+/**
+ * \brief Appends a record to the buffer of the calling thread. Private, used by the library.
+ *
+ * `event` is only used by SC_TRACE_EVENT, later records of the same run repeat it.
+ */
+static inline void sc_trace_record_(TraceKind kind, void const *machine, EventType event,
+                                    StateId from, StateId to, bool result) {
+  TraceBuffer *const buf = sc_trace_buffer_;
+  if (buf) {
+    if (kind == SC_TRACE_EVENT) {
+      buf->event = event;
+    }
+    TraceRecord *const r = &buf->records[buf->written & (buf->capacity - 1)];
+    r->timestamp = buf->clock ? buf->clock() : buf->written;
+    r->machine = machine;
+    r->event = buf->event;
+    r->from = from;
+    r->to = to;
+    r->kind = (uint8_t)kind;
+    r->result = result;
+    buf->written++;
+  }
+}
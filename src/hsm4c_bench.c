@@ -0,0 +1,380 @@
+/**
+ * \brief Benchmark on synthetic statecharts
+ * \file
+ *
+ * Generates a chart as a full tree of `depth` levels with `fanout` children per state, random
+ * transitions, guards and history states, drives machines with a configurable event
+ * distribution and prints one JSON object with throughput and latency percentiles.
+ *
+ * Usage: hsm4c_bench [--name=value ...], see `usage()`.
+ *
+ * (C) 2023 David Bongartz
+ * MIT License
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lib/hsm4c.h"
+
+/* -------- Config -------- */
+
+typedef enum Distribution { DIST_UNIFORM, DIST_ZIPF, DIST_HOT } Distribution;
+
+static char const *const dist_names[] = {"uniform", "zipf", "hot"};
+
+typedef struct BenchConfig {
+  unsigned depth;
+  unsigned fanout;
+  unsigned transitions;
+  unsigned guard_pct;
+  unsigned history_pct;
+  unsigned num_events;
+  unsigned machines;
+  size_t steps;
+  Distribution dist;
+  unsigned seed;
+} BenchConfig;
+
+static void usage(void) {
+  fprintf(stderr, "usage: hsm4c_bench [--depth=4] [--fanout=3] [--transitions=3] [--guards=30]\n"
+                  "                   [--history=20] [--events=16] [--machines=1] [--steps=1000000]\n"
+                  "                   [--dist=uniform|zipf|hot] [--seed=1]\n");
+}
+
+static bool parse_args(int argc, char *argv[], BenchConfig *cfg) {
+  for (int i = 1; i < argc; ++i) {
+    char const *arg = argv[i];
+    char const *value = strchr(arg, '=');
+    if (strncmp(arg, "--", 2) != 0 || !value) {
+      return false;
+    }
+    size_t const len = (size_t)(value - arg) - 2;
+    char *end;
+    unsigned long const n = strtoul(++value, &end, 10);
+#define OPTION(name) (len == strlen(name) && strncmp(&arg[2], name, len) == 0)
+    if (!OPTION("dist") && (end == value || *end)) {
+      return false;
+    }
+    if ((OPTION("guards") || OPTION("history")) && n > 100) {
+      return false;
+    }
+    if (OPTION("depth")) {
+      cfg->depth = (unsigned)n;
+    } else if (OPTION("fanout")) {
+      cfg->fanout = (unsigned)n;
+    } else if (OPTION("transitions")) {
+      cfg->transitions = (unsigned)n;
+    } else if (OPTION("guards")) {
+      cfg->guard_pct = (unsigned)n;
+    } else if (OPTION("history")) {
+      cfg->history_pct = (unsigned)n;
+    } else if (OPTION("events")) {
+      cfg->num_events = (unsigned)n;
+    } else if (OPTION("machines")) {
+      cfg->machines = (unsigned)n;
+    } else if (OPTION("steps")) {
+      cfg->steps = n;
+    } else if (OPTION("seed")) {
+      cfg->seed = (unsigned)n;
+    } else if (OPTION("dist")) {
+      size_t d = 0;
+      for (; d < sizeof(dist_names) / sizeof(*dist_names) && strcmp(value, dist_names[d]); ++d) {
+      }
+      if (d == sizeof(dist_names) / sizeof(*dist_names)) {
+        return false;
+      }
+      cfg->dist = (Distribution)d;
+    } else {
+      return false;
+    }
+#undef OPTION
+  }
+  return cfg->depth > 0 && cfg->fanout > 0 && cfg->num_events > 0 && cfg->machines > 0 &&
+         cfg->steps > 0;
+}
+
+/* -------- Random -------- */
+
+static uint64_t rng_state;
+
+static uint32_t rnd(void) {
+  // xorshift64*
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return (uint32_t)((rng_state * UINT64_C(2685821657736338717)) >> 32);
+}
+
+static bool chance(unsigned pct) { return rnd() % 100 < pct; }
+
+/* -------- Chart generator -------- */
+
+static uint32_t guard_state;
+static uint64_t actions_taken;
+
+/** \brief Cheap guard which passes 3 out of 4 calls. */
+static bool bench_guard(Machine const *sm, Event const *e) {
+  (void)sm;
+  (void)e;
+  guard_state = guard_state * 1103515245u + 12345u;
+  return (guard_state >> 16) & 3;
+}
+
+static void bench_action(Machine *sm, Event const *e) {
+  (void)sm;
+  (void)e;
+  actions_taken++;
+}
+
+typedef struct Generated {
+  size_t num_states;
+  size_t num_transitions;
+  State *states;
+  StateConfig *configs;
+  Transition **tables;
+} Generated;
+
+/** \brief Full tree of normal states, history children with history_pct chance per composite. */
+static bool generate(BenchConfig const *cfg, Generated *g) {
+  size_t max_states = 1;
+  size_t level = 1;
+  for (unsigned d = 0; d < cfg->depth; ++d) {
+    level *= cfg->fanout;
+    max_states += level + level / cfg->fanout;
+    if (max_states >= SC_NO_STATE) {
+      return false;
+    }
+  }
+
+  StateId *parent = malloc(max_states * sizeof(*parent));
+  StateId *initial = malloc(max_states * sizeof(*initial));
+  StateType *type = malloc(max_states * sizeof(*type));
+  uint16_t *depth = malloc(max_states * sizeof(*depth));
+
+  // Breadth first, root is 0
+  size_t n = 1;
+  parent[0] = SC_NO_STATE;
+  initial[0] = SC_NO_STATE;
+  type[0] = SC_TYPE_ROOT;
+  depth[0] = 0;
+  for (size_t i = 0; i < n; ++i) {
+    initial[i] = SC_NO_STATE;
+    if (depth[i] == cfg->depth || (type[i] != SC_TYPE_NORMAL && type[i] != SC_TYPE_ROOT)) {
+      continue;
+    }
+    initial[i] = (StateId)n;
+    for (unsigned c = 0; c < cfg->fanout; ++c, ++n) {
+      parent[n] = (StateId)i;
+      type[n] = SC_TYPE_NORMAL;
+      depth[n] = depth[i] + 1;
+    }
+    if (i != 0 && chance(cfg->history_pct)) {
+      parent[n] = (StateId)i;
+      type[n] = chance(50) ? SC_TYPE_HISTORY : SC_TYPE_HISTORY_DEEP;
+      depth[n] = depth[i] + 1;
+      ++n;
+    }
+  }
+
+  g->num_states = n;
+  g->num_transitions = 0;
+  g->states = calloc(n, sizeof(*g->states));
+  g->configs = calloc(n, sizeof(*g->configs));
+  g->tables = calloc(n, sizeof(*g->tables));
+
+  for (size_t i = 0; i < n; ++i) {
+    Transition *table = NULL;
+    if (type[i] == SC_TYPE_NORMAL && cfg->transitions) {
+      table = malloc((cfg->transitions + 1) * sizeof(*table));
+      for (unsigned k = 0; k < cfg->transitions; ++k) {
+        size_t to = 1 + rnd() % (n - 1);
+        memcpy(&table[k],
+               &(Transition const){
+                   .from = &g->states[i],
+                   .to = &g->states[to],
+                   .event = (EventType)(1 + rnd() % cfg->num_events),
+                   .transition_fn = bench_action,
+                   .guard_fn = chance(cfg->guard_pct) ? bench_guard : NULL,
+               },
+               sizeof(*table));
+      }
+      memcpy(&table[cfg->transitions], &SC_TRANSITIONS_END, sizeof(*table));
+      g->num_transitions += cfg->transitions;
+    }
+    g->tables[i] = table;
+    memcpy(&g->configs[i],
+           &(StateConfig const){
+               .parent = parent[i] == SC_NO_STATE ? NULL : &g->states[parent[i]],
+               .initial = initial[i] == SC_NO_STATE ? NULL : &g->states[initial[i]],
+               .type = type[i],
+               .transitions = table,
+           },
+           sizeof(g->configs[i]));
+  }
+  sc_map_stateconfig_to_states(n, g->states, g->configs);
+
+  free(parent);
+  free(initial);
+  free(type);
+  free(depth);
+  return true;
+}
+
+/* -------- Workload -------- */
+
+/** \brief Draws events from the configured distribution. */
+static void generate_events(BenchConfig const *cfg, EventType events[], uint32_t machines[]) {
+  double *cdf = malloc(cfg->num_events * sizeof(*cdf));
+  double sum = 0;
+  for (unsigned e = 0; e < cfg->num_events; ++e) {
+    sum += 1.0 / (e + 1);
+    cdf[e] = sum;
+  }
+
+  for (size_t i = 0; i < cfg->steps; ++i) {
+    unsigned e = 0;
+    switch (cfg->dist) {
+    case DIST_UNIFORM:
+      e = rnd() % cfg->num_events;
+      break;
+    case DIST_ZIPF: {
+      double const u = (double)rnd() / UINT32_MAX * sum;
+      for (; e + 1 < cfg->num_events && cdf[e] < u; ++e) {
+      }
+      break;
+    }
+    case DIST_HOT:
+      e = chance(90) ? 0 : rnd() % cfg->num_events;
+      break;
+    }
+    events[i] = (EventType)(e + 1);
+    machines[i] = rnd() % cfg->machines;
+  }
+  free(cdf);
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u64(void const *a, void const *b) {
+  uint64_t const l = *(uint64_t const *)a;
+  uint64_t const r = *(uint64_t const *)b;
+  return (l > r) - (l < r);
+}
+
+static void init_machines(BenchConfig const *cfg, Chart const *chart, Machine sms[],
+                          StateId slots[]) {
+  guard_state = cfg->seed;
+  for (unsigned m = 0; m < cfg->machines; ++m) {
+    sc_machine_init(&sms[m], chart, &slots[m * chart->machine_slots], NULL);
+    sc_init(&sms[m]);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  BenchConfig cfg = {
+      .depth = 4,
+      .fanout = 3,
+      .transitions = 3,
+      .guard_pct = 30,
+      .history_pct = 20,
+      .num_events = 16,
+      .machines = 1,
+      .steps = 1000000,
+      .dist = DIST_UNIFORM,
+      .seed = 1,
+  };
+  if (!parse_args(argc, argv, &cfg)) {
+    usage();
+    return 1;
+  }
+  rng_state = cfg.seed * UINT64_C(0x9E3779B97F4A7C15) + 1;
+
+  Generated g;
+  if (!generate(&cfg, &g)) {
+    fprintf(stderr, "chart too large\n");
+    return 1;
+  }
+
+  Chart chart;
+  size_t const chart_bytes = sc_compile(&chart, g.num_states, g.states, NULL, 0);
+  void *chart_mem = malloc(chart_bytes);
+  if (chart_bytes == SIZE_MAX || !chart_mem ||
+      sc_compile(&chart, g.num_states, g.states, chart_mem, chart_bytes) > chart_bytes) {
+    fprintf(stderr, "compile failed\n");
+    return 1;
+  }
+
+  Machine *sms = malloc(cfg.machines * sizeof(*sms));
+  StateId *slots = malloc(cfg.machines * chart.machine_slots * sizeof(*slots));
+  EventType *events = malloc(cfg.steps * sizeof(*events));
+  uint32_t *targets = malloc(cfg.steps * sizeof(*targets));
+  uint64_t *latency = malloc(cfg.steps * sizeof(*latency));
+  generate_events(&cfg, events, targets);
+
+  // Throughput
+  init_machines(&cfg, &chart, sms, slots);
+  actions_taken = 0;
+  uint64_t const begin = now_ns();
+  for (size_t i = 0; i < cfg.steps; ++i) {
+    sc_run(&sms[targets[i]], events[i]);
+  }
+  uint64_t const total_ns = now_ns() - begin;
+  uint64_t const taken = actions_taken;
+
+  // Latency, same workload again with every event timed on its own
+  uint64_t timer_ns = UINT64_MAX;
+  for (int i = 0; i < 1000; ++i) {
+    uint64_t const t0 = now_ns();
+    uint64_t const t1 = now_ns();
+    timer_ns = t1 - t0 < timer_ns ? t1 - t0 : timer_ns;
+  }
+  init_machines(&cfg, &chart, sms, slots);
+  for (size_t i = 0; i < cfg.steps; ++i) {
+    uint64_t const t0 = now_ns();
+    sc_run(&sms[targets[i]], events[i]);
+    uint64_t const t1 = now_ns();
+    latency[i] = t1 - t0 > timer_ns ? t1 - t0 - timer_ns : 0;
+  }
+  qsort(latency, cfg.steps, sizeof(*latency), compare_u64);
+
+#define PERCENTILE(p) latency[(size_t)((double)(cfg.steps - 1) * (p))]
+  printf("{\"depth\":%u,\"fanout\":%u,\"transitions_per_state\":%u,\"guard_pct\":%u,"
+         "\"history_pct\":%u,\"events\":%u,\"dist\":\"%s\",\"machines\":%u,\"steps\":%zu,"
+         "\"seed\":%u,\"states\":%zu,\"transitions\":%zu,\"chart_bytes\":%zu,"
+         "\"bytes_per_instance\":%zu,\"transitions_taken\":%llu,\"events_per_sec\":%.0f,"
+         "\"ns_per_event\":{\"mean\":%.2f,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,"
+         "\"max\":%llu},\"timer_ns\":%llu}\n",
+         cfg.depth, cfg.fanout, cfg.transitions, cfg.guard_pct, cfg.history_pct, cfg.num_events,
+         dist_names[cfg.dist], cfg.machines, cfg.steps, cfg.seed, g.num_states, g.num_transitions,
+         chart_bytes, sizeof(Machine) + chart.machine_slots * sizeof(StateId),
+         (unsigned long long)taken, (double)cfg.steps * 1e9 / (double)total_ns,
+         (double)total_ns / (double)cfg.steps, (unsigned long long)PERCENTILE(0.5),
+         (unsigned long long)PERCENTILE(0.9), (unsigned long long)PERCENTILE(0.99),
+         (unsigned long long)PERCENTILE(0.999), (unsigned long long)latency[cfg.steps - 1],
+         (unsigned long long)timer_ns);
+#undef PERCENTILE
+
+  for (size_t i = 0; i < g.num_states; ++i) {
+    free(g.tables[i]);
+  }
+  free(g.tables);
+  free(g.configs);
+  free(g.states);
+  free(chart_mem);
+  free(sms);
+  free(slots);
+  free(events);
+  free(targets);
+  free(latency);
+  return 0;
+}
@@ -6,50 +6,50 @@
 enum my_states { ROOT, A, A_H, A_HD, BRANCH, B, C, D, D_H, E, F, G, G_HD, GA, GB, _NUM_STATES };
 static State my_states[];
 
-static void state_a_entry(State const *sm) { printf("%s\n", __func__); }
-static void state_a_exit(State const *sm) { printf("%s\n", __func__); }
-static State *state_branch_run(State const *sm, EventType e) {
+static void state_a_entry(Machine *sm, State const *s) { printf("%s\n", __func__); }
+static void state_a_exit(Machine *sm, State const *s) { printf("%s\n", __func__); }
+static State const *state_branch_run(Machine *sm, State const *s, Event const *e) {
   printf("%s\n", __func__);
   return &my_states[D];
 };
-static void state_b_entry(State const *sm) { printf("%s\n", __func__); }
-static void state_b_exit(State const *sm) { printf("%s\n", __func__); }
-static void state_c_entry(State const *sm) { printf("%s\n", __func__); }
-static void state_c_exit(State const *sm) { printf("%s\n", __func__); }
-static State *state_b_run(State const *sm, EventType e) {
+static void state_b_entry(Machine *sm, State const *s) { printf("%s\n", __func__); }
+static void state_b_exit(Machine *sm, State const *s) { printf("%s\n", __func__); }
+static void state_c_entry(Machine *sm, State const *s) { printf("%s\n", __func__); }
+static void state_c_exit(Machine *sm, State const *s) { printf("%s\n", __func__); }
+static State const *state_b_run(Machine *sm, State const *s, Event const *e) {
   printf("%s\n", __func__);
   //   return &my_states[C];
   return NULL;
 };
-static void state_d_entry(State const *sm) { printf("%s\n", __func__); }
-static void state_d_exit(State const *sm) { printf("%s\n", __func__); }
-static void state_e_entry(State const *sm) { printf("%s\n", __func__); }
-static void state_e_exit(State const *sm) { printf("%s\n", __func__); }
-static void state_f_entry(State const *sm) { printf("%s\n", __func__); }
-static void state_f_exit(State const *sm) { printf("%s\n", __func__); }
-static State *state_f_run(State const *sm, EventType e) {
+static void state_d_entry(Machine *sm, State const *s) { printf("%s\n", __func__); }
+static void state_d_exit(Machine *sm, State const *s) { printf("%s\n", __func__); }
+static void state_e_entry(Machine *sm, State const *s) { printf("%s\n", __func__); }
+static void state_e_exit(Machine *sm, State const *s) { printf("%s\n", __func__); }
+static void state_f_entry(Machine *sm, State const *s) { printf("%s\n", __func__); }
+static void state_f_exit(Machine *sm, State const *s) { printf("%s\n", __func__); }
+static State const *state_f_run(Machine *sm, State const *s, Event const *e) {
   printf("%s\n", __func__);
   //   return &my_states[B];
   return NULL;
 };
-static void state_g_entry(State const *sm) { printf("%s\n", __func__); }
-static void state_g_exit(State const *sm) { printf("%s\n", __func__); }
-static void state_ga_entry(State const *sm) { printf("%s\n", __func__); }
-static void state_ga_exit(State const *sm) { printf("%s\n", __func__); }
-static void state_gb_entry(State const *sm) { printf("%s\n", __func__); }
-static void state_gb_exit(State const *sm) { printf("%s\n", __func__); }
+static void state_g_entry(Machine *sm, State const *s) { printf("%s\n", __func__); }
+static void state_g_exit(Machine *sm, State const *s) { printf("%s\n", __func__); }
+static void state_ga_entry(Machine *sm, State const *s) { printf("%s\n", __func__); }
+static void state_ga_exit(Machine *sm, State const *s) { printf("%s\n", __func__); }
+static void state_gb_entry(Machine *sm, State const *s) { printf("%s\n", __func__); }
+static void state_gb_exit(Machine *sm, State const *s) { printf("%s\n", __func__); }
 
-static void tran_1(State const *sm) { printf("%s\n", __func__); }
-static void tran_2(State const *sm) { printf("%s\n", __func__); }
-static bool guard_1(State const *sm) {
+static void tran_1(Machine *sm, Event const *e) { printf("%s\n", __func__); }
+static void tran_2(Machine *sm, Event const *e) { printf("%s\n", __func__); }
+static bool guard_1(Machine const *sm, Event const *e) {
   printf("%s\n", __func__);
   return true;
 }
-static bool guard_2(State const *sm) {
+static bool guard_2(Machine const *sm, Event const *e) {
   printf("%s\n", __func__);
   return true;
 }
-static bool condition_1(State const *sm) {
+static bool condition_1(Machine const *sm, Event const *e) {
   static int counter = 0;
   printf("%s\n", __func__);
   return counter++ >= 1 ? true : false;
@@ -179,11 +179,19 @@ static StateConfig const my_statecfgs[_NUM_STATES] = {
 
 int main(void) {
   printf("hsm4c demo\n");
-  printf("sizeof(State): %lu, sizeof(Transition): %lu\n\n", sizeof(State), sizeof(Transition));
+  printf("sizeof(State): %lu, sizeof(Transition): %lu, sizeof(Machine): %lu\n\n", sizeof(State),
+         sizeof(Transition), sizeof(Machine));
 
+  static uint64_t chart_mem[128];
+  static StateId my_slots[_NUM_STATES];
+  Chart my_chart;
+  Machine machine;
   State const *current = NULL;
-  State *my_sm = &my_states[ROOT];
+  Machine *my_sm = &machine;
   sc_map_stateconfig_to_states(_NUM_STATES, my_states, my_statecfgs);
+  size_t chart_size = sc_compile(&my_chart, _NUM_STATES, my_states, chart_mem, sizeof(chart_mem));
+  printf("compiled chart: %zu bytes, machine slots: %zu\n\n", chart_size, my_chart.machine_slots);
+  sc_machine_init(my_sm, &my_chart, my_slots, NULL);
   current = sc_init(my_sm);
   current = sc_run(my_sm, 1);           // B
   current = sc_run(my_sm, SC_NO_EVENT); // No change
@@ -0,0 +1,1232 @@
+/**
+ * \brief Generates static chart tables from a PlantUML state diagram
+ * \file
+ *
+ * Parses the PlantUML subset the statechart tests are drawn in and writes a header and a source
+ * file with `const` transition tables, state configs, states and the compiled Chart including its
+ * dispatch index. The generated chart is fully initialized at compile time: No
+ * `sc_map_stateconfig_to_states()` nor `sc_compile()` is needed and everything can live in ROM.
+ *
+ * Supported PlantUML:
+ *
+ * - `state NAME`, `state NAME { ... }` nested states. Exactly one top level state, the root.
+ * - `state NAME <<history>>`, `<<history*>>` (deep) and `<<choice>>` pseudo states.
+ * - `[*] -> NAME` initial state of the enclosing state.
+ * - `FROM -> TO : EVENT [guard] / action()` transitions, all parts of the label optional. Any
+ *   arrow like `-->` or `-up->`. `<<internal>>` at the end makes a local transition.
+ * - `(n)` instead of an event orders the branches of a choice.
+ * - `HISTORY -> NAME` sets the state entered if the history is empty. The label is ignored.
+ * - `NAME : entry / fn()`, `exit / fn()`, `run / fn()` (or `do / fn()`) state functions.
+ * - Comments (`'`), `@startuml`, `@enduml`, `hide`, `skinparam` and `title` lines are skipped.
+ *
+ * Usage: hsm4c_gen [--prefix=name] [--switch] chart.puml out/name, writes out/name.h and
+ * out/name.c. All generated identifiers start with the prefix, the basename of the output by
+ * default. State and event functions are referenced by their name and declared in the header.
+ *
+ * With `--switch` also writes `prefix_run()` / `prefix_run_event()`: The same semantics as
+ * `sc_run()` compiled into nested `switch (leaf) / switch (event)` statements, with exits,
+ * actions and entries of static transitions inlined as direct calls. Use it instead of `sc_run()`
+ * on machines of the generated chart. It does not record traces or statistics.
+ *
+ * (C) 2023 David Bongartz
+ * MIT License
+ */
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/hsm4c.h"
+
+/* -------- Model -------- */
+
+#define MAX_NAME 64
+#define MAX_LINE 512
+#define MAX_NESTING 64
+
+typedef char Name[MAX_NAME];
+
+typedef struct GenState {
+  Name name;
+  int parent;
+  Name initial;
+  StateType type;
+  Name entry;
+  Name exit;
+  Name run;
+  int line;
+} GenState;
+
+typedef struct GenTransition {
+  Name from;
+  Name to;
+  Name event;
+  Name guard;
+  Name action;
+  bool local;
+  int order;
+  int line;
+} GenTransition;
+
+typedef struct Model {
+  GenState *states;
+  size_t num_states;
+  GenTransition *transitions;
+  size_t num_transitions;
+  Name *events;
+  size_t num_events;
+} Model;
+
+static char const *input_name;
+
+static void fail(int line, char const *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  fprintf(stderr, "%s:%d: error: ", input_name, line);
+  vfprintf(stderr, fmt, args);
+  fputc('\n', stderr);
+  va_end(args);
+  exit(EXIT_FAILURE);
+}
+
+static int find_state(Model const *m, char const *name) {
+  for (size_t i = 0; i < m->num_states; ++i) {
+    if (strcmp(m->states[i].name, name) == 0) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+static int find_event(Model const *m, char const *name) {
+  for (size_t i = 0; i < m->num_events; ++i) {
+    if (strcmp(m->events[i], name) == 0) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+/* -------- Parser -------- */
+
+static char const *skip_space(char const *p) {
+  while (isspace((unsigned char)*p)) {
+    ++p;
+  }
+  return p;
+}
+
+/** \brief Reads a C identifier. Returns position after it, NULL if there is none. */
+static char const *read_ident(char const *p, Name out, int line) {
+  size_t n = 0;
+  if (!isalpha((unsigned char)*p) && *p != '_') {
+    return NULL;
+  }
+  while (isalnum((unsigned char)*p) || *p == '_') {
+    if (n + 1 == MAX_NAME) {
+      fail(line, "name too long");
+    }
+    out[n++] = *p++;
+  }
+  out[n] = '\0';
+  return p;
+}
+
+static bool starts_with(char const *s, char const *prefix) {
+  return strncmp(s, prefix, strlen(prefix)) == 0;
+}
+
+/** \brief Reads a function name, optionally followed by `()`. */
+static char const *read_function(char const *p, Name out, int line) {
+  p = read_ident(skip_space(p), out, line);
+  if (!p) {
+    fail(line, "function name expected");
+  }
+  p = skip_space(p);
+  return starts_with(p, "()") ? p + 2 : p;
+}
+
+/** \brief `state NAME [<<stereotype>>] [{]` */
+static bool parse_state(Model *m, char const *p, int parent, int line) {
+  GenState s = {.parent = parent, .type = SC_TYPE_NORMAL, .line = line};
+  p = read_ident(skip_space(p), s.name, line);
+  if (!p) {
+    fail(line, "state name expected");
+  }
+  if (find_state(m, s.name) >= 0) {
+    fail(line, "state %s declared twice", s.name);
+  }
+  p = skip_space(p);
+  if (starts_with(p, "<<")) {
+    char const *end = strstr(p, ">>");
+    if (!end) {
+      fail(line, "unterminated stereotype");
+    }
+    size_t const len = (size_t)(end - p - 2);
+    if (len == 7 && starts_with(p + 2, "history")) {
+      s.type = SC_TYPE_HISTORY;
+    } else if (len == 8 && starts_with(p + 2, "history*")) {
+      s.type = SC_TYPE_HISTORY_DEEP;
+    } else if (len == 6 && starts_with(p + 2, "choice")) {
+      s.type = SC_TYPE_CHOICE;
+    } else {
+      fail(line, "unsupported stereotype %.*s", (int)len + 4, p);
+    }
+    p = skip_space(end + 2);
+  }
+  bool const nested = *p == '{';
+  if (nested) {
+    p = skip_space(p + 1);
+  }
+  if (*p) {
+    fail(line, "unexpected '%s'", p);
+  }
+
+  m->states = realloc(m->states, (m->num_states + 1) * sizeof(*m->states));
+  m->states[m->num_states++] = s;
+  return nested;
+}
+
+/** \brief `[(n)] [EVENT] [[guard]] [/ action()] [<<internal>>]` */
+static void parse_label(Model *m, char const *p, GenTransition *t, int line) {
+  p = skip_space(p);
+  if (*p == '(') {
+    t->order = (int)strtol(p + 1, (char **)&p, 10);
+    if (*p != ')') {
+      fail(line, "')' expected");
+    }
+    p = skip_space(p + 1);
+  }
+  char const *end = read_ident(p, t->event, line);
+  if (end) {
+    p = skip_space(end);
+    if (find_event(m, t->event) < 0) {
+      m->events = realloc(m->events, (m->num_events + 1) * sizeof(*m->events));
+      strcpy(m->events[m->num_events++], t->event);
+    }
+  }
+  if (*p == '[') {
+    p = read_ident(skip_space(p + 1), t->guard, line);
+    if (!p || *(p = skip_space(p)) != ']') {
+      fail(line, "guard name and ']' expected");
+    }
+    p = skip_space(p + 1);
+  }
+  if (*p == '/') {
+    p = skip_space(read_function(p + 1, t->action, line));
+  }
+  if (starts_with(p, "<<internal>>")) {
+    t->local = true;
+    p = skip_space(p + 12);
+  }
+  if (*p) {
+    fail(line, "unexpected '%s' in transition label", p);
+  }
+}
+
+/** \brief `FROM -> TO [: label]`, `[*] -> TO` */
+static void parse_transition(Model *m, char const *p, int scope, int line) {
+  GenTransition t = {.line = line};
+  p = skip_space(p);
+  bool const initial = starts_with(p, "[*]");
+  if (initial) {
+    p += 3;
+  } else if (!(p = read_ident(p, t.from, line))) {
+    fail(line, "source state expected");
+  }
+  p = skip_space(p);
+  if (*p != '-' || !(p = strchr(p, '>'))) {
+    fail(line, "arrow expected");
+  }
+  p = read_ident(skip_space(p + 1), t.to, line);
+  if (!p) {
+    fail(line, "target state expected");
+  }
+  p = skip_space(p);
+
+  if (initial) {
+    if (scope < 0 || *p) {
+      fail(line, "initial transition must be inside a state and have no label");
+    }
+    strcpy(m->states[scope].initial, t.to);
+    return;
+  }
+  if (*p == ':') {
+    parse_label(m, p + 1, &t, line);
+  } else if (*p) {
+    fail(line, "':' expected");
+  }
+  m->transitions = realloc(m->transitions, (m->num_transitions + 1) * sizeof(*m->transitions));
+  m->transitions[m->num_transitions++] = t;
+}
+
+/** \brief `NAME : entry|exit|run|do / fn()` */
+static void parse_description(Model *m, char const *p, int line) {
+  Name name;
+  Name kind;
+  p = read_ident(skip_space(p), name, line);
+  int const id = p ? find_state(m, name) : -1;
+  if (id < 0) {
+    fail(line, "declared state expected");
+  }
+  p = read_ident(skip_space(strchr(p, ':') + 1), kind, line);
+  if (!p || *(p = skip_space(p)) != '/') {
+    fail(line, "'entry /', 'exit /' or 'run /' expected");
+  }
+  GenState *s = &m->states[id];
+  char *fn = strcmp(kind, "entry") == 0                             ? s->entry
+             : strcmp(kind, "exit") == 0                            ? s->exit
+             : strcmp(kind, "run") == 0 || strcmp(kind, "do") == 0 ? s->run
+                                                                    : NULL;
+  if (!fn) {
+    fail(line, "unsupported state function '%s'", kind);
+  }
+  if (*skip_space(read_function(p + 1, fn, line))) {
+    fail(line, "unexpected text after function");
+  }
+}
+
+static void parse(FILE *in, Model *m) {
+  char buf[MAX_LINE];
+  int scopes[MAX_NESTING];
+  int depth = 0;
+  int line = 0;
+
+  while (fgets(buf, sizeof(buf), in)) {
+    ++line;
+    char *p = (char *)skip_space(buf);
+    for (char *end = p + strlen(p); end > p && isspace((unsigned char)end[-1]); *--end = '\0') {
+    }
+    int const scope = depth ? scopes[depth - 1] : -1;
+
+    if (!*p || *p == '\'' || *p == '@' || starts_with(p, "hide ") ||
+        starts_with(p, "skinparam ") || starts_with(p, "title ")) {
+      continue;
+    } else if (starts_with(p, "state ")) {
+      if (parse_state(m, p + 6, scope, line)) {
+        if (depth == MAX_NESTING) {
+          fail(line, "nested too deep");
+        }
+        scopes[depth++] = (int)m->num_states - 1;
+      }
+    } else if (strcmp(p, "}") == 0) {
+      if (!depth--) {
+        fail(line, "unbalanced '}'");
+      }
+    } else if (strstr(p, "->")) {
+      parse_transition(m, p, scope, line);
+    } else if (strchr(p, ':')) {
+      parse_description(m, p, line);
+    } else {
+      fail(line, "unsupported statement '%s'", p);
+    }
+  }
+  if (depth) {
+    fail(line, "missing '}'");
+  }
+}
+
+/* -------- Chart -------- */
+
+typedef struct Built {
+  State *states;
+  StateConfig *configs;
+  Transition **tables;
+  size_t *table_len;
+  Chart chart;
+  void *mem;
+} Built;
+
+static int compare_order(void const *a, void const *b) {
+  return ((GenTransition const *)a)->order - ((GenTransition const *)b)->order;
+}
+
+static int resolve(Model const *m, char const *name, int line) {
+  int const id = find_state(m, name);
+  if (id < 0) {
+    fail(line, "undeclared state %s", name);
+  }
+  return id;
+}
+
+/** \brief Builds the chart in memory and compiles it, like a hand written chart would be. */
+static void build(Model *m, Built *b) {
+  size_t const n = m->num_states;
+  int root = -1;
+  for (size_t i = 0; i < n; ++i) {
+    if (m->states[i].parent < 0) {
+      if (root >= 0) {
+        fail(m->states[i].line, "second top level state %s, only the root may be top level",
+             m->states[i].name);
+      }
+      root = (int)i;
+      m->states[i].type = SC_TYPE_ROOT;
+    }
+  }
+  if (root < 0) {
+    fail(0, "no states");
+  }
+
+  // Transitions leaving a history state set its initial state
+  size_t kept = 0;
+  for (size_t i = 0; i < m->num_transitions; ++i) {
+    GenTransition const *t = &m->transitions[i];
+    GenState *from = &m->states[resolve(m, t->from, t->line)];
+    resolve(m, t->to, t->line);
+    if (from->type == SC_TYPE_HISTORY || from->type == SC_TYPE_HISTORY_DEEP) {
+      strcpy(from->initial, t->to);
+    } else {
+      m->transitions[kept++] = *t;
+    }
+  }
+  m->num_transitions = kept;
+
+  b->states = calloc(n, sizeof(*b->states));
+  b->configs = calloc(n, sizeof(*b->configs));
+  b->tables = calloc(n, sizeof(*b->tables));
+  b->table_len = calloc(n, sizeof(*b->table_len));
+
+  for (size_t i = 0; i < n; ++i) {
+    GenState const *s = &m->states[i];
+    size_t len = 0;
+    Transition *table = malloc((m->num_transitions + 1) * sizeof(*table));
+    GenTransition *own = malloc((m->num_transitions + 1) * sizeof(*own));
+    for (size_t k = 0; k < m->num_transitions; ++k) {
+      if (strcmp(m->transitions[k].from, s->name) == 0) {
+        own[len++] = m->transitions[k];
+      }
+    }
+    if (s->type == SC_TYPE_CHOICE) {
+      qsort(own, len, sizeof(*own), compare_order);
+    }
+    for (size_t k = 0; k < len; ++k) {
+      memcpy(&table[k],
+             &(Transition const){
+                 .from = &b->states[i],
+                 .to = &b->states[resolve(m, own[k].to, own[k].line)],
+                 .event = own[k].event[0] ? find_event(m, own[k].event) + 1 : SC_NO_EVENT,
+                 .type = own[k].local ? SC_TTYPE_LOCAL : SC_TTYPE_EXTERNAL,
+             },
+             sizeof(*table));
+    }
+    memcpy(&table[len], &SC_TRANSITIONS_END, sizeof(*table));
+    // Keep the sorted order for emitting
+    for (size_t k = 0, j = 0; k < m->num_transitions; ++k) {
+      if (strcmp(m->transitions[k].from, s->name) == 0) {
+        m->transitions[k] = own[j++];
+      }
+    }
+    free(own);
+
+    b->tables[i] = table;
+    b->table_len[i] = len;
+    memcpy(&b->configs[i],
+           &(StateConfig const){
+               .name = s->name,
+               .parent = s->parent < 0 ? NULL : &b->states[s->parent],
+               .initial = s->initial[0] ? &b->states[resolve(m, s->initial, s->line)] : NULL,
+               .type = s->type,
+               .transitions = len ? table : NULL,
+           },
+           sizeof(b->configs[i]));
+  }
+  sc_map_stateconfig_to_states(n, b->states, b->configs);
+
+  size_t const size = sc_compile(&b->chart, n, b->states, NULL, 0);
+  if (size == SIZE_MAX) {
+    fail(0, "chart can not be compiled");
+  }
+  b->mem = malloc(size);
+  sc_compile(&b->chart, n, b->states, b->mem, size);
+}
+
+/* -------- Output -------- */
+
+static char const *const type_names[] = {
+    [SC_TYPE_NORMAL] = "SC_TYPE_NORMAL",
+    [SC_TYPE_HISTORY] = "SC_TYPE_HISTORY",
+    [SC_TYPE_HISTORY_DEEP] = "SC_TYPE_HISTORY_DEEP",
+    [SC_TYPE_CHOICE] = "SC_TYPE_CHOICE",
+    [SC_TYPE_ROOT] = "SC_TYPE_ROOT",
+    [SC_TYPE_PARALLEL] = "SC_TYPE_PARALLEL",
+};
+
+typedef struct Output {
+  FILE *out;
+  char const *prefix;
+  char upper[MAX_NAME];
+  bool engine;
+} Output;
+
+static void lower(char *out, char const *in) {
+  while ((*out++ = (char)tolower((unsigned char)*in++))) {
+  }
+}
+
+/** \brief Writes an array of numbers, SC_NO_STATE by name if `states`. */
+static void emit_numbers(Output const *o, char const *type, char const *name, uint64_t const *v,
+                         size_t n, bool states) {
+  if (!n) {
+    return;
+  }
+  fprintf(o->out, "static %s const %s[%zu] = {", type, name, n);
+  int col = 100;
+  for (size_t i = 0; i < n; ++i) {
+    char num[24];
+    int const len = states && v[i] == SC_NO_STATE
+                        ? snprintf(num, sizeof(num), "SC_NO_STATE")
+                        : snprintf(num, sizeof(num), "%llu", (unsigned long long)v[i]);
+    if (col + len + 2 > 100) {
+      fprintf(o->out, "\n   ");
+      col = 3;
+    }
+    col += fprintf(o->out, " %s,", num);
+  }
+  fprintf(o->out, "\n};\n\n");
+}
+
+/** \brief Widens an index array of the compiled chart for emit_numbers(). */
+#define WIDEN(dst, src, n)                                                                         \
+  for (size_t i_ = 0; i_ < (n); ++i_) {                                                            \
+    (dst)[i_] = (src)[i_];                                                                         \
+  }
+
+static void emit_functions(Output const *o, Model const *m, size_t offset, char const *decl) {
+  // Every distinct name once
+  for (size_t i = 0; i < m->num_states; ++i) {
+    char const *fn = (char const *)&m->states[i] + offset;
+    bool seen = !fn[0];
+    for (size_t k = 0; k < i && !seen; ++k) {
+      seen = strcmp(fn, (char const *)&m->states[k] + offset) == 0;
+    }
+    if (!seen) {
+      fprintf(o->out, decl, fn);
+    }
+  }
+}
+
+static void emit_transition_functions(Output const *o, Model const *m, size_t offset,
+                                      char const *decl) {
+  for (size_t i = 0; i < m->num_transitions; ++i) {
+    char const *fn = (char const *)&m->transitions[i] + offset;
+    bool seen = !fn[0];
+    for (size_t k = 0; k < i && !seen; ++k) {
+      seen = strcmp(fn, (char const *)&m->transitions[k] + offset) == 0;
+    }
+    if (!seen) {
+      fprintf(o->out, decl, fn);
+    }
+  }
+}
+
+static void emit_header(Output const *o, Model const *m, Built const *b, char const *source) {
+  FILE *const out = o->out;
+  fprintf(out,
+          "/**\n"
+          " * \\brief Statechart generated by hsm4c_gen from %s. Do not edit.\n"
+          " * \\file\n"
+          " */\n\n"
+          "#pragma once\n\n"
+          "#include \"hsm4c.h\"\n\n",
+          source);
+
+  fprintf(out, "/** \\brief States, index into %s_states */\nenum %s_state {\n", o->prefix,
+          o->prefix);
+  for (size_t i = 0; i < m->num_states; ++i) {
+    fprintf(out, "  %s_%s,\n", o->upper, m->states[i].name);
+  }
+  fprintf(out, "  %s_NUM_STATES\n};\n\n", o->upper);
+
+  fprintf(out, "/** \\brief Events */\nenum %s_event {\n", o->prefix);
+  for (size_t i = 0; i < m->num_events; ++i) {
+    fprintf(out, "  %s_%s%s,\n", o->upper, m->events[i], i ? "" : " = 1");
+  }
+  fprintf(out, "  %s_NUM_EVENTS%s\n};\n\n", o->upper, m->num_events ? "" : " = 1");
+
+  fprintf(out,
+          "/** \\brief StateId slots each machine needs, see sc_machine_init() */\n"
+          "#define %s_MACHINE_SLOTS %zu\n\n"
+          "/** \\brief All states of the chart */\n"
+          "extern State const %s_states[%s_NUM_STATES];\n\n"
+          "/** \\brief Compiled chart, ready for sc_machine_init() */\n"
+          "extern Chart const %s_chart;\n\n",
+          o->upper, b->chart.machine_slots, o->prefix, o->upper, o->prefix);
+  if (o->engine) {
+    fprintf(out,
+            "/** \\brief sc_run_event() as switch statements, for machines of %s_chart */\n"
+            "State const *%s_run_event(Machine *sm, Event const *event);\n\n"
+            "/** \\brief sc_run() as switch statements, for machines of %s_chart */\n"
+            "State const *%s_run(Machine *sm, EventType event);\n\n",
+            o->prefix, o->prefix, o->prefix, o->prefix);
+  }
+  fprintf(out, "/* -------- Functions implemented by the user -------- */\n\n");
+  emit_functions(o, m, offsetof(GenState, entry), "void %s(Machine *sm, State const *s);\n");
+  emit_functions(o, m, offsetof(GenState, exit), "void %s(Machine *sm, State const *s);\n");
+  emit_functions(o, m, offsetof(GenState, run),
+                 "State const *%s(Machine *sm, State const *s, Event const *e);\n");
+  emit_transition_functions(o, m, offsetof(GenTransition, action),
+                            "void %s(Machine *sm, Event const *e);\n");
+  emit_transition_functions(o, m, offsetof(GenTransition, guard),
+                            "bool %s(Machine const *sm, Event const *e);\n");
+}
+
+/** \brief Transition `k` of the table of state `i`, build() left them in table order. */
+static GenTransition const *table_entry(Model const *m, size_t i, size_t k) {
+  for (size_t j = 0; j < m->num_transitions; ++j) {
+    if (strcmp(m->transitions[j].from, m->states[i].name) == 0 && k-- == 0) {
+      return &m->transitions[j];
+    }
+  }
+  return NULL;
+}
+
+/** \brief Index of a function in Chart._functions, added at its first use. 0 for none. */
+static uint16_t function_number(Name functions[], size_t *num_functions, char const *name) {
+  if (!name[0]) {
+    return 0;
+  }
+  size_t i = 1;
+  while (i < *num_functions && strcmp(functions[i], name) != 0) {
+    ++i;
+  }
+  if (i == *num_functions) {
+    strcpy(functions[(*num_functions)++], name);
+  }
+  return (uint16_t)i;
+}
+
+/** \brief Dense transitions, state functions and function table, as sc_compile() builds them. */
+static size_t emit_compact(Output const *o, Model const *m, Built const *b) {
+  FILE *const out = o->out;
+  Chart const *const chart = &b->chart;
+  size_t const n = m->num_states;
+  size_t const nt = chart->num_transitions;
+  Name *functions = malloc((1 + 3 * n + 2 * nt) * sizeof(*functions));
+  struct CompactState *states = malloc(n * sizeof(*states));
+  struct CompactTransition *transitions = malloc((nt ? nt : 1) * sizeof(*transitions));
+  size_t num_functions = 1;
+
+  for (size_t i = 0; i < n; ++i) {
+    GenState const *s = &m->states[i];
+    states[i].entry = function_number(functions, &num_functions, s->entry);
+    states[i].exit = function_number(functions, &num_functions, s->exit);
+    states[i].run = function_number(functions, &num_functions, s->run);
+  }
+  for (size_t id = 0; id < nt; ++id) {
+    Transition const *t = chart->_transitions[id];
+    size_t const i = (size_t)(t->from - b->states);
+    GenTransition const *g = table_entry(m, i, (size_t)(t - b->tables[i]));
+    transitions[id] = (struct CompactTransition){
+        .from = (StateId)i,
+        .to = (StateId)(t->to - b->states),
+        .guard = function_number(functions, &num_functions, g->guard),
+        .action = function_number(functions, &num_functions, g->action),
+    };
+  }
+
+  fprintf(out, "static void (*const functions[%zu])(void) = {\n    NULL,\n", num_functions);
+  for (size_t f = 1; f < num_functions; ++f) {
+    fprintf(out, "    (void (*)(void))%s,\n", functions[f]);
+  }
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "static struct CompactState const compact_states[%zu] = {\n", n);
+  for (size_t i = 0; i < n; ++i) {
+    fprintf(out, "    [%s_%s] = {%u, %u, %u},\n", o->upper, m->states[i].name,
+            (unsigned)states[i].entry, (unsigned)states[i].exit, (unsigned)states[i].run);
+  }
+  fprintf(out, "};\n\n");
+
+  if (nt) {
+    fprintf(out, "static struct CompactTransition const compact_transitions[%zu] = {\n", nt);
+    for (size_t id = 0; id < nt; ++id) {
+      struct CompactTransition const *t = &transitions[id];
+      fprintf(out, "    {%s_%s, %s_%s, %u, %u},\n", o->upper, m->states[t->from].name, o->upper,
+              m->states[t->to].name, (unsigned)t->guard, (unsigned)t->action);
+    }
+    fprintf(out, "};\n\n");
+  }
+
+  free(functions);
+  free(states);
+  free(transitions);
+  return num_functions;
+}
+
+static void emit_state_ref(Output const *o, Model const *m, State const *s, Built const *b) {
+  fprintf(o->out, "&%s_states[%s_%s]", o->prefix, o->upper, m->states[s - b->states].name);
+}
+
+static void emit_source(Output const *o, Model const *m, Built const *b, char const *header) {
+  FILE *const out = o->out;
+  Chart const *const chart = &b->chart;
+  size_t const n = m->num_states;
+  char lname[MAX_NAME];
+
+  fprintf(out,
+          "/**\n"
+          " * \\brief Statechart generated by hsm4c_gen. Do not edit.\n"
+          " * \\file\n"
+          " */\n\n"
+          "#include \"%s\"\n\n"
+          "/* -------- Transitions -------- */\n\n",
+          header);
+
+  for (size_t i = 0; i < n; ++i) {
+    if (!b->table_len[i]) {
+      continue;
+    }
+    lower(lname, m->states[i].name);
+    fprintf(out, "static Transition const transitions_%s[] = {\n", lname);
+    // build() left the transitions of every source in table order
+    for (size_t k = 0; k < m->num_transitions; ++k) {
+      GenTransition const *t = &m->transitions[k];
+      if (strcmp(t->from, m->states[i].name) != 0) {
+        continue;
+      }
+      fprintf(out, "    {\n        .from = &%s_states[%s_%s],\n", o->prefix, o->upper, t->from);
+      fprintf(out, "        .to = &%s_states[%s_%s],\n", o->prefix, o->upper, t->to);
+      if (t->event[0]) {
+        fprintf(out, "        .event = %s_%s,\n", o->upper, t->event);
+      } else {
+        fprintf(out, "        .event = SC_NO_EVENT,\n");
+      }
+      if (t->action[0]) {
+        fprintf(out, "        .transition_fn = %s,\n", t->action);
+      }
+      if (t->guard[0]) {
+        fprintf(out, "        .guard_fn = %s,\n", t->guard);
+      }
+      if (t->local) {
+        fprintf(out, "        .type = SC_TTYPE_LOCAL,\n");
+      }
+      fprintf(out, "    },\n");
+    }
+    fprintf(out, "    {.type = SC_TTYPE_TABLE_END},\n};\n\n");
+  }
+
+  fprintf(out, "/* -------- States -------- */\n\n");
+  fprintf(out, "static StateConfig const statecfgs[%s_NUM_STATES] = {\n", o->upper);
+  for (size_t i = 0; i < n; ++i) {
+    GenState const *s = &m->states[i];
+    StateConfig const *c = &b->configs[i];
+    fprintf(out, "    [%s_%s] =\n        {\n            .name = \"%s\",\n", o->upper, s->name,
+            s->name);
+    if (s->entry[0]) {
+      fprintf(out, "            .entry_fn = %s,\n", s->entry);
+    }
+    if (s->exit[0]) {
+      fprintf(out, "            .exit_fn = %s,\n", s->exit);
+    }
+    if (s->run[0]) {
+      fprintf(out, "            .run_fn = %s,\n", s->run);
+    }
+    if (c->parent) {
+      fprintf(out, "            .parent = ");
+      emit_state_ref(o, m, c->parent, b);
+      fprintf(out, ",\n");
+    }
+    if (c->initial) {
+      fprintf(out, "            .initial = ");
+      emit_state_ref(o, m, c->initial, b);
+      fprintf(out, ",\n");
+    }
+    if (c->type != SC_TYPE_NORMAL) {
+      fprintf(out, "            .type = %s,\n", type_names[c->type]);
+    }
+    if (c->transitions) {
+      lower(lname, s->name);
+      fprintf(out, "            .transitions = transitions_%s,\n", lname);
+    }
+    fprintf(out, "        },\n");
+  }
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "State const %s_states[%s_NUM_STATES] = {\n", o->prefix, o->upper);
+  for (size_t i = 0; i < n; ++i) {
+    fprintf(out, "    [%s_%s] = {&statecfgs[%s_%s]},\n", o->upper, m->states[i].name, o->upper,
+            m->states[i].name);
+  }
+  fprintf(out, "};\n\n");
+
+  // Dispatch index, as sc_compile() builds it
+  fprintf(out, "/* -------- Dispatch index, see sc_compile() -------- */\n\n");
+  size_t const nt = chart->num_transitions;
+  if (nt) {
+    fprintf(out, "static Transition const *const transition_ids[%zu] = {\n", nt);
+    for (size_t id = 0; id < nt; ++id) {
+      for (size_t i = 0; i < n; ++i) {
+        Transition const *table = b->tables[i];
+        if (chart->_transitions[id] >= table && chart->_transitions[id] < &table[b->table_len[i]]) {
+          lower(lname, m->states[i].name);
+          fprintf(out, "    &transitions_%s[%td],\n", lname, chart->_transitions[id] - table);
+        }
+      }
+    }
+    fprintf(out, "};\n\n");
+  }
+
+  size_t const handle_words = n * chart->_event_words;
+  size_t num_runs = 0;
+  for (size_t w = 0; w < handle_words; ++w) {
+    for (uint32_t bits = chart->_handles[w]; bits; bits &= bits - 1) {
+      ++num_runs;
+    }
+  }
+  size_t const num_candidates = chart->_runs[num_runs];
+  size_t num_path_states = 0;
+  for (size_t id = 0; id < nt; ++id) {
+    struct TransitionPath const *p = &chart->_paths[id];
+    if (!p->dynamic && p->begin + p->len > num_path_states) {
+      num_path_states = p->begin + p->len;
+    }
+  }
+
+  size_t max = handle_words;
+  max = num_runs + 1 > max ? num_runs + 1 : max;
+  max = num_candidates > max ? num_candidates : max;
+  max = num_path_states > max ? num_path_states : max;
+  max = n > max ? n : max;
+  uint64_t *v = malloc(max * sizeof(*v));
+
+  WIDEN(v, chart->_handles, handle_words);
+  emit_numbers(o, "uint32_t", "handles", v, handle_words, false);
+  WIDEN(v, chart->_run_base, n);
+  emit_numbers(o, "uint32_t", "run_base", v, n, false);
+  WIDEN(v, chart->_runs, num_runs + 1);
+  emit_numbers(o, "uint32_t", "runs", v, num_runs + 1, false);
+  WIDEN(v, chart->_candidates, num_candidates);
+  emit_numbers(o, "uint16_t", "candidates", v, num_candidates, false);
+  WIDEN(v, chart->_parent, n);
+  emit_numbers(o, "StateId", "parent", v, n, true);
+  WIDEN(v, chart->_depth, n);
+  emit_numbers(o, "uint16_t", "depth", v, n, false);
+  // Run functions are only known by name here
+  for (size_t i = 0; i < n; ++i) {
+    v[i] = 0;
+    for (int s = (int)i; s >= 0; s = m->states[s].parent) {
+      v[i] |= m->states[s].run[0] != '\0';
+    }
+  }
+  emit_numbers(o, "bool", "branch_runs", v, n, false);
+  WIDEN(v, chart->_path_states, num_path_states);
+  emit_numbers(o, "StateId", "path_states", v, num_path_states, true);
+  WIDEN(v, chart->_history_slot, n);
+  emit_numbers(o, "StateId", "history_slot", v, n, true);
+  if (chart->_first_child) {
+    WIDEN(v, chart->_first_child, n);
+    emit_numbers(o, "StateId", "first_child", v, n, true);
+    WIDEN(v, chart->_next_sibling, n);
+    emit_numbers(o, "StateId", "next_sibling", v, n, true);
+  }
+  free(v);
+
+  if (nt) {
+    fprintf(out, "static struct TransitionPath const paths[%zu] = {\n", nt);
+    for (size_t id = 0; id < nt; ++id) {
+      struct TransitionPath const *p = &chart->_paths[id];
+      if (p->dynamic) {
+        fprintf(out, "    {.dynamic = true},\n");
+      } else {
+        fprintf(out, "    {.boundary = %u, .leaf = %u, .skip = %u, .len = %u, .begin = %lu},\n",
+                (unsigned)p->boundary, (unsigned)p->leaf, (unsigned)p->skip, (unsigned)p->len,
+                (unsigned long)p->begin);
+      }
+    }
+    fprintf(out, "};\n\n");
+  }
+
+  size_t const num_functions = emit_compact(o, m, b);
+
+#define ARRAY_OR_NULL(present, name) ((present) ? (name) : "NULL")
+  fprintf(out, "Chart const %s_chart = {\n", o->prefix);
+  fprintf(out, "    .root = ");
+  emit_state_ref(o, m, chart->root, b);
+  fprintf(out,
+          ",\n"
+          "    .states = %s_states,\n"
+          "    .num_states = %s_NUM_STATES,\n"
+          "    .num_transitions = %zu,\n"
+          "    .num_events = %d,\n"
+          "    .machine_slots = %s_MACHINE_SLOTS,\n"
+          "    ._transitions = %s,\n"
+          "    ._compact_transitions = %s,\n"
+          "    ._compact_states = compact_states,\n"
+          "    ._functions = functions,\n"
+          "    ._num_functions = %zu,\n"
+          "    ._event_words = %zu,\n"
+          "    ._handles = %s,\n"
+          "    ._run_base = run_base,\n"
+          "    ._runs = runs,\n"
+          "    ._candidates = %s,\n"
+          "    ._parent = parent,\n"
+          "    ._depth = depth,\n"
+          "    ._branch_runs = branch_runs,\n"
+          "    ._paths = %s,\n"
+          "    ._path_states = %s,\n"
+          "    ._history_slot = history_slot,\n"
+          "    ._path_slot = %zu,\n"
+          "    ._guard_slot = %zu,\n"
+          "    ._config_words = %zu,\n"
+          "    ._config_slot = %zu,\n"
+          "    ._first_child = %s,\n"
+          "    ._next_sibling = %s,\n"
+          "};\n",
+          o->prefix, o->upper, nt, chart->num_events, o->upper,
+          ARRAY_OR_NULL(nt, "transition_ids"), ARRAY_OR_NULL(nt, "compact_transitions"),
+          num_functions, chart->_event_words,
+          ARRAY_OR_NULL(handle_words, "handles"), ARRAY_OR_NULL(num_candidates, "candidates"),
+          ARRAY_OR_NULL(nt, "paths"), ARRAY_OR_NULL(num_path_states, "path_states"),
+          chart->_path_slot, chart->_guard_slot, chart->_config_words, chart->_config_slot,
+          ARRAY_OR_NULL(chart->_first_child, "first_child"),
+          ARRAY_OR_NULL(chart->_next_sibling, "next_sibling"));
+#undef ARRAY_OR_NULL
+}
+
+/* -------- Switch engine -------- */
+
+static size_t count_bits(uint32_t v) {
+  size_t n = 0;
+  for (; v; v &= v - 1) {
+    ++n;
+  }
+  return n;
+}
+
+/** \brief Candidate transition ids of a leaf and event, as find_transition() looks them up. */
+static size_t candidates_of(Chart const *chart, size_t leaf, EventType e, uint16_t const **out) {
+  uint32_t const *const bits = &chart->_handles[leaf * chart->_event_words];
+  uint32_t const bit = UINT32_C(1) << (e % 32);
+  if (!(bits[e / 32] & bit)) {
+    return 0;
+  }
+  size_t run = chart->_run_base[leaf] + count_bits(bits[e / 32] & (bit - 1));
+  for (size_t w = 0; w < (size_t)e / 32; ++w) {
+    run += count_bits(bits[w]);
+  }
+  *out = &chart->_candidates[chart->_runs[run]];
+  return chart->_runs[run + 1] - chart->_runs[run];
+}
+
+/** \brief State and table index of a transition id. */
+static GenTransition const *locate(Model const *m, Built const *b, uint16_t id, size_t *state,
+                                   size_t *index) {
+  Transition const *const t = b->chart._transitions[id];
+  for (size_t i = 0; i < m->num_states; ++i) {
+    if (t >= b->tables[i] && t < &b->tables[i][b->table_len[i]]) {
+      *state = i;
+      *index = (size_t)(t - b->tables[i]);
+      for (size_t k = 0, j = 0; k < m->num_transitions; ++k) {
+        if (strcmp(m->transitions[k].from, m->states[i].name) == 0 && j++ == *index) {
+          return &m->transitions[k];
+        }
+      }
+    }
+  }
+  return NULL;
+}
+
+/** \brief `&prefix_states[PREFIX_NAME]`. Valid until the fourth next call. */
+static char const *ref(Output const *o, Model const *m, size_t id) {
+  static char bufs[4][3 * MAX_NAME + 16];
+  static unsigned next;
+  char *const buf = bufs[next++ % 4];
+  snprintf(buf, sizeof(bufs[0]), "&%s_states[%s_%s]", o->prefix, o->upper, m->states[id].name);
+  return buf;
+}
+
+static void emit_set_history(Output const *o, Chart const *chart, StateId id, char const *value,
+                             char const *indent) {
+  if (id != SC_NO_STATE && chart->_history_slot[id] != SC_NO_STATE) {
+    fprintf(o->out, "%ssm->_slots[%u] = %s;\n", indent, (unsigned)chart->_history_slot[id], value);
+  }
+}
+
+/** \brief Takes transition `id` with `leaf` active. Mirrors execute_path(). */
+static void emit_transition(Output const *o, Model const *m, Built const *b, size_t leaf,
+                            uint16_t id, char const *indent) {
+  FILE *const out = o->out;
+  Chart const *const chart = &b->chart;
+  struct TransitionPath const *const p = &chart->_paths[id];
+  size_t state;
+  size_t index;
+  GenTransition const *t = locate(m, b, id, &state, &index);
+  char lname[MAX_NAME];
+  char value[2 * MAX_NAME];
+
+  if (p->dynamic) {
+    lower(lname, m->states[state].name);
+    fprintf(out, "%ssc_execute_dynamic_(sm, &transitions_%s[%zu], %s, e);\n", indent, lname, index,
+            ref(o, m, (size_t)find_state(m, t->to)));
+    return;
+  }
+
+  for (StateId s = (StateId)leaf; s != p->boundary; s = chart->_parent[s]) {
+    if (s == SC_NO_STATE) {
+      fail(t->line, "exit boundary is not an ancestor of %s", m->states[leaf].name);
+    }
+    if (m->states[s].exit[0]) {
+      fprintf(out, "%s%s(sm, %s);\n", indent, m->states[s].exit, ref(o, m, s));
+    }
+  }
+  if (t->action[0]) {
+    fprintf(out, "%s%s(sm, e);\n", indent, t->action);
+  }
+  for (uint16_t i = 0; i < p->len; ++i) {
+    StateId const s = chart->_path_states[p->begin + i];
+    snprintf(value, sizeof(value), "%s_%s", o->upper, m->states[s].name);
+    emit_set_history(o, chart, chart->_parent[s], value, indent);
+    if (i >= p->skip && m->states[s].entry[0]) {
+      fprintf(out, "%s%s(sm, %s);\n", indent, m->states[s].entry, ref(o, m, s));
+    }
+  }
+  emit_set_history(o, chart, p->leaf, "SC_NO_STATE", indent);
+
+  // Path entries above the boundary stay as they are
+  fprintf(out, "%ssm->_leaf = %s_%s;\n", indent, o->upper, m->states[p->leaf].name);
+  for (StateId s = p->leaf; chart->_depth[s] > chart->_depth[p->boundary]; s = chart->_parent[s]) {
+    fprintf(out, "%ssm->_slots[%zu] = %s_%s;\n", indent, chart->_path_slot + chart->_depth[s],
+            o->upper, m->states[s].name);
+  }
+}
+
+/** \brief Evaluates the candidates in order and takes the first one whose guard passes. */
+static void emit_candidates(Output const *o, Model const *m, Built const *b, size_t leaf,
+                            uint16_t const *candidates, size_t n, char const *indent) {
+  FILE *const out = o->out;
+  char inner[32];
+  snprintf(inner, sizeof(inner), "%s  ", indent);
+  for (size_t c = 0; c < n; ++c) {
+    size_t state;
+    size_t index;
+    GenTransition const *t = locate(m, b, candidates[c], &state, &index);
+    if (!t->guard[0]) {
+      emit_transition(o, m, b, leaf, candidates[c], indent);
+      fprintf(out, "%sreturn true;\n", indent);
+      return;
+    }
+    fprintf(out, "%sif (%s(sm, e)) {\n", indent, t->guard);
+    emit_transition(o, m, b, leaf, candidates[c], inner);
+    fprintf(out, "%s  return true;\n%s}\n", indent, indent);
+  }
+  fprintf(out, "%sreturn false;\n", indent);
+}
+
+/** \brief Composite states always descend to their initial state. */
+static bool can_be_leaf(GenState const *s) {
+  return !s->initial[0] && s->type != SC_TYPE_HISTORY && s->type != SC_TYPE_HISTORY_DEEP &&
+         s->type != SC_TYPE_ROOT;
+}
+
+/** \brief Whether `leaf` can be active and a state of its branch has a run function. */
+static bool has_run_functions(Model const *m, Chart const *chart, size_t leaf) {
+  if (!can_be_leaf(&m->states[leaf])) {
+    return false;
+  }
+  for (StateId s = (StateId)leaf; s != SC_NO_STATE; s = chart->_parent[s]) {
+    if (m->states[s].run[0]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/** \brief Writes the body of `run_functions()`: One case per leaf with run functions. */
+static void emit_run_functions(Output const *o, Model const *m, Chart const *chart) {
+  FILE *const out = o->out;
+
+  fprintf(out, "  State const *requested = NULL;\n  switch (sm->_leaf) {\n");
+  for (size_t leaf = 0; leaf < m->num_states; ++leaf) {
+    if (!has_run_functions(m, chart, leaf)) {
+      continue;
+    }
+    fprintf(out, "  case %s_%s:\n", o->upper, m->states[leaf].name);
+    for (StateId s = (StateId)leaf; s != SC_NO_STATE; s = chart->_parent[s]) {
+      if (m->states[s].run[0]) {
+        fprintf(out,
+                "    requested = %s(sm, %s, e);\n"
+                "    if (requested && requested != %s) {\n"
+                "      return requested;\n"
+                "    }\n",
+                m->states[s].run, ref(o, m, s), ref(o, m, leaf));
+      }
+    }
+    fprintf(out, "    return NULL;\n");
+  }
+  fprintf(out, "  default:\n    return NULL;\n  }\n}\n\n");
+}
+
+/**
+ * \brief Writes `prefix_run_event()` and `prefix_run()`
+ *
+ * The hierarchy is flattened into `switch (leaf) / switch (event)`: For every possible leaf the
+ * candidate transitions of every event are evaluated in sc_run() order, exits, action and entries
+ * of static transitions are direct calls. History targets and states requested by run functions
+ * go through sc_execute_dynamic_().
+ */
+static void emit_engine(Output const *o, Model const *m, Built const *b) {
+  FILE *const out = o->out;
+  Chart const *const chart = &b->chart;
+
+  fprintf(out, "\n/* -------- Switch engine -------- */\n\n"
+               "/** \\brief Finds and takes a transition of the active leaf. */\n"
+               "static bool take_transition(Machine *sm, Event const *e) {\n"
+               "  switch (sm->_leaf) {\n");
+  for (size_t leaf = 0; leaf < m->num_states; ++leaf) {
+    uint16_t const *automatic = NULL;
+    size_t const num_automatic = candidates_of(chart, leaf, SC_NO_EVENT, &automatic);
+    bool any = num_automatic > 0;
+    for (EventType e = 1; e < chart->num_events && !any; ++e) {
+      uint16_t const *c;
+      any = candidates_of(chart, leaf, e, &c) > 0;
+    }
+    if (!can_be_leaf(&m->states[leaf]) || !any) {
+      continue;
+    }
+
+    fprintf(out, "  case %s_%s:\n    switch (e->type) {\n", o->upper, m->states[leaf].name);
+    for (EventType e = 1; e < chart->num_events; ++e) {
+      uint16_t const *c = NULL;
+      size_t const n = candidates_of(chart, leaf, e, &c);
+      if (n) {
+        fprintf(out, "    case %s_%s:\n", o->upper, m->events[e - 1]);
+        emit_candidates(o, m, b, leaf, c, n, "      ");
+      }
+    }
+    // Other events, also those outside the index, do not test automatic transitions
+    if (num_automatic) {
+      fprintf(out, "    case SC_NO_EVENT:\n");
+      emit_candidates(o, m, b, leaf, automatic, num_automatic, "      ");
+    }
+    fprintf(out, "    default:\n      return false;\n    }\n");
+  }
+  fprintf(out, "  default:\n    return false;\n  }\n}\n\n");
+
+  fprintf(out, "/** \\brief Calls the run functions from the active leaf up. Returns a requested "
+               "state. */\n"
+               "static State const *run_functions(Machine *sm, Event const *e) {\n");
+  bool any = false;
+  for (size_t leaf = 0; leaf < m->num_states && !any; ++leaf) {
+    any = has_run_functions(m, chart, leaf);
+  }
+  if (!any) {
+    fprintf(out, "  (void)sm;\n  (void)e;\n  return NULL;\n}\n\n");
+  } else {
+    emit_run_functions(o, m, chart);
+  }
+
+  fprintf(out,
+          "State const *%s_run_event(Machine *sm, Event const *event) {\n"
+          "  static Event const no_event = {.type = SC_NO_EVENT};\n"
+          "  Event const *trigger = event;\n"
+          "\n"
+          "  // Like sc_run(): Transitions, else run functions, until neither changes the state\n"
+          "  for (;;) {\n"
+          "    if (!take_transition(sm, trigger)) {\n"
+          "      State const *requested = run_functions(sm, event);\n"
+          "      if (!requested) {\n"
+          "        break;\n"
+          "      }\n"
+          "      sc_execute_dynamic_(sm, NULL, requested, trigger);\n"
+          "    }\n"
+          "    trigger = &no_event;\n"
+          "  }\n"
+          "\n"
+          "  return &%s_states[sm->_leaf];\n"
+          "}\n"
+          "\n"
+          "State const *%s_run(Machine *sm, EventType event) {\n"
+          "  return %s_run_event(sm, &(Event const){.type = event});\n"
+          "}\n",
+          o->prefix, o->prefix, o->prefix, o->prefix);
+}
+
+/* -------- Main -------- */
+
+static void usage(void) {
+  fprintf(stderr, "usage: hsm4c_gen [--prefix=name] [--switch] chart.puml out/name\n");
+}
+
+static FILE *open_output(char const *base, char const *ext) {
+  char path[1024];
+  snprintf(path, sizeof(path), "%s%s", base, ext);
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    perror(path);
+    exit(EXIT_FAILURE);
+  }
+  return f;
+}
+
+int main(int argc, char *argv[]) {
+  char const *prefix = NULL;
+  bool engine = false;
+  int arg = 1;
+  for (; arg < argc && starts_with(argv[arg], "--"); ++arg) {
+    if (starts_with(argv[arg], "--prefix=")) {
+      prefix = argv[arg] + 9;
+    } else if (strcmp(argv[arg], "--switch") == 0) {
+      engine = true;
+    } else {
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+  if (argc - arg != 2) {
+    usage();
+    return EXIT_FAILURE;
+  }
+  input_name = argv[arg];
+  char const *const base = argv[arg + 1];
+  char const *const slash = strrchr(base, '/');
+  char const *const basename = slash ? slash + 1 : base;
+  if (!prefix) {
+    prefix = basename;
+  }
+
+  Output o = {.prefix = prefix, .engine = engine};
+  Name check;
+  if (strlen(prefix) >= MAX_NAME || read_ident(prefix, check, 0) != prefix + strlen(prefix)) {
+    fprintf(stderr, "prefix '%s' is not an identifier\n", prefix);
+    return EXIT_FAILURE;
+  }
+  for (size_t i = 0; prefix[i]; ++i) {
+    o.upper[i] = (char)toupper((unsigned char)prefix[i]);
+  }
+
+  FILE *in = fopen(input_name, "r");
+  if (!in) {
+    perror(input_name);
+    return EXIT_FAILURE;
+  }
+  Model m = {0};
+  parse(in, &m);
+  fclose(in);
+
+  Built b;
+  build(&m, &b);
+  if (o.engine && b.chart._config_words) {
+    fprintf(stderr, "--switch does not support parallel states\n");
+    return EXIT_FAILURE;
+  }
+
+  char header[1024];
+  snprintf(header, sizeof(header), "%s.h", basename);
+  char const *const input_slash = strrchr(input_name, '/');
+
+  o.out = open_output(base, ".h");
+  emit_header(&o, &m, &b, input_slash ? input_slash + 1 : input_name);
+  fclose(o.out);
+
+  o.out = open_output(base, ".c");
+  emit_source(&o, &m, &b, header);
+  if (o.engine) {
+    emit_engine(&o, &m, &b);
+  }
+  fclose(o.out);
+  return EXIT_SUCCESS;
+}
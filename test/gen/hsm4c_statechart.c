@@ -0,0 +1,1190 @@
+/**
+ * \brief Statechart generated by hsm4c_gen. Do not edit.
+ * \file
+ */
+
+#include "hsm4c_statechart.h"
+
+/* -------- Transitions -------- */
+
+static Transition const transitions_a[] = {
+    {
+        .from = &gen_states[GEN_A],
+        .to = &gen_states[GEN_B],
+        .event = GEN_EV_1,
+        .transition_fn = t_action,
+        .guard_fn = t_guard,
+    },
+    {
+        .from = &gen_states[GEN_A],
+        .to = &gen_states[GEN_BB],
+        .event = GEN_EV_2,
+        .transition_fn = t_action,
+        .guard_fn = t_guard,
+    },
+    {
+        .from = &gen_states[GEN_A],
+        .to = &gen_states[GEN_B_H],
+        .event = GEN_EV_7,
+        .transition_fn = t_action,
+        .guard_fn = t_guard,
+    },
+    {.type = SC_TTYPE_TABLE_END},
+};
+
+static Transition const transitions_aa[] = {
+    {
+        .from = &gen_states[GEN_AA],
+        .to = &gen_states[GEN_AB],
+        .event = GEN_EV_3,
+        .transition_fn = t_action,
+        .guard_fn = t_guard,
+    },
+    {
+        .from = &gen_states[GEN_AA],
+        .to = &gen_states[GEN_B],
+        .event = GEN_EV_4,
+        .transition_fn = t_action,
+        .guard_fn = t_guard,
+    },
+    {
+        .from = &gen_states[GEN_AA],
+        .to = &gen_states[GEN_A_CHOICE],
+        .event = GEN_EV_6,
+        .transition_fn = t_action,
+        .guard_fn = t_guard,
+    },
+    {
+        .from = &gen_states[GEN_AA],
+        .to = &gen_states[GEN_AAB],
+        .event = GEN_EV_9,
+        .transition_fn = t_action,
+        .guard_fn = t_guard,
+    },
+    {
+        .from = &gen_states[GEN_AA],
+        .to = &gen_states[GEN_AAB],
+        .event = GEN_EV_10,
+        .transition_fn = t_action,
+        .guard_fn = t_guard,
+        .type = SC_TTYPE_LOCAL,
+    },
+    {.type = SC_TTYPE_TABLE_END},
+};
+
+static Transition const transitions_aaa[] = {
+    {
+        .from = &gen_states[GEN_AAA],
+        .to = &gen_states[GEN_AAB],
+        .event = GEN_EV_4,
+        .transition_fn = t_action,
+        .guard_fn = t_guard,
+    },
+    {
+        .from = &gen_states[GEN_AAA],
+        .to = &gen_states[GEN_AAA],
+        .event = GEN_EV_8,
+        .transition_fn = t_action,
+        .guard_fn = t_guard,
+    },
+    {
+        .from = &gen_states[GEN_AAA],
+        .to = &gen_states[GEN_AAA],
+        .event = GEN_EV_11,
+        .transition_fn = t_action,
+        .guard_fn = t_guard,
+        .type = SC_TTYPE_LOCAL,
+    },
+    {.type = SC_TTYPE_TABLE_END},
+};
+
+static Transition const transitions_aab[] = {
+    {
+        .from = &gen_states[GEN_AAB],
+        .to = &gen_states[GEN_AA],
+        .event = GEN_EV_12,
+        .transition_fn = t_action,
+        .guard_fn = t_guard,
+        .type = SC_TTYPE_LOCAL,
+    },
+    {.type = SC_TTYPE_TABLE_END},
+};
+
+static Transition const transitions_ab[] = {
+    {
+        .from = &gen_states[GEN_AB],
+        .to = &gen_states[GEN_B],
+        .event = GEN_EV_3,
+        .transition_fn = t_action,
+        .guard_fn = t_guard,
+    },
+    {.type = SC_TTYPE_TABLE_END},
+};
+
+static Transition const transitions_a_choice[] = {
+    {
+        .from = &gen_states[GEN_A_CHOICE],
+        .to = &gen_states[GEN_B],
+        .event = SC_NO_EVENT,
+        .transition_fn = t_action,
+        .guard_fn = t_choice_A,
+    },
+    {
+        .from = &gen_states[GEN_A_CHOICE],
+        .to = &gen_states[GEN_C],
+        .event = SC_NO_EVENT,
+        .transition_fn = t_action,
+        .guard_fn = t_choice_B,
+    },
+    {.type = SC_TTYPE_TABLE_END},
+};
+
+static Transition const transitions_b[] = {
+    {
+        .from = &gen_states[GEN_B],
+        .to = &gen_states[GEN_A],
+        .event = GEN_EV_1,
+        .transition_fn = t_action,
+        .guard_fn = t_guard,
+    },
+    {
+        .from = &gen_states[GEN_B],
+        .to = &gen_states[GEN_A_H],
+        .event = GEN_EV_3,
+        .transition_fn = t_action,
+        .guard_fn = t_guard,
+    },
+    {
+        .from = &gen_states[GEN_B],
+        .to = &gen_states[GEN_A_H],
+        .event = GEN_EV_4,
+        .transition_fn = t_action,
+        .guard_fn = t_guard,
+    },
+    {
+        .from = &gen_states[GEN_B],
+        .to = &gen_states[GEN_A_DH],
+        .event = GEN_EV_5,
+        .transition_fn = t_action,
+        .guard_fn = t_guard,
+    },
+    {.type = SC_TTYPE_TABLE_END},
+};
+
+/* -------- States -------- */
+
+static StateConfig const statecfgs[GEN_NUM_STATES] = {
+    [GEN_ROOT] =
+        {
+            .name = "ROOT",
+            .entry_fn = s_entry,
+            .exit_fn = s_exit,
+            .run_fn = s_run,
+            .initial = &gen_states[GEN_A],
+            .type = SC_TYPE_ROOT,
+        },
+    [GEN_A] =
+        {
+            .name = "A",
+            .entry_fn = s_entry,
+            .exit_fn = s_exit,
+            .run_fn = s_run,
+            .parent = &gen_states[GEN_ROOT],
+            .initial = &gen_states[GEN_AA],
+            .transitions = transitions_a,
+        },
+    [GEN_AA] =
+        {
+            .name = "AA",
+            .entry_fn = s_entry,
+            .exit_fn = s_exit,
+            .run_fn = s_run,
+            .parent = &gen_states[GEN_A],
+            .initial = &gen_states[GEN_AAA],
+            .transitions = transitions_aa,
+        },
+    [GEN_AAA] =
+        {
+            .name = "AAA",
+            .entry_fn = s_entry,
+            .exit_fn = s_exit,
+            .run_fn = s_run,
+            .parent = &gen_states[GEN_AA],
+            .transitions = transitions_aaa,
+        },
+    [GEN_AAB] =
+        {
+            .name = "AAB",
+            .entry_fn = s_entry,
+            .exit_fn = s_exit,
+            .run_fn = s_run,
+            .parent = &gen_states[GEN_AA],
+            .transitions = transitions_aab,
+        },
+    [GEN_AB] =
+        {
+            .name = "AB",
+            .entry_fn = s_entry,
+            .exit_fn = s_exit,
+            .run_fn = s_run,
+            .parent = &gen_states[GEN_A],
+            .transitions = transitions_ab,
+        },
+    [GEN_AC] =
+        {
+            .name = "AC",
+            .entry_fn = s_entry,
+            .exit_fn = s_exit,
+            .run_fn = s_run,
+            .parent = &gen_states[GEN_A],
+        },
+    [GEN_A_H] =
+        {
+            .name = "A_H",
+            .parent = &gen_states[GEN_A],
+            .initial = &gen_states[GEN_AB],
+            .type = SC_TYPE_HISTORY,
+        },
+    [GEN_A_DH] =
+        {
+            .name = "A_DH",
+            .parent = &gen_states[GEN_A],
+            .initial = &gen_states[GEN_AC],
+            .type = SC_TYPE_HISTORY_DEEP,
+        },
+    [GEN_A_CHOICE] =
+        {
+            .name = "A_CHOICE",
+            .parent = &gen_states[GEN_A],
+            .type = SC_TYPE_CHOICE,
+            .transitions = transitions_a_choice,
+        },
+    [GEN_B] =
+        {
+            .name = "B",
+            .entry_fn = s_entry,
+            .exit_fn = s_exit,
+            .run_fn = s_run,
+            .parent = &gen_states[GEN_ROOT],
+            .initial = &gen_states[GEN_BA],
+            .transitions = transitions_b,
+        },
+    [GEN_BA] =
+        {
+            .name = "BA",
+            .entry_fn = s_entry,
+            .exit_fn = s_exit,
+            .run_fn = s_run,
+            .parent = &gen_states[GEN_B],
+        },
+    [GEN_BB] =
+        {
+            .name = "BB",
+            .entry_fn = s_entry,
+            .exit_fn = s_exit,
+            .run_fn = s_run,
+            .parent = &gen_states[GEN_B],
+        },
+    [GEN_BC] =
+        {
+            .name = "BC",
+            .entry_fn = s_entry,
+            .exit_fn = s_exit,
+            .run_fn = s_run,
+            .parent = &gen_states[GEN_B],
+        },
+    [GEN_B_H] =
+        {
+            .name = "B_H",
+            .parent = &gen_states[GEN_B],
+            .initial = &gen_states[GEN_BC],
+            .type = SC_TYPE_HISTORY,
+        },
+    [GEN_C] =
+        {
+            .name = "C",
+            .entry_fn = s_entry,
+            .exit_fn = s_exit,
+            .run_fn = s_run,
+            .parent = &gen_states[GEN_ROOT],
+        },
+};
+
+State const gen_states[GEN_NUM_STATES] = {
+    [GEN_ROOT] = {&statecfgs[GEN_ROOT]},
+    [GEN_A] = {&statecfgs[GEN_A]},
+    [GEN_AA] = {&statecfgs[GEN_AA]},
+    [GEN_AAA] = {&statecfgs[GEN_AAA]},
+    [GEN_AAB] = {&statecfgs[GEN_AAB]},
+    [GEN_AB] = {&statecfgs[GEN_AB]},
+    [GEN_AC] = {&statecfgs[GEN_AC]},
+    [GEN_A_H] = {&statecfgs[GEN_A_H]},
+    [GEN_A_DH] = {&statecfgs[GEN_A_DH]},
+    [GEN_A_CHOICE] = {&statecfgs[GEN_A_CHOICE]},
+    [GEN_B] = {&statecfgs[GEN_B]},
+    [GEN_BA] = {&statecfgs[GEN_BA]},
+    [GEN_BB] = {&statecfgs[GEN_BB]},
+    [GEN_BC] = {&statecfgs[GEN_BC]},
+    [GEN_B_H] = {&statecfgs[GEN_B_H]},
+    [GEN_C] = {&statecfgs[GEN_C]},
+};
+
+/* -------- Dispatch index, see sc_compile() -------- */
+
+static Transition const *const transition_ids[19] = {
+    &transitions_a[0],
+    &transitions_a[1],
+    &transitions_a[2],
+    &transitions_aa[0],
+    &transitions_aa[1],
+    &transitions_aa[2],
+    &transitions_aa[3],
+    &transitions_aa[4],
+    &transitions_aaa[0],
+    &transitions_aaa[1],
+    &transitions_aaa[2],
+    &transitions_aab[0],
+    &transitions_ab[0],
+    &transitions_a_choice[0],
+    &transitions_a_choice[1],
+    &transitions_b[0],
+    &transitions_b[1],
+    &transitions_b[2],
+    &transitions_b[3],
+};
+
+static uint32_t const handles[16] = {
+    0, 134, 1758, 4062, 5854, 142, 134, 134, 134, 135, 58, 58, 58, 58, 58, 0,
+};
+
+static uint32_t const run_base[16] = {
+    0, 0, 3, 11, 21, 30, 34, 37, 40, 43, 47, 51, 55, 59, 63, 67,
+};
+
+static uint32_t const runs[68] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26,
+    27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 46, 47, 48, 49, 50, 51,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69,
+};
+
+static uint16_t const candidates[69] = {
+    0, 1, 2, 0, 1, 3, 4, 5, 2, 6, 7, 0, 1, 3, 8, 4, 5, 2, 9, 6, 7, 10, 0, 1, 3, 4, 5, 2, 6, 7, 11,
+    0, 1, 12, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 13, 14, 0, 1, 2, 15, 16, 17, 18, 15, 16, 17, 18, 15, 16,
+    17, 18, 15, 16, 17, 18, 15, 16, 17, 18,
+};
+
+static StateId const parent[16] = {
+    SC_NO_STATE, 0, 1, 2, 2, 1, 1, 1, 1, 1, 0, 10, 10, 10, 10, 0,
+};
+
+static uint16_t const depth[16] = {
+    0, 1, 2, 3, 3, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 1,
+};
+
+static bool const branch_runs[16] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+};
+
+static StateId const path_states[25] = {
+    10, 11, 10, 12, 5, 10, 11, 9, 2, 4, 2, 4, 4, 3, 3, 2, 3, 10, 11, 10, 11, 15, 1, 2, 3,
+};
+
+static StateId const history_slot[16] = {
+    SC_NO_STATE, 0, 1, SC_NO_STATE, SC_NO_STATE, SC_NO_STATE, SC_NO_STATE, SC_NO_STATE, SC_NO_STATE,
+    SC_NO_STATE, 2, SC_NO_STATE, SC_NO_STATE, SC_NO_STATE, SC_NO_STATE, SC_NO_STATE,
+};
+
+static struct TransitionPath const paths[19] = {
+    {.boundary = 0, .leaf = 11, .skip = 0, .len = 2, .begin = 0},
+    {.boundary = 0, .leaf = 12, .skip = 0, .len = 2, .begin = 2},
+    {.dynamic = true},
+    {.boundary = 1, .leaf = 5, .skip = 0, .len = 1, .begin = 4},
+    {.boundary = 0, .leaf = 11, .skip = 0, .len = 2, .begin = 5},
+    {.boundary = 1, .leaf = 9, .skip = 0, .len = 1, .begin = 7},
+    {.boundary = 1, .leaf = 4, .skip = 0, .len = 2, .begin = 8},
+    {.boundary = 2, .leaf = 4, .skip = 1, .len = 2, .begin = 10},
+    {.boundary = 2, .leaf = 4, .skip = 0, .len = 1, .begin = 12},
+    {.boundary = 2, .leaf = 3, .skip = 0, .len = 1, .begin = 13},
+    {.boundary = 3, .leaf = 3, .skip = 1, .len = 1, .begin = 14},
+    {.boundary = 2, .leaf = 3, .skip = 1, .len = 2, .begin = 15},
+    {.boundary = 0, .leaf = 11, .skip = 0, .len = 2, .begin = 17},
+    {.boundary = 0, .leaf = 11, .skip = 0, .len = 2, .begin = 19},
+    {.boundary = 0, .leaf = 15, .skip = 0, .len = 1, .begin = 21},
+    {.boundary = 0, .leaf = 3, .skip = 0, .len = 3, .begin = 22},
+    {.dynamic = true},
+    {.dynamic = true},
+    {.dynamic = true},
+};
+
+static void (*const functions[8])(void) = {
+    NULL,
+    (void (*)(void))s_entry,
+    (void (*)(void))s_exit,
+    (void (*)(void))s_run,
+    (void (*)(void))t_guard,
+    (void (*)(void))t_action,
+    (void (*)(void))t_choice_A,
+    (void (*)(void))t_choice_B,
+};
+
+static struct CompactState const compact_states[16] = {
+    [GEN_ROOT] = {1, 2, 3},
+    [GEN_A] = {1, 2, 3},
+    [GEN_AA] = {1, 2, 3},
+    [GEN_AAA] = {1, 2, 3},
+    [GEN_AAB] = {1, 2, 3},
+    [GEN_AB] = {1, 2, 3},
+    [GEN_AC] = {1, 2, 3},
+    [GEN_A_H] = {0, 0, 0},
+    [GEN_A_DH] = {0, 0, 0},
+    [GEN_A_CHOICE] = {0, 0, 0},
+    [GEN_B] = {1, 2, 3},
+    [GEN_BA] = {1, 2, 3},
+    [GEN_BB] = {1, 2, 3},
+    [GEN_BC] = {1, 2, 3},
+    [GEN_B_H] = {0, 0, 0},
+    [GEN_C] = {1, 2, 3},
+};
+
+static struct CompactTransition const compact_transitions[19] = {
+    {GEN_A, GEN_B, 4, 5},
+    {GEN_A, GEN_BB, 4, 5},
+    {GEN_A, GEN_B_H, 4, 5},
+    {GEN_AA, GEN_AB, 4, 5},
+    {GEN_AA, GEN_B, 4, 5},
+    {GEN_AA, GEN_A_CHOICE, 4, 5},
+    {GEN_AA, GEN_AAB, 4, 5},
+    {GEN_AA, GEN_AAB, 4, 5},
+    {GEN_AAA, GEN_AAB, 4, 5},
+    {GEN_AAA, GEN_AAA, 4, 5},
+    {GEN_AAA, GEN_AAA, 4, 5},
+    {GEN_AAB, GEN_AA, 4, 5},
+    {GEN_AB, GEN_B, 4, 5},
+    {GEN_A_CHOICE, GEN_B, 6, 5},
+    {GEN_A_CHOICE, GEN_C, 7, 5},
+    {GEN_B, GEN_A, 4, 5},
+    {GEN_B, GEN_A_H, 4, 5},
+    {GEN_B, GEN_A_H, 4, 5},
+    {GEN_B, GEN_A_DH, 4, 5},
+};
+
+Chart const gen_chart = {
+    .root = &gen_states[GEN_ROOT],
+    .states = gen_states,
+    .num_states = GEN_NUM_STATES,
+    .num_transitions = 19,
+    .num_events = 13,
+    .machine_slots = GEN_MACHINE_SLOTS,
+    ._transitions = transition_ids,
+    ._compact_transitions = compact_transitions,
+    ._compact_states = compact_states,
+    ._functions = functions,
+    ._num_functions = 8,
+    ._event_words = 1,
+    ._handles = handles,
+    ._run_base = run_base,
+    ._runs = runs,
+    ._candidates = candidates,
+    ._parent = parent,
+    ._depth = depth,
+    ._branch_runs = branch_runs,
+    ._paths = paths,
+    ._path_states = path_states,
+    ._history_slot = history_slot,
+    ._path_slot = 3,
+    ._guard_slot = 7,
+    ._config_words = 0,
+    ._config_slot = 7,
+    ._first_child = NULL,
+    ._next_sibling = NULL,
+};
+
+/* -------- Switch engine -------- */
+
+/** \brief Finds and takes a transition of the active leaf. */
+static bool take_transition(Machine *sm, Event const *e) {
+  switch (sm->_leaf) {
+  case GEN_AAA:
+    switch (e->type) {
+    case GEN_EV_1:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AAA]);
+        s_exit(sm, &gen_states[GEN_AA]);
+        s_exit(sm, &gen_states[GEN_A]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_B]);
+        sm->_slots[2] = GEN_BA;
+        s_entry(sm, &gen_states[GEN_BA]);
+        sm->_leaf = GEN_BA;
+        sm->_slots[5] = GEN_BA;
+        sm->_slots[4] = GEN_B;
+        return true;
+      }
+      return false;
+    case GEN_EV_2:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AAA]);
+        s_exit(sm, &gen_states[GEN_AA]);
+        s_exit(sm, &gen_states[GEN_A]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_B]);
+        sm->_slots[2] = GEN_BB;
+        s_entry(sm, &gen_states[GEN_BB]);
+        sm->_leaf = GEN_BB;
+        sm->_slots[5] = GEN_BB;
+        sm->_slots[4] = GEN_B;
+        return true;
+      }
+      return false;
+    case GEN_EV_3:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AAA]);
+        s_exit(sm, &gen_states[GEN_AA]);
+        t_action(sm, e);
+        sm->_slots[0] = GEN_AB;
+        s_entry(sm, &gen_states[GEN_AB]);
+        sm->_leaf = GEN_AB;
+        sm->_slots[5] = GEN_AB;
+        return true;
+      }
+      return false;
+    case GEN_EV_4:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AAA]);
+        t_action(sm, e);
+        sm->_slots[1] = GEN_AAB;
+        s_entry(sm, &gen_states[GEN_AAB]);
+        sm->_leaf = GEN_AAB;
+        sm->_slots[6] = GEN_AAB;
+        return true;
+      }
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AAA]);
+        s_exit(sm, &gen_states[GEN_AA]);
+        s_exit(sm, &gen_states[GEN_A]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_B]);
+        sm->_slots[2] = GEN_BA;
+        s_entry(sm, &gen_states[GEN_BA]);
+        sm->_leaf = GEN_BA;
+        sm->_slots[5] = GEN_BA;
+        sm->_slots[4] = GEN_B;
+        return true;
+      }
+      return false;
+    case GEN_EV_6:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AAA]);
+        s_exit(sm, &gen_states[GEN_AA]);
+        t_action(sm, e);
+        sm->_slots[0] = GEN_A_CHOICE;
+        sm->_leaf = GEN_A_CHOICE;
+        sm->_slots[5] = GEN_A_CHOICE;
+        return true;
+      }
+      return false;
+    case GEN_EV_7:
+      if (t_guard(sm, e)) {
+        sc_execute_dynamic_(sm, &transitions_a[2], &gen_states[GEN_B_H], e);
+        return true;
+      }
+      return false;
+    case GEN_EV_8:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AAA]);
+        t_action(sm, e);
+        sm->_slots[1] = GEN_AAA;
+        s_entry(sm, &gen_states[GEN_AAA]);
+        sm->_leaf = GEN_AAA;
+        sm->_slots[6] = GEN_AAA;
+        return true;
+      }
+      return false;
+    case GEN_EV_9:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AAA]);
+        s_exit(sm, &gen_states[GEN_AA]);
+        t_action(sm, e);
+        sm->_slots[0] = GEN_AA;
+        s_entry(sm, &gen_states[GEN_AA]);
+        sm->_slots[1] = GEN_AAB;
+        s_entry(sm, &gen_states[GEN_AAB]);
+        sm->_leaf = GEN_AAB;
+        sm->_slots[6] = GEN_AAB;
+        sm->_slots[5] = GEN_AA;
+        return true;
+      }
+      return false;
+    case GEN_EV_10:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AAA]);
+        t_action(sm, e);
+        sm->_slots[0] = GEN_AA;
+        sm->_slots[1] = GEN_AAB;
+        s_entry(sm, &gen_states[GEN_AAB]);
+        sm->_leaf = GEN_AAB;
+        sm->_slots[6] = GEN_AAB;
+        return true;
+      }
+      return false;
+    case GEN_EV_11:
+      if (t_guard(sm, e)) {
+        t_action(sm, e);
+        sm->_slots[1] = GEN_AAA;
+        sm->_leaf = GEN_AAA;
+        return true;
+      }
+      return false;
+    default:
+      return false;
+    }
+  case GEN_AAB:
+    switch (e->type) {
+    case GEN_EV_1:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AAB]);
+        s_exit(sm, &gen_states[GEN_AA]);
+        s_exit(sm, &gen_states[GEN_A]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_B]);
+        sm->_slots[2] = GEN_BA;
+        s_entry(sm, &gen_states[GEN_BA]);
+        sm->_leaf = GEN_BA;
+        sm->_slots[5] = GEN_BA;
+        sm->_slots[4] = GEN_B;
+        return true;
+      }
+      return false;
+    case GEN_EV_2:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AAB]);
+        s_exit(sm, &gen_states[GEN_AA]);
+        s_exit(sm, &gen_states[GEN_A]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_B]);
+        sm->_slots[2] = GEN_BB;
+        s_entry(sm, &gen_states[GEN_BB]);
+        sm->_leaf = GEN_BB;
+        sm->_slots[5] = GEN_BB;
+        sm->_slots[4] = GEN_B;
+        return true;
+      }
+      return false;
+    case GEN_EV_3:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AAB]);
+        s_exit(sm, &gen_states[GEN_AA]);
+        t_action(sm, e);
+        sm->_slots[0] = GEN_AB;
+        s_entry(sm, &gen_states[GEN_AB]);
+        sm->_leaf = GEN_AB;
+        sm->_slots[5] = GEN_AB;
+        return true;
+      }
+      return false;
+    case GEN_EV_4:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AAB]);
+        s_exit(sm, &gen_states[GEN_AA]);
+        s_exit(sm, &gen_states[GEN_A]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_B]);
+        sm->_slots[2] = GEN_BA;
+        s_entry(sm, &gen_states[GEN_BA]);
+        sm->_leaf = GEN_BA;
+        sm->_slots[5] = GEN_BA;
+        sm->_slots[4] = GEN_B;
+        return true;
+      }
+      return false;
+    case GEN_EV_6:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AAB]);
+        s_exit(sm, &gen_states[GEN_AA]);
+        t_action(sm, e);
+        sm->_slots[0] = GEN_A_CHOICE;
+        sm->_leaf = GEN_A_CHOICE;
+        sm->_slots[5] = GEN_A_CHOICE;
+        return true;
+      }
+      return false;
+    case GEN_EV_7:
+      if (t_guard(sm, e)) {
+        sc_execute_dynamic_(sm, &transitions_a[2], &gen_states[GEN_B_H], e);
+        return true;
+      }
+      return false;
+    case GEN_EV_9:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AAB]);
+        s_exit(sm, &gen_states[GEN_AA]);
+        t_action(sm, e);
+        sm->_slots[0] = GEN_AA;
+        s_entry(sm, &gen_states[GEN_AA]);
+        sm->_slots[1] = GEN_AAB;
+        s_entry(sm, &gen_states[GEN_AAB]);
+        sm->_leaf = GEN_AAB;
+        sm->_slots[6] = GEN_AAB;
+        sm->_slots[5] = GEN_AA;
+        return true;
+      }
+      return false;
+    case GEN_EV_10:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AAB]);
+        t_action(sm, e);
+        sm->_slots[0] = GEN_AA;
+        sm->_slots[1] = GEN_AAB;
+        s_entry(sm, &gen_states[GEN_AAB]);
+        sm->_leaf = GEN_AAB;
+        sm->_slots[6] = GEN_AAB;
+        return true;
+      }
+      return false;
+    case GEN_EV_12:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AAB]);
+        t_action(sm, e);
+        sm->_slots[0] = GEN_AA;
+        sm->_slots[1] = GEN_AAA;
+        s_entry(sm, &gen_states[GEN_AAA]);
+        sm->_leaf = GEN_AAA;
+        sm->_slots[6] = GEN_AAA;
+        return true;
+      }
+      return false;
+    default:
+      return false;
+    }
+  case GEN_AB:
+    switch (e->type) {
+    case GEN_EV_1:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AB]);
+        s_exit(sm, &gen_states[GEN_A]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_B]);
+        sm->_slots[2] = GEN_BA;
+        s_entry(sm, &gen_states[GEN_BA]);
+        sm->_leaf = GEN_BA;
+        sm->_slots[5] = GEN_BA;
+        sm->_slots[4] = GEN_B;
+        return true;
+      }
+      return false;
+    case GEN_EV_2:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AB]);
+        s_exit(sm, &gen_states[GEN_A]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_B]);
+        sm->_slots[2] = GEN_BB;
+        s_entry(sm, &gen_states[GEN_BB]);
+        sm->_leaf = GEN_BB;
+        sm->_slots[5] = GEN_BB;
+        sm->_slots[4] = GEN_B;
+        return true;
+      }
+      return false;
+    case GEN_EV_3:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AB]);
+        s_exit(sm, &gen_states[GEN_A]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_B]);
+        sm->_slots[2] = GEN_BA;
+        s_entry(sm, &gen_states[GEN_BA]);
+        sm->_leaf = GEN_BA;
+        sm->_slots[5] = GEN_BA;
+        sm->_slots[4] = GEN_B;
+        return true;
+      }
+      return false;
+    case GEN_EV_7:
+      if (t_guard(sm, e)) {
+        sc_execute_dynamic_(sm, &transitions_a[2], &gen_states[GEN_B_H], e);
+        return true;
+      }
+      return false;
+    default:
+      return false;
+    }
+  case GEN_AC:
+    switch (e->type) {
+    case GEN_EV_1:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AC]);
+        s_exit(sm, &gen_states[GEN_A]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_B]);
+        sm->_slots[2] = GEN_BA;
+        s_entry(sm, &gen_states[GEN_BA]);
+        sm->_leaf = GEN_BA;
+        sm->_slots[5] = GEN_BA;
+        sm->_slots[4] = GEN_B;
+        return true;
+      }
+      return false;
+    case GEN_EV_2:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_AC]);
+        s_exit(sm, &gen_states[GEN_A]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_B]);
+        sm->_slots[2] = GEN_BB;
+        s_entry(sm, &gen_states[GEN_BB]);
+        sm->_leaf = GEN_BB;
+        sm->_slots[5] = GEN_BB;
+        sm->_slots[4] = GEN_B;
+        return true;
+      }
+      return false;
+    case GEN_EV_7:
+      if (t_guard(sm, e)) {
+        sc_execute_dynamic_(sm, &transitions_a[2], &gen_states[GEN_B_H], e);
+        return true;
+      }
+      return false;
+    default:
+      return false;
+    }
+  case GEN_A_CHOICE:
+    switch (e->type) {
+    case GEN_EV_1:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_A]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_B]);
+        sm->_slots[2] = GEN_BA;
+        s_entry(sm, &gen_states[GEN_BA]);
+        sm->_leaf = GEN_BA;
+        sm->_slots[5] = GEN_BA;
+        sm->_slots[4] = GEN_B;
+        return true;
+      }
+      return false;
+    case GEN_EV_2:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_A]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_B]);
+        sm->_slots[2] = GEN_BB;
+        s_entry(sm, &gen_states[GEN_BB]);
+        sm->_leaf = GEN_BB;
+        sm->_slots[5] = GEN_BB;
+        sm->_slots[4] = GEN_B;
+        return true;
+      }
+      return false;
+    case GEN_EV_7:
+      if (t_guard(sm, e)) {
+        sc_execute_dynamic_(sm, &transitions_a[2], &gen_states[GEN_B_H], e);
+        return true;
+      }
+      return false;
+    case SC_NO_EVENT:
+      if (t_choice_A(sm, e)) {
+        s_exit(sm, &gen_states[GEN_A]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_B]);
+        sm->_slots[2] = GEN_BA;
+        s_entry(sm, &gen_states[GEN_BA]);
+        sm->_leaf = GEN_BA;
+        sm->_slots[5] = GEN_BA;
+        sm->_slots[4] = GEN_B;
+        return true;
+      }
+      if (t_choice_B(sm, e)) {
+        s_exit(sm, &gen_states[GEN_A]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_C]);
+        sm->_leaf = GEN_C;
+        sm->_slots[4] = GEN_C;
+        return true;
+      }
+      return false;
+    default:
+      return false;
+    }
+  case GEN_BA:
+    switch (e->type) {
+    case GEN_EV_1:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_BA]);
+        s_exit(sm, &gen_states[GEN_B]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_A]);
+        sm->_slots[0] = GEN_AA;
+        s_entry(sm, &gen_states[GEN_AA]);
+        sm->_slots[1] = GEN_AAA;
+        s_entry(sm, &gen_states[GEN_AAA]);
+        sm->_leaf = GEN_AAA;
+        sm->_slots[6] = GEN_AAA;
+        sm->_slots[5] = GEN_AA;
+        sm->_slots[4] = GEN_A;
+        return true;
+      }
+      return false;
+    case GEN_EV_3:
+      if (t_guard(sm, e)) {
+        sc_execute_dynamic_(sm, &transitions_b[1], &gen_states[GEN_A_H], e);
+        return true;
+      }
+      return false;
+    case GEN_EV_4:
+      if (t_guard(sm, e)) {
+        sc_execute_dynamic_(sm, &transitions_b[2], &gen_states[GEN_A_H], e);
+        return true;
+      }
+      return false;
+    case GEN_EV_5:
+      if (t_guard(sm, e)) {
+        sc_execute_dynamic_(sm, &transitions_b[3], &gen_states[GEN_A_DH], e);
+        return true;
+      }
+      return false;
+    default:
+      return false;
+    }
+  case GEN_BB:
+    switch (e->type) {
+    case GEN_EV_1:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_BB]);
+        s_exit(sm, &gen_states[GEN_B]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_A]);
+        sm->_slots[0] = GEN_AA;
+        s_entry(sm, &gen_states[GEN_AA]);
+        sm->_slots[1] = GEN_AAA;
+        s_entry(sm, &gen_states[GEN_AAA]);
+        sm->_leaf = GEN_AAA;
+        sm->_slots[6] = GEN_AAA;
+        sm->_slots[5] = GEN_AA;
+        sm->_slots[4] = GEN_A;
+        return true;
+      }
+      return false;
+    case GEN_EV_3:
+      if (t_guard(sm, e)) {
+        sc_execute_dynamic_(sm, &transitions_b[1], &gen_states[GEN_A_H], e);
+        return true;
+      }
+      return false;
+    case GEN_EV_4:
+      if (t_guard(sm, e)) {
+        sc_execute_dynamic_(sm, &transitions_b[2], &gen_states[GEN_A_H], e);
+        return true;
+      }
+      return false;
+    case GEN_EV_5:
+      if (t_guard(sm, e)) {
+        sc_execute_dynamic_(sm, &transitions_b[3], &gen_states[GEN_A_DH], e);
+        return true;
+      }
+      return false;
+    default:
+      return false;
+    }
+  case GEN_BC:
+    switch (e->type) {
+    case GEN_EV_1:
+      if (t_guard(sm, e)) {
+        s_exit(sm, &gen_states[GEN_BC]);
+        s_exit(sm, &gen_states[GEN_B]);
+        t_action(sm, e);
+        s_entry(sm, &gen_states[GEN_A]);
+        sm->_slots[0] = GEN_AA;
+        s_entry(sm, &gen_states[GEN_AA]);
+        sm->_slots[1] = GEN_AAA;
+        s_entry(sm, &gen_states[GEN_AAA]);
+        sm->_leaf = GEN_AAA;
+        sm->_slots[6] = GEN_AAA;
+        sm->_slots[5] = GEN_AA;
+        sm->_slots[4] = GEN_A;
+        return true;
+      }
+      return false;
+    case GEN_EV_3:
+      if (t_guard(sm, e)) {
+        sc_execute_dynamic_(sm, &transitions_b[1], &gen_states[GEN_A_H], e);
+        return true;
+      }
+      return false;
+    case GEN_EV_4:
+      if (t_guard(sm, e)) {
+        sc_execute_dynamic_(sm, &transitions_b[2], &gen_states[GEN_A_H], e);
+        return true;
+      }
+      return false;
+    case GEN_EV_5:
+      if (t_guard(sm, e)) {
+        sc_execute_dynamic_(sm, &transitions_b[3], &gen_states[GEN_A_DH], e);
+        return true;
+      }
+      return false;
+    default:
+      return false;
+    }
+  default:
+    return false;
+  }
+}
+
+/** \brief Calls the run functions from the active leaf up. Returns a requested state. */
+static State const *run_functions(Machine *sm, Event const *e) {
+  State const *requested = NULL;
+  switch (sm->_leaf) {
+  case GEN_AAA:
+    requested = s_run(sm, &gen_states[GEN_AAA], e);
+    if (requested && requested != &gen_states[GEN_AAA]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_AA], e);
+    if (requested && requested != &gen_states[GEN_AAA]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_A], e);
+    if (requested && requested != &gen_states[GEN_AAA]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_ROOT], e);
+    if (requested && requested != &gen_states[GEN_AAA]) {
+      return requested;
+    }
+    return NULL;
+  case GEN_AAB:
+    requested = s_run(sm, &gen_states[GEN_AAB], e);
+    if (requested && requested != &gen_states[GEN_AAB]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_AA], e);
+    if (requested && requested != &gen_states[GEN_AAB]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_A], e);
+    if (requested && requested != &gen_states[GEN_AAB]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_ROOT], e);
+    if (requested && requested != &gen_states[GEN_AAB]) {
+      return requested;
+    }
+    return NULL;
+  case GEN_AB:
+    requested = s_run(sm, &gen_states[GEN_AB], e);
+    if (requested && requested != &gen_states[GEN_AB]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_A], e);
+    if (requested && requested != &gen_states[GEN_AB]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_ROOT], e);
+    if (requested && requested != &gen_states[GEN_AB]) {
+      return requested;
+    }
+    return NULL;
+  case GEN_AC:
+    requested = s_run(sm, &gen_states[GEN_AC], e);
+    if (requested && requested != &gen_states[GEN_AC]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_A], e);
+    if (requested && requested != &gen_states[GEN_AC]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_ROOT], e);
+    if (requested && requested != &gen_states[GEN_AC]) {
+      return requested;
+    }
+    return NULL;
+  case GEN_A_CHOICE:
+    requested = s_run(sm, &gen_states[GEN_A], e);
+    if (requested && requested != &gen_states[GEN_A_CHOICE]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_ROOT], e);
+    if (requested && requested != &gen_states[GEN_A_CHOICE]) {
+      return requested;
+    }
+    return NULL;
+  case GEN_BA:
+    requested = s_run(sm, &gen_states[GEN_BA], e);
+    if (requested && requested != &gen_states[GEN_BA]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_B], e);
+    if (requested && requested != &gen_states[GEN_BA]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_ROOT], e);
+    if (requested && requested != &gen_states[GEN_BA]) {
+      return requested;
+    }
+    return NULL;
+  case GEN_BB:
+    requested = s_run(sm, &gen_states[GEN_BB], e);
+    if (requested && requested != &gen_states[GEN_BB]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_B], e);
+    if (requested && requested != &gen_states[GEN_BB]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_ROOT], e);
+    if (requested && requested != &gen_states[GEN_BB]) {
+      return requested;
+    }
+    return NULL;
+  case GEN_BC:
+    requested = s_run(sm, &gen_states[GEN_BC], e);
+    if (requested && requested != &gen_states[GEN_BC]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_B], e);
+    if (requested && requested != &gen_states[GEN_BC]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_ROOT], e);
+    if (requested && requested != &gen_states[GEN_BC]) {
+      return requested;
+    }
+    return NULL;
+  case GEN_C:
+    requested = s_run(sm, &gen_states[GEN_C], e);
+    if (requested && requested != &gen_states[GEN_C]) {
+      return requested;
+    }
+    requested = s_run(sm, &gen_states[GEN_ROOT], e);
+    if (requested && requested != &gen_states[GEN_C]) {
+      return requested;
+    }
+    return NULL;
+  default:
+    return NULL;
+  }
+}
+
+State const *gen_run_event(Machine *sm, Event const *event) {
+  static Event const no_event = {.type = SC_NO_EVENT};
+  Event const *trigger = event;
+
+  // Like sc_run(): Transitions, else run functions, until neither changes the state
+  for (;;) {
+    if (!take_transition(sm, trigger)) {
+      State const *requested = run_functions(sm, event);
+      if (!requested) {
+        break;
+      }
+      sc_execute_dynamic_(sm, NULL, requested, trigger);
+    }
+    trigger = &no_event;
+  }
+
+  return &gen_states[sm->_leaf];
+}
+
+State const *gen_run(Machine *sm, EventType event) {
+  return gen_run_event(sm, &(Event const){.type = event});
+}
@@ -0,0 +1,71 @@
+/**
+ * \brief Statechart generated by hsm4c_gen from test_hsm4c_statechart.puml. Do not edit.
+ * \file
+ */
+
+#pragma once
+
+#include "hsm4c.h"
+
+/** \brief States, index into gen_states */
+enum gen_state {
+  GEN_ROOT,
+  GEN_A,
+  GEN_AA,
+  GEN_AAA,
+  GEN_AAB,
+  GEN_AB,
+  GEN_AC,
+  GEN_A_H,
+  GEN_A_DH,
+  GEN_A_CHOICE,
+  GEN_B,
+  GEN_BA,
+  GEN_BB,
+  GEN_BC,
+  GEN_B_H,
+  GEN_C,
+  GEN_NUM_STATES
+};
+
+/** \brief Events */
+enum gen_event {
+  GEN_EV_1 = 1,
+  GEN_EV_2,
+  GEN_EV_3,
+  GEN_EV_4,
+  GEN_EV_5,
+  GEN_EV_6,
+  GEN_EV_7,
+  GEN_EV_8,
+  GEN_EV_9,
+  GEN_EV_10,
+  GEN_EV_11,
+  GEN_EV_12,
+  GEN_NUM_EVENTS
+};
+
+/** \brief StateId slots each machine needs, see sc_machine_init() */
+#define GEN_MACHINE_SLOTS 7
+
+/** \brief All states of the chart */
+extern State const gen_states[GEN_NUM_STATES];
+
+/** \brief Compiled chart, ready for sc_machine_init() */
+extern Chart const gen_chart;
+
+/** \brief sc_run_event() as switch statements, for machines of gen_chart */
+State const *gen_run_event(Machine *sm, Event const *event);
+
+/** \brief sc_run() as switch statements, for machines of gen_chart */
+State const *gen_run(Machine *sm, EventType event);
+
+/* -------- Functions implemented by the user -------- */
+
+void s_entry(Machine *sm, State const *s);
+void s_exit(Machine *sm, State const *s);
+State const *s_run(Machine *sm, State const *s, Event const *e);
+void t_action(Machine *sm, Event const *e);
+bool t_guard(Machine const *sm, Event const *e);
+bool t_choice_A(Machine const *sm, Event const *e);
+bool t_choice_B(Machine const *sm, Event const *e);
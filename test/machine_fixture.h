@@ -0,0 +1,38 @@
+/**
+ * \brief Chart and machine shared by the feature tests
+ * \file
+ *
+ * Every test file gets its own copy: `states` to refer to in its state configs, the compiled
+ * `chart` and the machine `sm` running it.
+ */
+
+#pragma once
+
+#include "unity.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../lib/hsm4c.h"
+
+#define ARRAY_LEN(a) (sizeof(a) / sizeof(*a))
+
+static State states[16];
+static Chart chart;
+static uint64_t chart_mem[64];
+static Machine sm;
+static StateId sm_slots[16];
+
+/**
+ * \brief Compiles the chart and initializes the machine
+ *
+ * Attach queues, deferral or coalescing storage afterwards, then call `sc_init()`.
+ */
+static void fixture_init(size_t num_states, StateConfig const statecfgs[]) {
+  TEST_ASSERT_LESS_OR_EQUAL(ARRAY_LEN(states), num_states);
+  sc_map_stateconfig_to_states(num_states, states, statecfgs);
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(chart_mem),
+                            sc_compile(&chart, num_states, states, chart_mem, sizeof(chart_mem)));
+  TEST_ASSERT_LESS_OR_EQUAL(ARRAY_LEN(sm_slots), chart.machine_slots);
+  sc_machine_init(&sm, &chart, sm_slots, NULL);
+}
@@ -2,9 +2,9 @@
 
 #include "../lib/hsm4c.h"
 
-void s_entry(State const *s);
-void s_exit(State const *s);
-State *s_run(State const *s, EventType event);
+void s_entry(Machine *sm, State const *s);
+void s_exit(Machine *sm, State const *s);
+State const *s_run(Machine *sm, State const *s, Event const *event);
 
-bool t_guard(State const *s);
-void t_action(State const *s);
+bool t_guard(Machine const *sm, Event const *event);
+void t_action(Machine *sm, Event const *event);
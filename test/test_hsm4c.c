@@ -12,6 +12,9 @@
 
 #define ARRAY_LEN(a) (sizeof(a) / sizeof(*a))
 
+/** \brief Event without payload, as passed by sc_run() */
+#define EVENT(e) (&(Event const){.type = (e)})
+
 /* -------- TEST FIXTURE -------- */
 
 static bool t_choice_A_return = false;
@@ -29,18 +32,18 @@ static void reset_choice_B(void) {
   t_choice_B_called = 0;
 }
 
-void reset_all_states(size_t num_states, State states[num_states]) {
+void reset_all_states(Machine *sm, size_t num_states, State states[num_states]) {
   for (size_t i = 0; i < num_states; ++i) {
-    sc_reset_state(&states[i]);
+    sc_reset_state(sm, &states[i]);
   }
 }
 
-static bool t_choice_A(State const *s) {
+static bool t_choice_A(Machine const *sm, Event const *e) {
   t_choice_A_called++;
   return t_choice_A_return;
 }
 
-static bool t_choice_B(State const *s) {
+static bool t_choice_B(Machine const *sm, Event const *e) {
   t_choice_B_called++;
   return t_choice_B_return;
 }
@@ -98,6 +101,10 @@ enum events {
 };
 
 State states[_NUM_STATES] = {};
+static Chart chart;
+static uint64_t chart_mem[256];
+static Machine sm;
+static StateId sm_slots[_NUM_STATES];
 
 /* Use for root transition test. Comment all state transition table assignments in the state table then. */
 // static Transition const transitions_root[] = {
@@ -303,9 +310,12 @@ static StateConfig const statecfgs[_NUM_STATES] = {
 
 void setUp(void) {
   sc_map_stateconfig_to_states(_NUM_STATES, states, statecfgs);
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(chart_mem),
+                            sc_compile(&chart, _NUM_STATES, states, chart_mem, sizeof(chart_mem)));
   reset_choice_A();
   reset_choice_B();
-  reset_all_states(ARRAY_LEN(states), states);
+  sc_machine_init(&sm, &chart, sm_slots, NULL);
+  reset_all_states(&sm, ARRAY_LEN(states), states);
 }
 
 void tearDown(void) {}
@@ -313,269 +323,293 @@ void tearDown(void) {}
 /* -------- TESTS -------- */
 
 void test_initial(void) {
-  s_entry_Expect(&states[ROOT]);
-  s_entry_Expect(&states[A]);
-  s_entry_Expect(&states[AA]);
-  s_entry_Expect(&states[AAA]);
+  s_entry_Expect(&sm, &states[ROOT]);
+  s_entry_Expect(&sm, &states[A]);
+  s_entry_Expect(&sm, &states[AA]);
+  s_entry_Expect(&sm, &states[AAA]);
 
-  sc_init(&states[ROOT]);
+  sc_init(&sm);
 
   // Double init to check if it resets accordingly
-  s_entry_Expect(&states[ROOT]);
-  s_entry_Expect(&states[A]);
-  s_entry_Expect(&states[AA]);
-  s_entry_Expect(&states[AAA]);
+  s_entry_Expect(&sm, &states[ROOT]);
+  s_entry_Expect(&sm, &states[A]);
+  s_entry_Expect(&sm, &states[AA]);
+  s_entry_Expect(&sm, &states[AAA]);
 
-  sc_init(&states[ROOT]);
+  sc_init(&sm);
 }
 
 void test_sc_A_to_B(void) {
-  s_entry_Expect(&states[ROOT]);
-  s_entry_Expect(&states[A]);
-  s_entry_Expect(&states[AA]);
-  s_entry_Expect(&states[AAA]);
-
-  sc_init(&states[ROOT]);
-
-  t_guard_ExpectAndReturn(&states[ROOT], true);
-  s_exit_Expect(&states[AAA]);
-  s_exit_Expect(&states[AA]);
-  s_exit_Expect(&states[A]);
-  t_action_Expect(&states[ROOT]);
-  s_entry_Expect(&states[B]);
-  s_entry_Expect(&states[BA]);
-  s_run_ExpectAndReturn(&states[BA], EV_1, NULL);
-  s_run_ExpectAndReturn(&states[B], EV_1, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_1, NULL);
-
-  sc_run(&states[ROOT], EV_1);
+  s_entry_Expect(&sm, &states[ROOT]);
+  s_entry_Expect(&sm, &states[A]);
+  s_entry_Expect(&sm, &states[AA]);
+  s_entry_Expect(&sm, &states[AAA]);
+
+  sc_init(&sm);
+
+  t_guard_ExpectAndReturn(&sm, EVENT(EV_1), true);
+  s_exit_Expect(&sm, &states[AAA]);
+  s_exit_Expect(&sm, &states[AA]);
+  s_exit_Expect(&sm, &states[A]);
+  t_action_Expect(&sm, EVENT(EV_1));
+  s_entry_Expect(&sm, &states[B]);
+  s_entry_Expect(&sm, &states[BA]);
+  s_run_ExpectAndReturn(&sm, &states[BA], EVENT(EV_1), NULL);
+  s_run_ExpectAndReturn(&sm, &states[B], EVENT(EV_1), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_1), NULL);
+
+  sc_run(&sm, EV_1);
 }
 
 void test_sc_B_to_A(void) {
   ignore_state_and_transition_fn();
 
-  sc_init(&states[ROOT]);
-  sc_run(&states[ROOT], EV_1);
+  sc_init(&sm);
+  sc_run(&sm, EV_1);
 
   stop_ignore_state_and_transition_fn();
 
-  t_guard_ExpectAndReturn(&states[ROOT], true);
-  s_exit_Expect(&states[BA]);
-  s_exit_Expect(&states[B]);
-  t_action_Expect(&states[ROOT]);
-  s_entry_Expect(&states[A]);
-  s_entry_Expect(&states[AA]);
-  s_entry_Expect(&states[AAA]);
-  s_run_ExpectAndReturn(&states[AAA], EV_1, NULL);
-  s_run_ExpectAndReturn(&states[AA], EV_1, NULL);
-  s_run_ExpectAndReturn(&states[A], EV_1, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_1, NULL);
-
-  sc_run(&states[ROOT], EV_1);
+  t_guard_ExpectAndReturn(&sm, EVENT(EV_1), true);
+  s_exit_Expect(&sm, &states[BA]);
+  s_exit_Expect(&sm, &states[B]);
+  t_action_Expect(&sm, EVENT(EV_1));
+  s_entry_Expect(&sm, &states[A]);
+  s_entry_Expect(&sm, &states[AA]);
+  s_entry_Expect(&sm, &states[AAA]);
+  s_run_ExpectAndReturn(&sm, &states[AAA], EVENT(EV_1), NULL);
+  s_run_ExpectAndReturn(&sm, &states[AA], EVENT(EV_1), NULL);
+  s_run_ExpectAndReturn(&sm, &states[A], EVENT(EV_1), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_1), NULL);
+
+  sc_run(&sm, EV_1);
 }
 
 void test_sc_A_to_BB(void) {
   ignore_state_and_transition_fn();
 
-  sc_init(&states[ROOT]);
-  sc_run(&states[ROOT], EV_1);
-  sc_run(&states[ROOT], EV_1);
+  sc_init(&sm);
+  sc_run(&sm, EV_1);
+  sc_run(&sm, EV_1);
 
   stop_ignore_state_and_transition_fn();
 
-  t_guard_ExpectAndReturn(&states[ROOT], true);
-  s_exit_Expect(&states[AAA]);
-  s_exit_Expect(&states[AA]);
-  s_exit_Expect(&states[A]);
-  t_action_Expect(&states[ROOT]);
-  s_entry_Expect(&states[B]);
-  s_entry_Expect(&states[BB]);
-  s_run_ExpectAndReturn(&states[BB], EV_2, NULL);
-  s_run_ExpectAndReturn(&states[B], EV_2, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_2, NULL);
-
-  sc_run(&states[ROOT], EV_2);
+  t_guard_ExpectAndReturn(&sm, EVENT(EV_2), true);
+  s_exit_Expect(&sm, &states[AAA]);
+  s_exit_Expect(&sm, &states[AA]);
+  s_exit_Expect(&sm, &states[A]);
+  t_action_Expect(&sm, EVENT(EV_2));
+  s_entry_Expect(&sm, &states[B]);
+  s_entry_Expect(&sm, &states[BB]);
+  s_run_ExpectAndReturn(&sm, &states[BB], EVENT(EV_2), NULL);
+  s_run_ExpectAndReturn(&sm, &states[B], EVENT(EV_2), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_2), NULL);
+
+  sc_run(&sm, EV_2);
 }
 
 void test_sc_AA_to_AB(void) {
   ignore_state_and_transition_fn();
 
-  sc_init(&states[ROOT]);
+  sc_init(&sm);
 
   stop_ignore_state_and_transition_fn();
 
-  t_guard_ExpectAndReturn(&states[ROOT], true);
-  s_exit_Expect(&states[AAA]);
-  s_exit_Expect(&states[AA]);
-  t_action_Expect(&states[ROOT]);
-  s_entry_Expect(&states[AB]);
-  s_run_ExpectAndReturn(&states[AB], EV_3, NULL);
-  s_run_ExpectAndReturn(&states[A], EV_3, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_3, NULL);
+  t_guard_ExpectAndReturn(&sm, EVENT(EV_3), true);
+  s_exit_Expect(&sm, &states[AAA]);
+  s_exit_Expect(&sm, &states[AA]);
+  t_action_Expect(&sm, EVENT(EV_3));
+  s_entry_Expect(&sm, &states[AB]);
+  s_run_ExpectAndReturn(&sm, &states[AB], EVENT(EV_3), NULL);
+  s_run_ExpectAndReturn(&sm, &states[A], EVENT(EV_3), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_3), NULL);
 
-  sc_run(&states[ROOT], EV_3);
+  sc_run(&sm, EV_3);
 }
 
 void test_sc_AA_to_AB_to_B_to_A_History(void) {
   ignore_state_and_transition_fn();
 
-  sc_init(&states[ROOT]);
-  sc_run(&states[ROOT], EV_3);
+  sc_init(&sm);
+  sc_run(&sm, EV_3);
   stop_ignore_state_and_transition_fn();
 
   // Now in A->AB
 
-  t_guard_ExpectAndReturn(&states[ROOT], true);
-  s_exit_Expect(&states[AB]);
-  s_exit_Expect(&states[A]);
-  t_action_Expect(&states[ROOT]);
-  s_entry_Expect(&states[B]);
-  s_entry_Expect(&states[BA]);
-  s_run_ExpectAndReturn(&states[BA], EV_3, NULL);
-  s_run_ExpectAndReturn(&states[B], EV_3, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_3, NULL);
+  t_guard_ExpectAndReturn(&sm, EVENT(EV_3), true);
+  s_exit_Expect(&sm, &states[AB]);
+  s_exit_Expect(&sm, &states[A]);
+  t_action_Expect(&sm, EVENT(EV_3));
+  s_entry_Expect(&sm, &states[B]);
+  s_entry_Expect(&sm, &states[BA]);
+  s_run_ExpectAndReturn(&sm, &states[BA], EVENT(EV_3), NULL);
+  s_run_ExpectAndReturn(&sm, &states[B], EVENT(EV_3), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_3), NULL);
 
-  sc_run(&states[ROOT], EV_3);
+  sc_run(&sm, EV_3);
 
   // Now in B with A->AB History. We expect to land back in AB
 
-  t_guard_ExpectAndReturn(&states[ROOT], true);
-  s_exit_Expect(&states[BA]);
-  s_exit_Expect(&states[B]);
-  t_action_Expect(&states[ROOT]);
-  s_entry_Expect(&states[A]);
-  s_entry_Expect(&states[AB]);
-  s_run_ExpectAndReturn(&states[AB], EV_3, NULL);
-  s_run_ExpectAndReturn(&states[A], EV_3, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_3, NULL);
-
-  sc_run(&states[ROOT], EV_3);
+  t_guard_ExpectAndReturn(&sm, EVENT(EV_3), true);
+  s_exit_Expect(&sm, &states[BA]);
+  s_exit_Expect(&sm, &states[B]);
+  t_action_Expect(&sm, EVENT(EV_3));
+  s_entry_Expect(&sm, &states[A]);
+  s_entry_Expect(&sm, &states[AB]);
+  s_run_ExpectAndReturn(&sm, &states[AB], EVENT(EV_3), NULL);
+  s_run_ExpectAndReturn(&sm, &states[A], EVENT(EV_3), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_3), NULL);
+
+  sc_run(&sm, EV_3);
 }
 
 void test_sc_AAA_to_AAB(void) {
   ignore_state_and_transition_fn();
 
-  sc_init(&states[ROOT]);
+  sc_init(&sm);
   stop_ignore_state_and_transition_fn();
 
-  t_guard_ExpectAndReturn(&states[ROOT], true);
-  s_exit_Expect(&states[AAA]);
-  t_action_Expect(&states[ROOT]);
-  s_entry_Expect(&states[AAB]);
-  s_run_ExpectAndReturn(&states[AAB], EV_4, NULL);
-  s_run_ExpectAndReturn(&states[AA], EV_4, NULL);
-  s_run_ExpectAndReturn(&states[A], EV_4, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_4, NULL);
+  t_guard_ExpectAndReturn(&sm, EVENT(EV_4), true);
+  s_exit_Expect(&sm, &states[AAA]);
+  t_action_Expect(&sm, EVENT(EV_4));
+  s_entry_Expect(&sm, &states[AAB]);
+  s_run_ExpectAndReturn(&sm, &states[AAB], EVENT(EV_4), NULL);
+  s_run_ExpectAndReturn(&sm, &states[AA], EVENT(EV_4), NULL);
+  s_run_ExpectAndReturn(&sm, &states[A], EVENT(EV_4), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_4), NULL);
 
-  sc_run(&states[ROOT], EV_4);
+  sc_run(&sm, EV_4);
 }
 
 void test_sc_AAA_to_AAB_to_B_to_A_History(void) {
   ignore_state_and_transition_fn();
 
-  sc_init(&states[ROOT]);
-  sc_run(&states[ROOT], EV_4);
+  sc_init(&sm);
+  sc_run(&sm, EV_4);
   // Now in AAB
-  sc_run(&states[ROOT], EV_4);
+  sc_run(&sm, EV_4);
   // Now in B with A->AA->AAB History. Expecting AAA
 
   stop_ignore_state_and_transition_fn();
 
-  t_guard_ExpectAndReturn(&states[ROOT], true);
-  s_exit_Expect(&states[BA]);
-  s_exit_Expect(&states[B]);
-  t_action_Expect(&states[ROOT]);
-  s_entry_Expect(&states[A]);
-  s_entry_Expect(&states[AA]);
-  s_entry_Expect(&states[AAA]);
-  s_run_ExpectAndReturn(&states[AAA], EV_4, NULL);
-  s_run_ExpectAndReturn(&states[AA], EV_4, NULL);
-  s_run_ExpectAndReturn(&states[A], EV_4, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_4, NULL);
-
-  sc_run(&states[ROOT], EV_4);
+  t_guard_ExpectAndReturn(&sm, EVENT(EV_4), true);
+  s_exit_Expect(&sm, &states[BA]);
+  s_exit_Expect(&sm, &states[B]);
+  t_action_Expect(&sm, EVENT(EV_4));
+  s_entry_Expect(&sm, &states[A]);
+  s_entry_Expect(&sm, &states[AA]);
+  s_entry_Expect(&sm, &states[AAA]);
+  s_run_ExpectAndReturn(&sm, &states[AAA], EVENT(EV_4), NULL);
+  s_run_ExpectAndReturn(&sm, &states[AA], EVENT(EV_4), NULL);
+  s_run_ExpectAndReturn(&sm, &states[A], EVENT(EV_4), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_4), NULL);
+
+  sc_run(&sm, EV_4);
 }
 
 void test_sc_AAA_to_AAB_to_B_to_A_DeepHistory(void) {
   ignore_state_and_transition_fn();
 
-  sc_init(&states[ROOT]);
-  sc_run(&states[ROOT], EV_4);
+  sc_init(&sm);
+  sc_run(&sm, EV_4);
   // Now in AAB
-  sc_run(&states[ROOT], EV_4);
+  sc_run(&sm, EV_4);
   // Now in B with A->AA->AAB Deep History. Expecting AAA.
 
   stop_ignore_state_and_transition_fn();
 
-  t_guard_ExpectAndReturn(&states[ROOT], true);
-  s_exit_Expect(&states[BA]);
-  s_exit_Expect(&states[B]);
-  t_action_Expect(&states[ROOT]);
-  s_entry_Expect(&states[A]);
-  s_entry_Expect(&states[AA]);
-  s_entry_Expect(&states[AAB]);
-  s_run_ExpectAndReturn(&states[AAB], EV_5, NULL);
-  s_run_ExpectAndReturn(&states[AA], EV_5, NULL);
-  s_run_ExpectAndReturn(&states[A], EV_5, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_5, NULL);
-
-  sc_run(&states[ROOT], EV_5);
+  t_guard_ExpectAndReturn(&sm, EVENT(EV_5), true);
+  s_exit_Expect(&sm, &states[BA]);
+  s_exit_Expect(&sm, &states[B]);
+  t_action_Expect(&sm, EVENT(EV_5));
+  s_entry_Expect(&sm, &states[A]);
+  s_entry_Expect(&sm, &states[AA]);
+  s_entry_Expect(&sm, &states[AAB]);
+  s_run_ExpectAndReturn(&sm, &states[AAB], EVENT(EV_5), NULL);
+  s_run_ExpectAndReturn(&sm, &states[AA], EVENT(EV_5), NULL);
+  s_run_ExpectAndReturn(&sm, &states[A], EVENT(EV_5), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_5), NULL);
+
+  sc_run(&sm, EV_5);
 }
 
 void test_sc_A_to_C_choice(void) {
   ignore_state_and_transition_fn();
 
-  sc_init(&states[ROOT]);
+  sc_init(&sm);
 
   stop_ignore_state_and_transition_fn();
 
-  t_guard_ExpectAndReturn(&states[ROOT], true);
-  s_exit_Expect(&states[AAA]);
-  s_exit_Expect(&states[AA]);
-  t_action_Expect(&states[ROOT]);
-  s_run_ExpectAndReturn(&states[A], EV_6, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_6, NULL);
+  t_guard_ExpectAndReturn(&sm, EVENT(EV_6), true);
+  s_exit_Expect(&sm, &states[AAA]);
+  s_exit_Expect(&sm, &states[AA]);
+  t_action_Expect(&sm, EVENT(EV_6));
+  s_run_ExpectAndReturn(&sm, &states[A], EVENT(EV_6), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_6), NULL);
 
-  sc_run(&states[ROOT], EV_6);
+  sc_run(&sm, EV_6);
 
   TEST_ASSERT_EQUAL_INT(1, t_choice_A_called);
   TEST_ASSERT_EQUAL_INT(1, t_choice_B_called);
 
   t_choice_B_return = true;
-  // Should go to C next poll with a non matching or SC_NO_EVENT
+  // Events do not test automatic transitions, only the next SC_NO_EVENT poll does
+  s_run_ExpectAndReturn(&sm, &states[A], EVENT(EV_6), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_6), NULL);
+
+  sc_run(&sm, EV_6);
 
-  s_exit_Expect(&states[A]);
-  t_action_Expect(&states[ROOT]);
-  s_entry_Expect(&states[C]);
-  s_run_ExpectAndReturn(&states[C], EV_6, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_6, NULL);
+  TEST_ASSERT_EQUAL_INT(1, t_choice_B_called);
+
+  s_exit_Expect(&sm, &states[A]);
+  t_action_Expect(&sm, EVENT(SC_NO_EVENT));
+  s_entry_Expect(&sm, &states[C]);
+  s_run_ExpectAndReturn(&sm, &states[C], EVENT(SC_NO_EVENT), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(SC_NO_EVENT), NULL);
 
-  sc_run(&states[ROOT], EV_6);
+  sc_run(&sm, SC_NO_EVENT);
+}
+
+void test_sc_event_outside_index_skips_choice(void) {
+  ignore_state_and_transition_fn();
+
+  sc_init(&sm);
+  sc_run(&sm, EV_6);
+  TEST_ASSERT_EQUAL_INT(1, t_choice_B_called);
+
+  // Unknown events have no transitions, not even automatic ones
+  t_choice_B_return = true;
+  sc_run(&sm, EV_12 + 1);
+  sc_run(&sm, -2);
+  TEST_ASSERT_EQUAL_INT(1, t_choice_B_called);
+  TEST_ASSERT_EQUAL_PTR(&states[A_CHOICE], &states[sm._leaf]);
+
+  sc_run(&sm, SC_NO_EVENT);
+  TEST_ASSERT_EQUAL_PTR(&states[C], &states[sm._leaf]);
 }
 
 void test_sc_A_to_B_choice_auto(void) {
   ignore_state_and_transition_fn();
 
-  sc_init(&states[ROOT]);
+  sc_init(&sm);
 
   stop_ignore_state_and_transition_fn();
 
-  t_guard_ExpectAndReturn(&states[ROOT], true);
-  s_exit_Expect(&states[AAA]);
-  s_exit_Expect(&states[AA]);
-  t_action_Expect(&states[ROOT]); // Action of AA->A_CHOICE
-  s_exit_Expect(&states[A]);
-  t_action_Expect(&states[ROOT]); // Action of A_CHOICE->B
-  s_entry_Expect(&states[B]);
-  s_entry_Expect(&states[BA]);
-  s_run_ExpectAndReturn(&states[BA], EV_6, NULL);
-  s_run_ExpectAndReturn(&states[B], EV_6, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_6, NULL);
+  t_guard_ExpectAndReturn(&sm, EVENT(EV_6), true);
+  s_exit_Expect(&sm, &states[AAA]);
+  s_exit_Expect(&sm, &states[AA]);
+  t_action_Expect(&sm, EVENT(EV_6)); // Action of AA->A_CHOICE
+  s_exit_Expect(&sm, &states[A]);
+  t_action_Expect(&sm, EVENT(EV_NO_EVENT)); // Action of A_CHOICE->B
+  s_entry_Expect(&sm, &states[B]);
+  s_entry_Expect(&sm, &states[BA]);
+  s_run_ExpectAndReturn(&sm, &states[BA], EVENT(EV_6), NULL);
+  s_run_ExpectAndReturn(&sm, &states[B], EVENT(EV_6), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_6), NULL);
   t_choice_A_return = true;
 
   // Should go to B immediately
 
-  sc_run(&states[ROOT], EV_6);
+  sc_run(&sm, EV_6);
 
   TEST_ASSERT_EQUAL_INT(1, t_choice_A_called);
   TEST_ASSERT_EQUAL_INT(0, t_choice_B_called);
@@ -583,108 +617,350 @@ void test_sc_A_to_B_choice_auto(void) {
 
 void test_sc_A_to_B_History_with_no_history_set(void) {
   ignore_state_and_transition_fn();
-  sc_init(&states[ROOT]);
+  sc_init(&sm);
   stop_ignore_state_and_transition_fn();
 
-  t_guard_ExpectAndReturn(&states[ROOT], true);
-  s_exit_Expect(&states[AAA]);
-  s_exit_Expect(&states[AA]);
-  s_exit_Expect(&states[A]);
-  t_action_Expect(&states[ROOT]);
-  s_entry_Expect(&states[B]);
-  s_entry_Expect(&states[BC]);
-  s_run_ExpectAndReturn(&states[BC], EV_7, NULL);
-  s_run_ExpectAndReturn(&states[B], EV_7, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_7, NULL);
-
-  sc_run(&states[ROOT], EV_7);
+  t_guard_ExpectAndReturn(&sm, EVENT(EV_7), true);
+  s_exit_Expect(&sm, &states[AAA]);
+  s_exit_Expect(&sm, &states[AA]);
+  s_exit_Expect(&sm, &states[A]);
+  t_action_Expect(&sm, EVENT(EV_7));
+  s_entry_Expect(&sm, &states[B]);
+  s_entry_Expect(&sm, &states[BC]);
+  s_run_ExpectAndReturn(&sm, &states[BC], EVENT(EV_7), NULL);
+  s_run_ExpectAndReturn(&sm, &states[B], EVENT(EV_7), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_7), NULL);
+
+  sc_run(&sm, EV_7);
 }
 
 void test_sc_AAA_to_AAA_external(void) {
   ignore_state_and_transition_fn();
-  sc_init(&states[ROOT]);
+  sc_init(&sm);
   stop_ignore_state_and_transition_fn();
 
-  t_guard_ExpectAndReturn(&states[ROOT], true);
-  s_exit_Expect(&states[AAA]);
-  t_action_Expect(&states[ROOT]);
-  s_entry_Expect(&states[AAA]);
-  s_run_ExpectAndReturn(&states[AAA], EV_8, NULL);
-  s_run_ExpectAndReturn(&states[AA], EV_8, NULL);
-  s_run_ExpectAndReturn(&states[A], EV_8, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_8, NULL);
+  t_guard_ExpectAndReturn(&sm, EVENT(EV_8), true);
+  s_exit_Expect(&sm, &states[AAA]);
+  t_action_Expect(&sm, EVENT(EV_8));
+  s_entry_Expect(&sm, &states[AAA]);
+  s_run_ExpectAndReturn(&sm, &states[AAA], EVENT(EV_8), NULL);
+  s_run_ExpectAndReturn(&sm, &states[AA], EVENT(EV_8), NULL);
+  s_run_ExpectAndReturn(&sm, &states[A], EVENT(EV_8), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_8), NULL);
 
-  sc_run(&states[ROOT], EV_8);
+  sc_run(&sm, EV_8);
 }
 
 void test_sc_AA_to_AAB_external(void) {
   ignore_state_and_transition_fn();
-  sc_init(&states[ROOT]);
+  sc_init(&sm);
   stop_ignore_state_and_transition_fn();
 
-  t_guard_ExpectAndReturn(&states[ROOT], true);
-  s_exit_Expect(&states[AAA]);
-  s_exit_Expect(&states[AA]);
-  t_action_Expect(&states[ROOT]);
-  s_entry_Expect(&states[AA]);
-  s_entry_Expect(&states[AAB]);
-  s_run_ExpectAndReturn(&states[AAB], EV_9, NULL);
-  s_run_ExpectAndReturn(&states[AA], EV_9, NULL);
-  s_run_ExpectAndReturn(&states[A], EV_9, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_9, NULL);
-
-  sc_run(&states[ROOT], EV_9);
+  t_guard_ExpectAndReturn(&sm, EVENT(EV_9), true);
+  s_exit_Expect(&sm, &states[AAA]);
+  s_exit_Expect(&sm, &states[AA]);
+  t_action_Expect(&sm, EVENT(EV_9));
+  s_entry_Expect(&sm, &states[AA]);
+  s_entry_Expect(&sm, &states[AAB]);
+  s_run_ExpectAndReturn(&sm, &states[AAB], EVENT(EV_9), NULL);
+  s_run_ExpectAndReturn(&sm, &states[AA], EVENT(EV_9), NULL);
+  s_run_ExpectAndReturn(&sm, &states[A], EVENT(EV_9), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_9), NULL);
+
+  sc_run(&sm, EV_9);
 }
 
 void test_sc_AA_to_AAB_internal(void) {
   ignore_state_and_transition_fn();
-  sc_init(&states[ROOT]);
+  sc_init(&sm);
   stop_ignore_state_and_transition_fn();
 
-  t_guard_ExpectAndReturn(&states[ROOT], true);
-  s_exit_Expect(&states[AAA]);
-  t_action_Expect(&states[ROOT]);
-  s_entry_Expect(&states[AAB]);
-  s_run_ExpectAndReturn(&states[AAB], EV_10, NULL);
-  s_run_ExpectAndReturn(&states[AA], EV_10, NULL);
-  s_run_ExpectAndReturn(&states[A], EV_10, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_10, NULL);
+  t_guard_ExpectAndReturn(&sm, EVENT(EV_10), true);
+  s_exit_Expect(&sm, &states[AAA]);
+  t_action_Expect(&sm, EVENT(EV_10));
+  s_entry_Expect(&sm, &states[AAB]);
+  s_run_ExpectAndReturn(&sm, &states[AAB], EVENT(EV_10), NULL);
+  s_run_ExpectAndReturn(&sm, &states[AA], EVENT(EV_10), NULL);
+  s_run_ExpectAndReturn(&sm, &states[A], EVENT(EV_10), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_10), NULL);
 
-  sc_run(&states[ROOT], EV_10);
+  sc_run(&sm, EV_10);
 }
 
 void test_sc_AAB_to_AA_internal(void) {
   ignore_state_and_transition_fn();
-  sc_init(&states[ROOT]);
-  sc_run(&states[ROOT], EV_10);
+  sc_init(&sm);
+  sc_run(&sm, EV_10);
   stop_ignore_state_and_transition_fn();
 
-  t_guard_ExpectAndReturn(&states[ROOT], true);
-  s_exit_Expect(&states[AAB]);
-  t_action_Expect(&states[ROOT]);
-  s_entry_Expect(&states[AAB]); // Why is this? How should it be?
-  s_run_ExpectAndReturn(&states[AAB], EV_10, NULL);
-  s_run_ExpectAndReturn(&states[AA], EV_10, NULL);
-  s_run_ExpectAndReturn(&states[A], EV_10, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_10, NULL);
+  t_guard_ExpectAndReturn(&sm, EVENT(EV_10), true);
+  s_exit_Expect(&sm, &states[AAB]);
+  t_action_Expect(&sm, EVENT(EV_10));
+  s_entry_Expect(&sm, &states[AAB]); // Why is this? How should it be?
+  s_run_ExpectAndReturn(&sm, &states[AAB], EVENT(EV_10), NULL);
+  s_run_ExpectAndReturn(&sm, &states[AA], EVENT(EV_10), NULL);
+  s_run_ExpectAndReturn(&sm, &states[A], EVENT(EV_10), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_10), NULL);
 
-  sc_run(&states[ROOT], EV_10);
+  sc_run(&sm, EV_10);
   TEST_MESSAGE("TODO. Don't undertand the specs yet");
 }
 
 void test_sc_AAA_to_AAA_internal(void) {
   ignore_state_and_transition_fn();
-  sc_init(&states[ROOT]);
+  sc_init(&sm);
+  stop_ignore_state_and_transition_fn();
+
+  t_guard_ExpectAndReturn(&sm, EVENT(EV_11), true);
+  t_action_Expect(&sm, EVENT(EV_11));
+  s_run_ExpectAndReturn(&sm, &states[AAA], EVENT(EV_11), NULL);
+  s_run_ExpectAndReturn(&sm, &states[AA], EVENT(EV_11), NULL);
+  s_run_ExpectAndReturn(&sm, &states[A], EVENT(EV_11), NULL);
+  s_run_ExpectAndReturn(&sm, &states[ROOT], EVENT(EV_11), NULL);
+
+  sc_run(&sm, EV_11);
+}
+
+void test_machines_share_chart(void) {
+  Machine sm2;
+  StateId sm2_slots[_NUM_STATES];
+  int ctx2;
+
+  ignore_state_and_transition_fn();
+
+  sc_machine_init(&sm2, &chart, sm2_slots, &ctx2);
+  sc_init(&sm);
+  sc_init(&sm2);
+
+  // Leave A->AA->AAB as history in sm, A->AB in sm2
+  TEST_ASSERT_EQUAL_PTR(&states[AAB], sc_run(&sm, EV_4));
+  TEST_ASSERT_EQUAL_PTR(&states[BA], sc_run(&sm, EV_4));
+  TEST_ASSERT_EQUAL_PTR(&states[AAA], sc_run(&sm2, EV_9 + 100));
+  TEST_ASSERT_EQUAL_PTR(&states[AB], sc_run(&sm2, EV_3));
+  TEST_ASSERT_EQUAL_PTR(&states[BA], sc_run(&sm2, EV_3));
+
+  // Deep history differs per machine
+  TEST_ASSERT_EQUAL_PTR(&states[AAB], sc_run(&sm, EV_5));
+  TEST_ASSERT_EQUAL_PTR(&states[AB], sc_run(&sm2, EV_5));
+  TEST_ASSERT_EQUAL_PTR(&ctx2, sm2.ctx);
+
+  stop_ignore_state_and_transition_fn();
+}
+
+void test_run_batch_matches_sc_run(void) {
+  enum { NUM_MACHINES = 4, NUM_EVENTS = 10 };
+  StateId set_leaf[NUM_MACHINES];
+  StateId set_slots[NUM_MACHINES * _NUM_STATES];
+  MachineSet set;
+  Machine single[NUM_MACHINES];
+  StateId single_slots[NUM_MACHINES][_NUM_STATES];
+  uint32_t const machines[NUM_EVENTS] = {0, 1, 2, 3, 1, 0, 2, 2, 3, 1};
+  EventType const events[NUM_EVENTS] = {EV_4, EV_1, EV_3, EV_6, EV_3, EV_4, EV_3, EV_3, EV_1, EV_3};
+  StateId leaves[NUM_EVENTS];
+  uint32_t scratch[SC_BATCH_SCRATCH(NUM_EVENTS)];
+
+  ignore_state_and_transition_fn();
+
+  sc_set_init(&set, &chart, NUM_MACHINES, set_leaf, set_slots, NULL);
+  sc_init_batch(&set);
+  for (size_t i = 0; i < NUM_MACHINES; ++i) {
+    sc_machine_init(&single[i], &chart, single_slots[i], NULL);
+    sc_init(&single[i]);
+  }
+
+  sc_run_batch(&set, machines, events, NUM_EVENTS, leaves, scratch);
+
+  for (size_t k = 0; k < NUM_EVENTS; ++k) {
+    State const *leaf = sc_run(&single[machines[k]], events[k]);
+    TEST_ASSERT_EQUAL_PTR(leaf, &states[leaves[k]]);
+  }
+  for (size_t i = 0; i < NUM_MACHINES; ++i) {
+    TEST_ASSERT_EQUAL_UINT16(single[i]._leaf, set_leaf[i]);
+  }
+
+  stop_ignore_state_and_transition_fn();
+}
+
+static void post_ev_4_once(Machine *sm, Event const *e, int num_calls) {
+  if (num_calls == 0) {
+    TEST_ASSERT_TRUE(sc_post(sm, EV_4));
+    TEST_ASSERT_EQUAL(0, sc_dispatch_all(sm));
+  }
+}
+
+void test_dispatch_all_runs_queue_in_order(void) {
+  Event queue[3];
+
+  ignore_state_and_transition_fn();
+
+  sc_machine_queue(&sm, queue, ARRAY_LEN(queue));
+  sc_init(&sm);
+
+  TEST_ASSERT_TRUE(sc_post(&sm, EV_3));
+  TEST_ASSERT_TRUE(sc_post(&sm, EV_3));
+  TEST_ASSERT_TRUE(sc_post_front(&sm, EV_4));
+  TEST_ASSERT_FALSE(sc_post(&sm, EV_1));
+  TEST_ASSERT_FALSE(sc_post_front(&sm, EV_1));
+
+  // EV_4 first: AAA -> AAB -> AB -> BA
+  TEST_ASSERT_EQUAL(3, sc_dispatch_all(&sm));
+  TEST_ASSERT_EQUAL_PTR(&states[BA], &chart.states[sm._leaf]);
+  TEST_ASSERT_EQUAL(0, sc_dispatch_all(&sm));
+
   stop_ignore_state_and_transition_fn();
+}
+
+void test_post_from_action_runs_after_current_event(void) {
+  Event queue[2];
+
+  ignore_state_and_transition_fn();
+  t_action_StubWithCallback(post_ev_4_once);
+
+  sc_machine_queue(&sm, queue, ARRAY_LEN(queue));
+  sc_init(&sm);
+
+  TEST_ASSERT_TRUE(sc_post(&sm, EV_4));
+  TEST_ASSERT_EQUAL(2, sc_dispatch_all(&sm));
+  TEST_ASSERT_EQUAL_PTR(&states[BA], &chart.states[sm._leaf]);
+
+  stop_ignore_state_and_transition_fn();
+}
+
+void test_event_payload_passed_by_reference(void) {
+  uint32_t const payload = 42;
+  Event const event = {.type = EV_1, .size = sizeof(payload), .data = &payload};
+  Event queue[1];
+
+  ignore_state_and_transition_fn();
+
+  sc_machine_queue(&sm, queue, ARRAY_LEN(queue));
+  sc_init(&sm);
+
+  t_guard_StopIgnore();
+  t_action_StopIgnore();
 
-  t_guard_ExpectAndReturn(&states[ROOT], true);
-  t_action_Expect(&states[ROOT]);
-  s_run_ExpectAndReturn(&states[AAA], EV_11, NULL);
-  s_run_ExpectAndReturn(&states[AA], EV_11, NULL);
-  s_run_ExpectAndReturn(&states[A], EV_11, NULL);
-  s_run_ExpectAndReturn(&states[ROOT], EV_11, NULL);
+  // A -> B
+  t_guard_ExpectAndReturn(&sm, &event, true);
+  t_action_Expect(&sm, &event);
+  TEST_ASSERT_EQUAL_PTR(&states[BA], sc_run_event(&sm, &event));
 
-  sc_run(&states[ROOT], EV_11);
+  // B -> A, payload stays where it is while queued
+  t_guard_ExpectAndReturn(&sm, &event, true);
+  t_action_Expect(&sm, &event);
+  TEST_ASSERT_TRUE(sc_post_event(&sm, &event));
+  TEST_ASSERT_EQUAL(1, sc_dispatch_all(&sm));
+  TEST_ASSERT_EQUAL_PTR(&states[AAA], &chart.states[sm._leaf]);
+
+  stop_ignore_state_and_transition_fn();
+}
+
+void test_is_in_and_active_path(void) {
+  size_t len;
+  StateId const *path;
+
+  ignore_state_and_transition_fn();
+
+  sc_init(&sm);
+  path = sc_active_path(&sm, &len);
+  TEST_ASSERT_EQUAL(4, len);
+  TEST_ASSERT_EQUAL_UINT16(ROOT, path[0]);
+  TEST_ASSERT_EQUAL_UINT16(A, path[1]);
+  TEST_ASSERT_EQUAL_UINT16(AA, path[2]);
+  TEST_ASSERT_EQUAL_UINT16(AAA, path[3]);
+  TEST_ASSERT_TRUE(sc_is_in(&sm, &states[AA]));
+  TEST_ASSERT_FALSE(sc_is_in(&sm, &states[AAB]));
+
+  sc_run(&sm, EV_1);
+  path = sc_active_path(&sm, &len);
+  TEST_ASSERT_EQUAL(3, len);
+  TEST_ASSERT_EQUAL_UINT16(B, path[1]);
+  TEST_ASSERT_EQUAL_UINT16(BA, path[2]);
+  TEST_ASSERT_TRUE(sc_is_in(&sm, &states[ROOT]));
+  TEST_ASSERT_TRUE(sc_is_in(&sm, &states[B]));
+  TEST_ASSERT_FALSE(sc_is_in(&sm, &states[A]));
+  TEST_ASSERT_FALSE(sc_is_in(&sm, &states[AA]));
+
+  stop_ignore_state_and_transition_fn();
+}
+
+void test_post_without_queue_fails(void) { TEST_ASSERT_FALSE(sc_post(&sm, EV_1)); }
+
+void test_snapshot_restore_keeps_history_without_entries(void) {
+  Machine restored;
+  StateId restored_slots[ARRAY_LEN(sm_slots)];
+  unsigned char blob[64];
+  TEST_ASSERT_LESS_OR_EQUAL(ARRAY_LEN(restored_slots), chart.machine_slots);
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(blob), sc_snapshot_size(&chart));
+  ignore_state_and_transition_fn();
+
+  sc_init(&sm);
+  sc_run(&sm, EV_4);
+  sc_run(&sm, EV_4);
+  // Now in B with A->AA->AAB Deep History
+  size_t const size = sc_snapshot(&sm, blob, sizeof(blob));
+  TEST_ASSERT_EQUAL(sc_snapshot_size(&chart), size);
+
+  stop_ignore_state_and_transition_fn();
+
+  // No state functions are called
+  sc_machine_init(&restored, &chart, restored_slots, NULL);
+  TEST_ASSERT_TRUE(sc_restore(&restored, blob, size));
+  TEST_ASSERT_TRUE(sc_is_in(&restored, &states[BA]));
+  TEST_ASSERT_TRUE(sc_is_in(&restored, &states[B]));
+
+  t_guard_ExpectAndReturn(&restored, EVENT(EV_5), true);
+  s_exit_Expect(&restored, &states[BA]);
+  s_exit_Expect(&restored, &states[B]);
+  t_action_Expect(&restored, EVENT(EV_5));
+  s_entry_Expect(&restored, &states[A]);
+  s_entry_Expect(&restored, &states[AA]);
+  s_entry_Expect(&restored, &states[AAB]);
+  s_run_ExpectAndReturn(&restored, &states[AAB], EVENT(EV_5), NULL);
+  s_run_ExpectAndReturn(&restored, &states[AA], EVENT(EV_5), NULL);
+  s_run_ExpectAndReturn(&restored, &states[A], EVENT(EV_5), NULL);
+  s_run_ExpectAndReturn(&restored, &states[ROOT], EVENT(EV_5), NULL);
+
+  sc_run(&restored, EV_5);
+}
+
+void test_restore_rejects_foreign_or_corrupt_snapshot(void) {
+  unsigned char blob[64];
+  ignore_state_and_transition_fn();
+  sc_init(&sm);
+  size_t const size = sc_snapshot(&sm, blob, sizeof(blob));
+
+  TEST_ASSERT_EQUAL(0, sc_snapshot(&sm, blob, size - 1));
+  TEST_ASSERT_FALSE(sc_restore(&sm, blob, size - 1));
+  blob[2] ^= 1; // Number of states
+  TEST_ASSERT_FALSE(sc_restore(&sm, blob, size));
+  blob[2] ^= 1;
+  blob[8] = 0xFF; // Active leaf
+  TEST_ASSERT_FALSE(sc_restore(&sm, blob, size));
+  TEST_ASSERT_EQUAL_PTR(&states[AAA], &states[sm._leaf]);
+}
+
+void test_restore_rejects_inconsistent_snapshot(void) {
+  unsigned char blob[64];
+  ignore_state_and_transition_fn();
+  sc_init(&sm);
+  size_t const size = sc_snapshot(&sm, blob, sizeof(blob));
+  size_t const history = 14 + 2 * (size_t)chart._history_slot[A];
+
+  // In range, but no state the machine can be in
+  StateId const leaves[] = {ROOT, AA, A_H, A_CHOICE};
+  for (size_t i = 0; i < ARRAY_LEN(leaves); ++i) {
+    blob[8] = (unsigned char)leaves[i];
+    TEST_ASSERT_FALSE(sc_restore(&sm, blob, size));
+  }
+  blob[8] = AAA;
+  blob[history] = BA; // Not a child of A
+  TEST_ASSERT_FALSE(sc_restore(&sm, blob, size));
+  blob[history] = A_H;
+  TEST_ASSERT_FALSE(sc_restore(&sm, blob, size));
+  blob[history] = AB;
+  TEST_ASSERT_TRUE(sc_restore(&sm, blob, size));
+  TEST_ASSERT_TRUE(sc_is_in(&sm, &states[AAA]));
+  TEST_ASSERT_TRUE(sc_is_in(&sm, &states[A]));
 }
 
 /*
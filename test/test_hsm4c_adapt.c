@@ -0,0 +1,127 @@
+#include "unity.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../lib/hsm4c.h"
+#include "machine_fixture.h"
+
+/* -------- TEST FIXTURE -------- */
+
+enum states {
+  ROOT,
+  A,
+  _NUM_STATES,
+};
+
+enum events {
+  EV_READ = 1,
+  EV_OTHER,
+};
+
+enum levels {
+  LOW,
+  MID,
+  HIGH,
+};
+
+static uint32_t hits_mem[8];
+
+static enum levels level;
+static int guard_calls;
+static int taken[3];
+
+static bool is_level(enum levels l) {
+  guard_calls++;
+  return level == l;
+}
+
+static bool is_low(Machine const *sm, Event const *e) { return is_level(LOW); }
+static bool is_mid(Machine const *sm, Event const *e) { return is_level(MID); }
+static bool is_high(Machine const *sm, Event const *e) { return is_level(HIGH); }
+static void take(Machine *sm, Event const *e) { taken[level]++; }
+
+static Transition const transitions_a[] = {
+    {&states[A], &states[A], EV_READ, take, is_low, SC_TTYPE_LOCAL, .exclusive_guard = true},
+    {&states[A], &states[A], EV_READ, take, is_mid, SC_TTYPE_LOCAL, .exclusive_guard = true},
+    {&states[A], &states[A], EV_READ, take, is_high, SC_TTYPE_LOCAL, .exclusive_guard = true},
+    // Not declared exclusive: Order is kept
+    {&states[A], &states[A], EV_OTHER, take, is_low, SC_TTYPE_LOCAL, .exclusive_guard = true},
+    {&states[A], &states[A], EV_OTHER, take, is_high, SC_TTYPE_LOCAL},
+    SC_TRANSITIONS_END,
+};
+
+static StateConfig const statecfgs[_NUM_STATES] = {
+    [ROOT] = {.name = "ROOT", .initial = &states[A], .type = SC_TYPE_ROOT},
+    [A] = {.name = "A", .parent = &states[ROOT], .transitions = transitions_a},
+};
+
+static void run_n(EventType event, int n) {
+  for (int i = 0; i < n; ++i) {
+    sc_run(&sm, event);
+  }
+}
+
+void setUp(void) {
+  fixture_init(_NUM_STATES, statecfgs);
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(hits_mem), sc_learn_order(&chart, hits_mem, sizeof(hits_mem)));
+  level = HIGH;
+  guard_calls = 0;
+  taken[LOW] = taken[MID] = taken[HIGH] = 0;
+  sc_init(&sm);
+}
+
+void tearDown(void) {}
+
+/* -------- TESTS -------- */
+
+void test_hot_transition_moves_first(void) {
+  run_n(EV_READ, 10);
+  TEST_ASSERT_EQUAL(30, guard_calls);
+
+  TEST_ASSERT_EQUAL(1, sc_adapt_order(&chart));
+  run_n(EV_READ, 10);
+  TEST_ASSERT_EQUAL(40, guard_calls);
+  TEST_ASSERT_EQUAL(20, taken[HIGH]);
+
+  // Other levels still take their transition
+  level = LOW;
+  sc_run(&sm, EV_READ);
+  TEST_ASSERT_EQUAL(1, taken[LOW]);
+  TEST_ASSERT_EQUAL(0, sc_adapt_order(&chart));
+}
+
+void test_order_of_non_exclusive_candidates_is_kept(void) {
+  run_n(EV_OTHER, 10);
+  TEST_ASSERT_EQUAL(0, sc_adapt_order(&chart));
+  run_n(EV_OTHER, 10);
+  TEST_ASSERT_EQUAL(40, guard_calls);
+  TEST_ASSERT_EQUAL(20, taken[HIGH]);
+}
+
+void test_learned_order_can_be_imported(void) {
+  run_n(EV_READ, 3);
+  sc_adapt_order(&chart);
+  uint16_t order[8];
+  TEST_ASSERT_EQUAL(5, sc_export_order(&chart, order, ARRAY_LEN(order)));
+
+  // Fresh chart, e.g. in a build which does not learn
+  static Chart baked;
+  static uint64_t baked_mem[64];
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(baked_mem),
+                            sc_compile(&baked, _NUM_STATES, states, baked_mem, sizeof(baked_mem)));
+  uint16_t swapped[8];
+  TEST_ASSERT_EQUAL(5, sc_export_order(&baked, swapped, ARRAY_LEN(swapped)));
+  uint16_t const first = swapped[3];
+  swapped[3] = swapped[4];
+  swapped[4] = first;
+  TEST_ASSERT_FALSE(sc_import_order(&baked, swapped, 5));
+  TEST_ASSERT_FALSE(sc_import_order(&baked, order, 4));
+  TEST_ASSERT_TRUE(sc_import_order(&baked, order, 5));
+
+  sc_machine_init(&sm, &baked, sm_slots, NULL);
+  sc_init(&sm);
+  guard_calls = 0;
+  sc_run(&sm, EV_READ);
+  TEST_ASSERT_EQUAL(1, guard_calls);
+}
@@ -0,0 +1,149 @@
+#include "unity.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../lib/hsm4c.h"
+#include "machine_fixture.h"
+
+/* -------- TEST FIXTURE -------- */
+
+enum states {
+  ROOT,
+  A,
+  _NUM_STATES,
+};
+
+enum events {
+  EV_SENSOR = 1,
+  EV_TICK,
+  EV_ALARM,
+  EV_OTHER,
+  _NUM_EVENTS,
+};
+
+static Event queue[4];
+
+static CoalescePolicy const policy[_NUM_EVENTS] = {
+    [EV_SENSOR] = SC_COALESCE_LATEST,
+    [EV_TICK] = SC_COALESCE_COUNT,
+    [EV_ALARM] = SC_COALESCE_DROP,
+};
+static uint16_t queued[_NUM_EVENTS];
+static uint32_t coalesced[_NUM_EVENTS];
+
+/** \brief Processed events: Type and payload, for EV_TICK its count */
+static intptr_t seen[16][2];
+static size_t num_seen;
+/** \brief Payload size of the last processed EV_TICK */
+static uint32_t tick_size;
+
+static void record(Machine *sm, Event const *e) {
+  seen[num_seen][0] = e->type;
+  seen[num_seen][1] = e->type == EV_TICK ? (intptr_t)e->count : (intptr_t)e->data;
+  if (e->type == EV_TICK) {
+    tick_size = e->size;
+  }
+  num_seen++;
+}
+
+static Transition const transitions_a[] = {
+    {&states[A], &states[A], EV_SENSOR, .transition_fn = record, .type = SC_TTYPE_LOCAL},
+    {&states[A], &states[A], EV_TICK, .transition_fn = record, .type = SC_TTYPE_LOCAL},
+    {&states[A], &states[A], EV_ALARM, .transition_fn = record, .type = SC_TTYPE_LOCAL},
+    {&states[A], &states[A], EV_OTHER, .transition_fn = record, .type = SC_TTYPE_LOCAL},
+    SC_TRANSITIONS_END,
+};
+
+static StateConfig const statecfgs[_NUM_STATES] = {
+    [ROOT] = {.name = "ROOT", .initial = &states[A], .type = SC_TYPE_ROOT},
+    [A] = {.name = "A", .parent = &states[ROOT], .transitions = transitions_a},
+};
+
+static bool post(EventType type, intptr_t data) {
+  Event const event = {.type = type, .size = sizeof(data), .data = (void const *)data};
+  return sc_post_event(&sm, &event);
+}
+
+static void assert_seen(size_t k, EventType type, intptr_t value) {
+  TEST_ASSERT_EQUAL(type, seen[k][0]);
+  TEST_ASSERT_EQUAL(value, seen[k][1]);
+}
+
+void setUp(void) {
+  fixture_init(_NUM_STATES, statecfgs);
+  TEST_ASSERT_EQUAL(_NUM_EVENTS, chart.num_events);
+  num_seen = 0;
+  tick_size = 0;
+  sc_machine_queue(&sm, queue, ARRAY_LEN(queue));
+  sc_machine_coalescing(&sm, policy, queued, coalesced);
+  sc_init(&sm);
+}
+
+void tearDown(void) {}
+
+/* -------- TESTS -------- */
+
+void test_policies_merge_queued_events(void) {
+  for (intptr_t i = 1; i <= 100; ++i) {
+    TEST_ASSERT_TRUE(post(EV_SENSOR, i));
+    TEST_ASSERT_TRUE(post(EV_TICK, i));
+    TEST_ASSERT_TRUE(post(EV_ALARM, i));
+  }
+  TEST_ASSERT_TRUE(post(EV_OTHER, 1));
+  TEST_ASSERT_FALSE(post(EV_OTHER, 2));
+
+  // Merged events keep the place of the first one
+  TEST_ASSERT_EQUAL(4, sc_dispatch_all(&sm));
+  assert_seen(0, EV_SENSOR, 100);
+  assert_seen(1, EV_TICK, 100);
+  TEST_ASSERT_EQUAL(sizeof(intptr_t), tick_size);
+  assert_seen(2, EV_ALARM, 1);
+  assert_seen(3, EV_OTHER, 1);
+
+  TEST_ASSERT_EQUAL(99, coalesced[EV_SENSOR]);
+  TEST_ASSERT_EQUAL(99, coalesced[EV_TICK]);
+  TEST_ASSERT_EQUAL(99, coalesced[EV_ALARM]);
+  TEST_ASSERT_EQUAL(0, coalesced[EV_OTHER]);
+}
+
+void test_taken_event_is_not_merged(void) {
+  post(EV_SENSOR, 1);
+  TEST_ASSERT_EQUAL(1, sc_dispatch_all(&sm));
+
+  post(EV_SENSOR, 2);
+  post(EV_SENSOR, 3);
+  post(EV_OTHER, 4);
+  TEST_ASSERT_EQUAL(2, sc_dispatch_all(&sm));
+  assert_seen(1, EV_SENSOR, 3);
+  assert_seen(2, EV_OTHER, 4);
+  TEST_ASSERT_EQUAL(1, coalesced[EV_SENSOR]);
+}
+
+void test_front_post_is_not_merged(void) {
+  post(EV_SENSOR, 1);
+  post(EV_TICK, 1);
+  TEST_ASSERT_TRUE(sc_post_front_event(&sm, &(Event const){.type = EV_SENSOR, .data = (void *)3}));
+  TEST_ASSERT_TRUE(sc_post_front(&sm, EV_TICK));
+  // Later posts merge into the events at the back, also into a full queue
+  TEST_ASSERT_TRUE(post(EV_SENSOR, 4));
+  TEST_ASSERT_TRUE(post(EV_TICK, 1));
+
+  TEST_ASSERT_EQUAL(4, sc_dispatch_all(&sm));
+  assert_seen(0, EV_TICK, 1);
+  assert_seen(1, EV_SENSOR, 3);
+  assert_seen(2, EV_SENSOR, 4);
+  assert_seen(3, EV_TICK, 2);
+  TEST_ASSERT_EQUAL(1, coalesced[EV_SENSOR]);
+  TEST_ASSERT_EQUAL(1, coalesced[EV_TICK]);
+}
+
+void test_attaching_queue_forgets_queued_events(void) {
+  post(EV_TICK, 0);
+  post(EV_TICK, 0);
+  sc_machine_queue(&sm, queue, ARRAY_LEN(queue));
+  post(EV_TICK, 0);
+  TEST_ASSERT_EQUAL(1, sc_dispatch_all(&sm));
+  assert_seen(0, EV_TICK, 1);
+  TEST_ASSERT_EQUAL(1, coalesced[EV_TICK]);
+}
@@ -0,0 +1,213 @@
+#include "unity.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../lib/hsm4c.h"
+#include "machine_fixture.h"
+
+/* -------- TEST FIXTURE -------- */
+
+enum states {
+  ROOT,
+  IDLE,
+  BUSY,
+  WORKING,
+  PAUSED,
+  _NUM_STATES,
+};
+
+enum events {
+  EV_JOB = 1,
+  EV_DONE,
+  EV_CONFIG,
+  EV_PAUSE,
+  _NUM_EVENTS,
+};
+
+static Event deferred[2];
+static Event queue[4];
+static CoalescePolicy const policy[_NUM_EVENTS] = {[EV_CONFIG] = SC_COALESCE_LATEST};
+static uint16_t queued[_NUM_EVENTS];
+static uint32_t coalesced[_NUM_EVENTS];
+
+static intptr_t started[8];
+static size_t num_started;
+static int configs;
+static intptr_t last_config;
+
+static void start_job(Machine *sm, Event const *e) { started[num_started++] = (intptr_t)e->data; }
+static void apply_config(Machine *sm, Event const *e) {
+  configs++;
+  last_config = (intptr_t)e->data;
+}
+
+static int polls;
+
+static State const *poll_work(Machine *sm, State const *s, Event const *e) {
+  polls++;
+  return NULL;
+}
+
+static Transition const transitions_idle[] = {
+    {&states[IDLE], &states[BUSY], EV_JOB, .transition_fn = start_job},
+    SC_TRANSITIONS_END,
+};
+
+static Transition const transitions_busy[] = {
+    {&states[BUSY], &states[IDLE], EV_DONE},
+    SC_TRANSITIONS_END,
+};
+
+static Transition const transitions_working[] = {
+    {&states[WORKING], &states[PAUSED], EV_PAUSE},
+    SC_TRANSITIONS_END,
+};
+
+// Paused work takes new configurations, everything else in BUSY waits for them
+static Transition const transitions_paused[] = {
+    {&states[PAUSED], &states[PAUSED], EV_CONFIG, .transition_fn = apply_config,
+     .type = SC_TTYPE_LOCAL},
+    SC_TRANSITIONS_END,
+};
+
+static EventType const deferred_busy[] = {EV_JOB, EV_CONFIG, SC_NO_EVENT};
+
+static StateConfig const statecfgs[_NUM_STATES] = {
+    [ROOT] = {.name = "ROOT", .initial = &states[IDLE], .type = SC_TYPE_ROOT},
+    [IDLE] = {.name = "IDLE", .parent = &states[ROOT], .transitions = transitions_idle},
+    [BUSY] = {.name = "BUSY",
+              .parent = &states[ROOT],
+              .initial = &states[WORKING],
+              .transitions = transitions_busy,
+              .deferred = deferred_busy},
+    [WORKING] = {.name = "WORKING",
+                 .parent = &states[BUSY],
+                 .transitions = transitions_working,
+                 .run_fn = poll_work,
+                 .run_every = 4},
+    [PAUSED] = {.name = "PAUSED", .parent = &states[BUSY], .transitions = transitions_paused},
+};
+
+static State const *job(intptr_t id) {
+  return sc_run_event(&sm, &(Event const){.type = EV_JOB, .data = (void *)id});
+}
+
+static bool post_config(intptr_t value) {
+  return sc_post_event(&sm, &(Event const){.type = EV_CONFIG, .data = (void *)value});
+}
+
+void setUp(void) {
+  fixture_init(_NUM_STATES, statecfgs);
+  num_started = 0;
+  configs = 0;
+  last_config = 0;
+  polls = 0;
+  sc_machine_deferral(&sm, deferred, ARRAY_LEN(deferred));
+  sc_machine_queue(&sm, queue, ARRAY_LEN(queue));
+  sc_machine_coalescing(&sm, policy, queued, coalesced);
+  sc_init(&sm);
+}
+
+void tearDown(void) {}
+
+/* -------- TESTS -------- */
+
+void test_deferred_events_are_recalled_in_order(void) {
+  TEST_ASSERT_EQUAL_PTR(&states[WORKING], job(1));
+  TEST_ASSERT_EQUAL_PTR(&states[WORKING], job(2));
+  TEST_ASSERT_EQUAL_PTR(&states[WORKING], job(3));
+  TEST_ASSERT_EQUAL(2, sc_deferred_count(&sm));
+
+  // Job 2 starts right away and defers job 3 again, which keeps its place
+  TEST_ASSERT_EQUAL_PTR(&states[WORKING], sc_run(&sm, EV_DONE));
+  TEST_ASSERT_EQUAL(1, sc_deferred_count(&sm));
+  TEST_ASSERT_EQUAL_PTR(&states[WORKING], sc_run(&sm, EV_DONE));
+  TEST_ASSERT_EQUAL(0, sc_deferred_count(&sm));
+  TEST_ASSERT_EQUAL_PTR(&states[IDLE], sc_run(&sm, EV_DONE));
+
+  TEST_ASSERT_EQUAL(3, num_started);
+  TEST_ASSERT_EQUAL(1, started[0]);
+  TEST_ASSERT_EQUAL(2, started[1]);
+  TEST_ASSERT_EQUAL(3, started[2]);
+}
+
+void test_substate_transition_takes_precedence(void) {
+  job(1);
+  sc_run(&sm, EV_CONFIG);
+  job(2);
+  TEST_ASSERT_EQUAL(2, sc_deferred_count(&sm));
+  TEST_ASSERT_EQUAL(0, configs);
+
+  // PAUSED takes the configuration, the job stays deferred
+  TEST_ASSERT_EQUAL_PTR(&states[PAUSED], sc_run(&sm, EV_PAUSE));
+  TEST_ASSERT_EQUAL(1, configs);
+  TEST_ASSERT_EQUAL(1, sc_deferred_count(&sm));
+  sc_run(&sm, EV_CONFIG);
+  TEST_ASSERT_EQUAL(2, configs);
+  TEST_ASSERT_EQUAL(1, sc_deferred_count(&sm));
+}
+
+void test_deferral_needs_storage(void) {
+  job(1);
+  job(2);
+  job(3);
+  job(4);
+  TEST_ASSERT_EQUAL(2, sc_deferred_count(&sm));
+  TEST_ASSERT_EQUAL(1, sc_deferred_dropped(&sm));
+
+  // Restarting drops deferred events
+  sc_init(&sm);
+  TEST_ASSERT_EQUAL(0, sc_deferred_count(&sm));
+
+  // Without storage events are processed as usual, here without effect
+  sc_machine_deferral(&sm, NULL, 0);
+  TEST_ASSERT_EQUAL(0, sc_deferred_dropped(&sm));
+  job(5);
+  job(6);
+  TEST_ASSERT_EQUAL_PTR(&states[IDLE], sc_run(&sm, EV_DONE));
+  TEST_ASSERT_EQUAL(2, num_started);
+  TEST_ASSERT_EQUAL(5, started[1]);
+  TEST_ASSERT_EQUAL(0, sc_deferred_dropped(&sm));
+}
+
+void test_tick_counters_keep_deferred_events(void) {
+  job(1);
+  sc_run(&sm, SC_NO_EVENT);
+  sc_run(&sm, SC_NO_EVENT);
+  job(2);
+  TEST_ASSERT_EQUAL(1, sc_deferred_count(&sm));
+
+  // Ticks count in their own slot, next to the bitmap of waiting events. Job 1 polled once.
+  sc_run(&sm, SC_NO_EVENT);
+  sc_run(&sm, SC_NO_EVENT);
+  TEST_ASSERT_EQUAL(2, polls);
+  TEST_ASSERT_EQUAL(1, sc_deferred_count(&sm));
+  TEST_ASSERT_EQUAL_PTR(&states[WORKING], sc_run(&sm, EV_DONE));
+  TEST_ASSERT_EQUAL(0, sc_deferred_count(&sm));
+  TEST_ASSERT_EQUAL(2, num_started);
+  TEST_ASSERT_EQUAL(2, started[1]);
+}
+
+void test_coalesced_events_are_deferred_once(void) {
+  job(1);
+  for (intptr_t value = 1; value <= 3; ++value) {
+    TEST_ASSERT_TRUE(post_config(value));
+  }
+  TEST_ASSERT_EQUAL(1, sc_dispatch_all(&sm));
+  TEST_ASSERT_EQUAL(1, sc_deferred_count(&sm));
+
+  // The deferred event was taken from the queue, later posts merge into a new one
+  for (intptr_t value = 4; value <= 6; ++value) {
+    TEST_ASSERT_TRUE(post_config(value));
+  }
+  TEST_ASSERT_EQUAL(1, sc_dispatch_all(&sm));
+  TEST_ASSERT_EQUAL(2, sc_deferred_count(&sm));
+  TEST_ASSERT_EQUAL(4, coalesced[EV_CONFIG]);
+
+  // Both are recalled with their latest payloads, in order
+  TEST_ASSERT_EQUAL_PTR(&states[PAUSED], sc_run(&sm, EV_PAUSE));
+  TEST_ASSERT_EQUAL(0, sc_deferred_count(&sm));
+  TEST_ASSERT_EQUAL(2, configs);
+  TEST_ASSERT_EQUAL(6, last_config);
+}
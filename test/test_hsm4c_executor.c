@@ -0,0 +1,185 @@
+#include "unity.h"
+
+#include <pthread.h>
+
+#include "../lib/hsm4c.h"
+#include "../lib/hsm4c_executor.h"
+
+#define ARRAY_LEN(a) (sizeof(a) / sizeof(*a))
+
+/* -------- TEST FIXTURE -------- */
+
+enum { NUM_MACHINES = 64, NUM_WORKERS = 4, NUM_PRODUCERS = 4, EVENTS_PER_PRODUCER = 50000 };
+enum { MAILBOX_CAPACITY = 1024 };
+
+enum states { ROOT, COUNTING, _NUM_STATES };
+
+/** \brief Per machine record of the last sequence seen from every producer. */
+typedef struct Counter {
+  int last[NUM_PRODUCERS];
+  int received;
+  int out_of_order;
+  int bad_payloads;
+} Counter;
+
+/** \brief Events encode producer and sequence. */
+#define EVENT(producer, seq) (1 + (producer) + (seq) * NUM_PRODUCERS)
+
+static State states[_NUM_STATES];
+static Chart chart;
+static uint64_t chart_mem[64];
+static Machine machines[NUM_MACHINES];
+static StateId slots[NUM_MACHINES][4];
+static Counter counters[NUM_MACHINES];
+
+static Executor executor;
+static ExecutorWorker workers[NUM_WORKERS];
+static ExecutorMessage mailboxes[NUM_WORKERS * MAILBOX_CAPACITY];
+
+/** \brief Written by the producers posting with payload, checked by the machines. */
+static int payloads[NUM_PRODUCERS][EVENTS_PER_PRODUCER];
+
+static State const *counting_run(Machine *sm, State const *s, Event const *event) {
+  (void)s;
+  Counter *counter = sm->ctx;
+  EventType const e = event->type;
+  if (e == SC_NO_EVENT) {
+    return NULL;
+  }
+  int const producer = (e - 1) % NUM_PRODUCERS;
+  int const seq = (e - 1) / NUM_PRODUCERS;
+  if (seq <= counter->last[producer]) {
+    counter->out_of_order++;
+  }
+  if (event->data && *(int const *)event->data != e) {
+    counter->bad_payloads++;
+  }
+  counter->last[producer] = seq;
+  counter->received++;
+  return NULL;
+}
+
+static StateConfig const statecfgs[_NUM_STATES] = {
+    [ROOT] =
+        {
+            .name = "ROOT",
+            .initial = &states[COUNTING],
+            .type = SC_TYPE_ROOT,
+        },
+    [COUNTING] =
+        {
+            .name = "COUNTING",
+            .run_fn = counting_run,
+            .parent = &states[ROOT],
+        },
+};
+
+/** \brief Odd producers post with payload. */
+static bool post(int producer, uint32_t machine, int seq) {
+  if (producer % 2 == 0) {
+    return sc_executor_post(&executor, machine, EVENT(producer, seq));
+  }
+  int *const payload = &payloads[producer][seq];
+  *payload = EVENT(producer, seq);
+  Event const event = {.type = EVENT(producer, seq), .size = sizeof(*payload), .data = payload};
+  return sc_executor_post_event(&executor, machine, &event);
+}
+
+static void *producer_main(void *arg) {
+  int const producer = (int)(intptr_t)arg;
+  uint32_t seed = (uint32_t)producer + 1;
+
+  for (int seq = 0; seq < EVENTS_PER_PRODUCER; ++seq) {
+    seed = seed * 1664525u + 1013904223u;
+    uint32_t const machine = (seed >> 16) % NUM_MACHINES;
+    while (!post(producer, machine, seq)) {
+      // Mailbox full, let the workers catch up
+    }
+  }
+  return NULL;
+}
+
+void setUp(void) {
+  sc_map_stateconfig_to_states(_NUM_STATES, states, statecfgs);
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(chart_mem),
+                            sc_compile(&chart, _NUM_STATES, states, chart_mem, sizeof(chart_mem)));
+  TEST_ASSERT_LESS_OR_EQUAL(ARRAY_LEN(slots[0]), chart.machine_slots);
+  for (size_t i = 0; i < NUM_MACHINES; ++i) {
+    counters[i] = (Counter){.last = {-1, -1, -1, -1}};
+    sc_machine_init(&machines[i], &chart, slots[i], &counters[i]);
+    sc_init(&machines[i]);
+  }
+}
+
+void tearDown(void) {}
+
+static ExecutorConfig config(void) {
+  return (ExecutorConfig){
+      .machines = machines,
+      .num_machines = NUM_MACHINES,
+      .workers = workers,
+      .num_workers = NUM_WORKERS,
+      .mailboxes = mailboxes,
+      .mailbox_capacity = MAILBOX_CAPACITY,
+  };
+}
+
+/* -------- TESTS -------- */
+
+void test_executor_rejects_invalid_capacity(void) {
+  ExecutorConfig cfg = config();
+  cfg.mailbox_capacity = 1000;
+  TEST_ASSERT_FALSE(sc_executor_start(&executor, &cfg));
+}
+
+void test_executor_stress_keeps_per_machine_order(void) {
+  ExecutorConfig cfg = config();
+  pthread_t producers[NUM_PRODUCERS];
+  ExecutorStats stats;
+
+  TEST_ASSERT_TRUE(sc_executor_start(&executor, &cfg));
+
+  for (intptr_t p = 0; p < NUM_PRODUCERS; ++p) {
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&producers[p], NULL, producer_main, (void *)p));
+  }
+  for (size_t p = 0; p < NUM_PRODUCERS; ++p) {
+    pthread_join(producers[p], NULL);
+  }
+
+  sc_executor_stop(&executor);
+
+  int received = 0;
+  for (size_t i = 0; i < NUM_MACHINES; ++i) {
+    TEST_ASSERT_EQUAL_INT(0, counters[i].out_of_order);
+    TEST_ASSERT_EQUAL_INT(0, counters[i].bad_payloads);
+    received += counters[i].received;
+  }
+  TEST_ASSERT_EQUAL_INT(NUM_PRODUCERS * EVENTS_PER_PRODUCER, received);
+
+  sc_executor_stats(&executor, UINT32_MAX, &stats);
+  TEST_ASSERT_EQUAL_UINT64(NUM_PRODUCERS * EVENTS_PER_PRODUCER, stats.posted);
+  TEST_ASSERT_EQUAL_UINT64(NUM_PRODUCERS * EVENTS_PER_PRODUCER, stats.processed);
+  TEST_ASSERT_EQUAL_UINT64(0, stats.queue_depth);
+}
+
+void test_executor_rejects_after_stop(void) {
+  ExecutorConfig cfg = config();
+  ExecutorStats stats;
+
+  TEST_ASSERT_TRUE(sc_executor_start(&executor, &cfg));
+  TEST_ASSERT_TRUE(sc_executor_post(&executor, 3, EVENT(0, 0)));
+  sc_executor_stop(&executor);
+
+  TEST_ASSERT_FALSE(sc_executor_post(&executor, 3, EVENT(0, 1)));
+  TEST_ASSERT_FALSE(sc_executor_post(&executor, NUM_MACHINES, EVENT(0, 2)));
+  TEST_ASSERT_EQUAL_INT(1, counters[3].received);
+
+  sc_executor_stats(&executor, UINT32_MAX, &stats);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.processed);
+  TEST_ASSERT_EQUAL_UINT64(2, stats.rejected);
+
+  // Stopping again joins nothing
+  sc_executor_stop(&executor);
+  TEST_ASSERT_FALSE(sc_executor_post(&executor, 3, EVENT(0, 3)));
+  TEST_ASSERT_EQUAL_INT(1, counters[3].received);
+}
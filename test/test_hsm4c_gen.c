@@ -0,0 +1,106 @@
+#include "unity.h"
+
+#include <stdbool.h>
+
+#include "../lib/hsm4c.h"
+#include "hsm4c_statechart.h"
+
+/* -------- TEST FIXTURE -------- */
+
+/* gen/hsm4c_statechart.{h,c} are generated from test_hsm4c_statechart.puml:
+ * hsm4c_gen --prefix=gen --switch test/test_hsm4c_statechart.puml test/gen/hsm4c_statechart
+ * The CMake build regenerates them, ctest fails if this copy is out of date.
+ */
+
+static Chart chart;
+static uint64_t chart_mem[256];
+static Machine sm;
+static StateId sm_slots[GEN_MACHINE_SLOTS];
+
+static bool choice_a;
+static bool choice_b;
+static int entries;
+
+void s_entry(Machine *sm, State const *s) { entries++; }
+void s_exit(Machine *sm, State const *s) {}
+State const *s_run(Machine *sm, State const *s, Event const *e) { return NULL; }
+void t_action(Machine *sm, Event const *e) {}
+bool t_guard(Machine const *sm, Event const *e) { return true; }
+bool t_choice_A(Machine const *sm, Event const *e) { return choice_a; }
+bool t_choice_B(Machine const *sm, Event const *e) { return choice_b; }
+
+void setUp(void) {
+  choice_a = false;
+  choice_b = false;
+  entries = 0;
+  sc_machine_init(&sm, &gen_chart, sm_slots, NULL);
+}
+
+void tearDown(void) {}
+
+/* -------- TESTS -------- */
+
+void test_generated_index_matches_sc_compile(void) {
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(chart_mem), sc_compile(&chart, GEN_NUM_STATES, gen_states,
+                                                          chart_mem, sizeof(chart_mem)));
+  size_t const n = GEN_NUM_STATES;
+  size_t const nt = chart.num_transitions;
+  size_t num_runs = 0;
+  for (size_t w = 0; w < n * chart._event_words; ++w) {
+    for (uint32_t bits = chart._handles[w]; bits; bits &= bits - 1) {
+      ++num_runs;
+    }
+  }
+
+  TEST_ASSERT_EQUAL_PTR(chart.root, gen_chart.root);
+  TEST_ASSERT_EQUAL(nt, gen_chart.num_transitions);
+  TEST_ASSERT_EQUAL(chart.num_events, gen_chart.num_events);
+  TEST_ASSERT_EQUAL(chart.machine_slots, gen_chart.machine_slots);
+  TEST_ASSERT_EQUAL(chart._event_words, gen_chart._event_words);
+  TEST_ASSERT_EQUAL(chart._path_slot, gen_chart._path_slot);
+  TEST_ASSERT_EQUAL(chart._guard_slot, gen_chart._guard_slot);
+  TEST_ASSERT_EQUAL_MEMORY(chart._transitions, gen_chart._transitions,
+                           nt * sizeof(*chart._transitions));
+  TEST_ASSERT_EQUAL_MEMORY(chart._compact_transitions, gen_chart._compact_transitions,
+                           nt * sizeof(*chart._compact_transitions));
+  TEST_ASSERT_EQUAL_MEMORY(chart._compact_states, gen_chart._compact_states,
+                           n * sizeof(*chart._compact_states));
+  TEST_ASSERT_EQUAL(chart._num_functions, gen_chart._num_functions);
+  for (size_t f = 0; f < chart._num_functions; ++f) {
+    TEST_ASSERT_TRUE(chart._functions[f] == gen_chart._functions[f]);
+  }
+  TEST_ASSERT_EQUAL_MEMORY(chart._handles, gen_chart._handles, n * sizeof(*chart._handles));
+  TEST_ASSERT_EQUAL_MEMORY(chart._run_base, gen_chart._run_base, n * sizeof(*chart._run_base));
+  TEST_ASSERT_EQUAL_MEMORY(chart._runs, gen_chart._runs, (num_runs + 1) * sizeof(*chart._runs));
+  TEST_ASSERT_EQUAL_MEMORY(chart._candidates, gen_chart._candidates,
+                           chart._runs[num_runs] * sizeof(*chart._candidates));
+  TEST_ASSERT_EQUAL_MEMORY(chart._parent, gen_chart._parent, n * sizeof(*chart._parent));
+  TEST_ASSERT_EQUAL_MEMORY(chart._branch_runs, gen_chart._branch_runs,
+                           n * sizeof(*chart._branch_runs));
+  TEST_ASSERT_EQUAL_MEMORY(chart._history_slot, gen_chart._history_slot,
+                           n * sizeof(*chart._history_slot));
+  for (size_t t = 0; t < nt; ++t) {
+    struct TransitionPath const *p = &chart._paths[t];
+    struct TransitionPath const *g = &gen_chart._paths[t];
+    TEST_ASSERT_EQUAL(p->dynamic, g->dynamic);
+    if (!p->dynamic) {
+      TEST_ASSERT_EQUAL(p->boundary, g->boundary);
+      TEST_ASSERT_EQUAL(p->leaf, g->leaf);
+      TEST_ASSERT_EQUAL(p->skip, g->skip);
+      TEST_ASSERT_EQUAL_MEMORY(&chart._path_states[p->begin], &gen_chart._path_states[g->begin],
+                               p->len * sizeof(StateId));
+    }
+  }
+}
+
+void test_generated_chart_runs_without_setup(void) {
+  TEST_ASSERT_EQUAL_PTR(&gen_states[GEN_AAA], sc_init(&sm));
+  TEST_ASSERT_EQUAL(4, entries);
+
+  TEST_ASSERT_EQUAL_PTR(&gen_states[GEN_BA], sc_run(&sm, GEN_EV_1));
+  TEST_ASSERT_EQUAL_PTR(&gen_states[GEN_AAA], sc_run(&sm, GEN_EV_3));
+  TEST_ASSERT_TRUE(sc_is_in(&sm, &gen_states[GEN_AA]));
+
+  choice_b = true;
+  TEST_ASSERT_EQUAL_PTR(&gen_states[GEN_C], sc_run(&sm, GEN_EV_6));
+}
@@ -0,0 +1,105 @@
+#include "unity.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "../lib/hsm4c.h"
+#include "hsm4c_statechart.h"
+
+/* -------- TEST FIXTURE -------- */
+
+/* Runs gen_run() (hsm4c_gen --switch) and sc_run() side by side on random event streams. Every
+ * callback is logged per machine, guards and run functions decide from a per-machine random
+ * sequence: Both engines consume it identically only if they call the same functions in the same
+ * order.
+ */
+
+enum { LOG_ENTRY = 1, LOG_EXIT, LOG_RUN, LOG_ACTION, LOG_GUARD };
+
+typedef struct Log {
+  uint32_t rng;
+  size_t len;
+  uint16_t entries[512];
+} Log;
+
+static Machine table_sm;
+static Machine switch_sm;
+static StateId table_slots[GEN_MACHINE_SLOTS];
+static StateId switch_slots[GEN_MACHINE_SLOTS];
+static Log table_log;
+static Log switch_log;
+
+static uint32_t next_random(uint32_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+static uint32_t log_call(Machine const *sm, int kind, StateId id) {
+  Log *const log = sm->ctx;
+  TEST_ASSERT_LESS_THAN(sizeof(log->entries) / sizeof(*log->entries), log->len);
+  log->entries[log->len++] = (uint16_t)(kind << 8 | id);
+  return next_random(&log->rng);
+}
+
+void s_entry(Machine *sm, State const *s) { log_call(sm, LOG_ENTRY, (StateId)(s - gen_states)); }
+void s_exit(Machine *sm, State const *s) { log_call(sm, LOG_EXIT, (StateId)(s - gen_states)); }
+void t_action(Machine *sm, Event const *e) { log_call(sm, LOG_ACTION, (StateId)e->type); }
+bool t_guard(Machine const *sm, Event const *e) { return log_call(sm, LOG_GUARD, 0) % 4; }
+bool t_choice_A(Machine const *sm, Event const *e) { return log_call(sm, LOG_GUARD, 1) % 2; }
+bool t_choice_B(Machine const *sm, Event const *e) { return log_call(sm, LOG_GUARD, 2) % 2; }
+
+State const *s_run(Machine *sm, State const *s, Event const *e) {
+  static StateId const targets[] = {GEN_A, GEN_AAB, GEN_A_H, GEN_A_DH, GEN_B_H, GEN_C};
+  uint32_t const r = log_call(sm, LOG_RUN, (StateId)(s - gen_states));
+  return r % 16 ? NULL : &gen_states[targets[r / 16 % (sizeof(targets) / sizeof(*targets))]];
+}
+
+static void start(uint32_t seed) {
+  table_log = (Log){.rng = seed};
+  switch_log = (Log){.rng = seed};
+  sc_machine_init(&table_sm, &gen_chart, table_slots, &table_log);
+  sc_machine_init(&switch_sm, &gen_chart, switch_slots, &switch_log);
+  sc_init(&table_sm);
+  sc_init(&switch_sm);
+}
+
+static void assert_same(void) {
+  TEST_ASSERT_EQUAL(table_log.len, switch_log.len);
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(table_log.entries, switch_log.entries, table_log.len);
+  TEST_ASSERT_EQUAL(table_log.rng, switch_log.rng);
+  TEST_ASSERT_EQUAL(table_sm._leaf, switch_sm._leaf);
+  TEST_ASSERT_EQUAL_MEMORY(table_slots, switch_slots, sizeof(table_slots));
+  table_log.len = 0;
+  switch_log.len = 0;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+/* -------- TESTS -------- */
+
+void test_switch_engine_takes_the_same_transitions(void) {
+  start(1);
+  TEST_ASSERT_EQUAL_PTR(&gen_states[GEN_BA], gen_run(&switch_sm, GEN_EV_1));
+  TEST_ASSERT_EQUAL_PTR(&gen_states[GEN_BA], sc_run(&table_sm, GEN_EV_1));
+  assert_same();
+  TEST_ASSERT_TRUE(sc_is_in(&switch_sm, &gen_states[GEN_B]));
+}
+
+void test_switch_engine_matches_sc_run_on_random_events(void) {
+  for (uint32_t seed = 1; seed <= 16; ++seed) {
+    uint32_t events = seed * 2654435761u;
+    start(seed);
+    assert_same();
+    for (int i = 0; i < 2000; ++i) {
+      // Includes SC_NO_EVENT and one unknown event
+      EventType const e = (EventType)(next_random(&events) % (GEN_NUM_EVENTS + 1));
+      State const *const expected = sc_run(&table_sm, e);
+      TEST_ASSERT_EQUAL_PTR(expected, gen_run(&switch_sm, e));
+      assert_same();
+    }
+  }
+}
@@ -0,0 +1,129 @@
+#include "unity.h"
+
+#include <stdbool.h>
+
+#include "../lib/hsm4c.h"
+#include "machine_fixture.h"
+
+/* -------- TEST FIXTURE -------- */
+
+enum states {
+  ROOT,
+  A,
+  B,
+  C,
+  D,
+  _NUM_STATES,
+};
+
+enum events {
+  EV_GO = 1,
+  EV_CHECK,
+  EV_OTHER,
+};
+
+enum signals {
+  SIG_CONFIG = 1 << 0,
+  SIG_NETWORK = 1 << 1,
+};
+
+
+static bool config_allows;
+static int config_lookups;
+static int checks;
+
+/** \brief Expensive lookup, does not change while an event runs */
+static bool config_guard(Machine const *sm, Event const *e) {
+  config_lookups++;
+  return config_allows;
+}
+
+static bool network_guard(Machine const *sm, Event const *e) {
+  checks++;
+  return false;
+}
+
+static Transition const transitions_a[] = {
+    {&states[A], &states[B], EV_GO, .guard_fn = config_guard, .pure_guard = true},
+    {&states[A], &states[C], EV_GO, .guard_fn = config_guard, .pure_guard = true},
+    {&states[A], &states[D], EV_CHECK, .guard_fn = network_guard, .guard_signals = SIG_NETWORK},
+    SC_TRANSITIONS_END,
+};
+
+// Completion transition of B asks the same guard again in the same run
+static Transition const transitions_b[] = {
+    {&states[B], &states[C], .guard_fn = config_guard, .pure_guard = true},
+    SC_TRANSITIONS_END,
+};
+
+static StateConfig const statecfgs[_NUM_STATES] = {
+    [ROOT] = {.name = "ROOT", .initial = &states[A], .type = SC_TYPE_ROOT},
+    [A] = {.name = "A", .parent = &states[ROOT], .transitions = transitions_a},
+    [B] = {.name = "B", .parent = &states[ROOT], .transitions = transitions_b},
+    [C] = {.name = "C", .parent = &states[ROOT]},
+    [D] = {.name = "D", .parent = &states[ROOT]},
+};
+
+void setUp(void) {
+  fixture_init(_NUM_STATES, statecfgs);
+  config_allows = false;
+  config_lookups = 0;
+  checks = 0;
+  sc_init(&sm);
+}
+
+void tearDown(void) {}
+
+/* -------- TESTS -------- */
+
+void test_pure_guard_called_once_per_run(void) {
+  TEST_ASSERT_EQUAL_PTR(&states[A], sc_run(&sm, EV_GO));
+  TEST_ASSERT_EQUAL(1, config_lookups);
+
+  // A new run asks again
+  config_allows = true;
+  TEST_ASSERT_EQUAL_PTR(&states[C], sc_run(&sm, EV_GO));
+  TEST_ASSERT_EQUAL(2, config_lookups);
+}
+
+void test_signal_guard_kept_until_signal_changes(void) {
+  sc_run(&sm, EV_CHECK);
+  sc_run(&sm, EV_CHECK);
+  TEST_ASSERT_EQUAL(1, checks);
+
+  sc_signal(&sm, SIG_CONFIG);
+  sc_run(&sm, EV_CHECK);
+  TEST_ASSERT_EQUAL(1, checks);
+
+  sc_signal(&sm, SIG_NETWORK | SIG_CONFIG);
+  sc_run(&sm, EV_CHECK);
+  TEST_ASSERT_EQUAL(2, checks);
+  TEST_ASSERT_EQUAL_PTR(&states[A], &states[sm._leaf]);
+}
+
+void test_run_stamp_wraps_without_stale_results(void) {
+  sc_run(&sm, EV_GO);
+  TEST_ASSERT_EQUAL(1, config_lookups);
+  // Once around: Stamps repeat after 0x7FFE runs
+  for (int i = 0; i < 0x7FFE - 1; ++i) {
+    sc_run(&sm, EV_OTHER);
+  }
+  config_allows = true;
+  TEST_ASSERT_EQUAL_PTR(&states[C], sc_run(&sm, EV_GO));
+  TEST_ASSERT_EQUAL(2, config_lookups);
+}
+
+void test_signal_guard_evaluated_again_after_restore(void) {
+  unsigned char blob[64];
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(blob), sc_snapshot_size(&chart));
+  sc_run(&sm, EV_CHECK);
+  TEST_ASSERT_EQUAL(1, checks);
+
+  // The cached result may be stale in the restoring process
+  size_t const size = sc_snapshot(&sm, blob, sizeof(blob));
+  TEST_ASSERT_TRUE(sc_restore(&sm, blob, size));
+  sc_run(&sm, EV_CHECK);
+  TEST_ASSERT_EQUAL(2, checks);
+  sc_run(&sm, EV_CHECK);
+  TEST_ASSERT_EQUAL(2, checks);
+}
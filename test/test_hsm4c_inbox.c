@@ -0,0 +1,160 @@
+#include "unity.h"
+
+#include <pthread.h>
+
+#include "../lib/hsm4c.h"
+#include "../lib/hsm4c_inbox.h"
+#include "machine_fixture.h"
+
+/* -------- TEST FIXTURE -------- */
+
+enum { NUM_PRODUCERS = 4, EVENTS_PER_PRODUCER = 20000, INBOX_CAPACITY = 64 };
+
+enum states { ROOT, COUNTING, _NUM_STATES };
+
+/** \brief Events encode producer and sequence. */
+#define EVENT(producer, seq) (1 + (producer) + (seq) * NUM_PRODUCERS)
+
+static Inbox inbox;
+static InboxSlot inbox_slots[INBOX_CAPACITY];
+
+/** \brief Written by the producers before posting, checked by the machine. */
+static int payloads[NUM_PRODUCERS][EVENTS_PER_PRODUCER];
+static int last[NUM_PRODUCERS];
+static int received;
+static int out_of_order;
+static int bad_payloads;
+
+static State const *counting_run(Machine *sm, State const *s, Event const *event) {
+  EventType const e = event->type;
+  if (e == SC_NO_EVENT) {
+    return NULL;
+  }
+  int const producer = (e - 1) % NUM_PRODUCERS;
+  int const seq = (e - 1) / NUM_PRODUCERS;
+  if (seq <= last[producer]) {
+    out_of_order++;
+  }
+  if (event->data && *(int const *)event->data != e) {
+    bad_payloads++;
+  }
+  last[producer] = seq;
+  received++;
+  return NULL;
+}
+
+static StateConfig const statecfgs[_NUM_STATES] = {
+    [ROOT] = {.name = "ROOT", .initial = &states[COUNTING], .type = SC_TYPE_ROOT},
+    [COUNTING] = {.name = "COUNTING", .run_fn = counting_run, .parent = &states[ROOT]},
+};
+
+static bool post(int producer, int seq) {
+  int *const payload = &payloads[producer][seq];
+  *payload = EVENT(producer, seq);
+  return sc_post_from_isr(&inbox, &(Event const){.type = EVENT(producer, seq), .data = payload});
+}
+
+static void *producer_main(void *arg) {
+  int const producer = (int)(intptr_t)arg;
+  for (int seq = 0; seq < EVENTS_PER_PRODUCER; ++seq) {
+    while (!post(producer, seq)) {
+      // Inbox full, let the owner catch up
+    }
+  }
+  return NULL;
+}
+
+/** \brief Posts every event once, without waiting for the owner. Returns the accepted ones. */
+static void *overflow_main(void *arg) {
+  int const producer = (int)(intptr_t)arg;
+  intptr_t accepted = 0;
+  for (int seq = 0; seq < INBOX_CAPACITY; ++seq) {
+    accepted += post(producer, seq);
+  }
+  return (void *)accepted;
+}
+
+/** \brief Owner thread: Drains while `n` producers post. */
+static void run_producers(int n) {
+  pthread_t producers[NUM_PRODUCERS];
+  for (intptr_t p = 0; p < n; ++p) {
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&producers[p], NULL, producer_main, (void *)p));
+  }
+  while (received < n * EVENTS_PER_PRODUCER) {
+    sc_inbox_drain(&inbox, INBOX_CAPACITY);
+  }
+  for (intptr_t p = 0; p < n; ++p) {
+    pthread_join(producers[p], NULL);
+  }
+}
+
+void setUp(void) {
+  fixture_init(_NUM_STATES, statecfgs);
+  for (size_t p = 0; p < NUM_PRODUCERS; ++p) {
+    last[p] = -1;
+  }
+  received = 0;
+  out_of_order = 0;
+  bad_payloads = 0;
+  sc_init(&sm);
+}
+
+void tearDown(void) {}
+
+/* -------- TESTS -------- */
+
+void test_inbox_is_bounded(void) {
+  TEST_ASSERT_FALSE(sc_inbox_init(&inbox, &sm, inbox_slots, 48, false));
+  TEST_ASSERT_TRUE(sc_inbox_init(&inbox, &sm, inbox_slots, 4, false));
+  for (int seq = 0; seq < 4; ++seq) {
+    TEST_ASSERT_TRUE(post(0, seq));
+  }
+  TEST_ASSERT_FALSE(post(0, 4));
+
+  TEST_ASSERT_EQUAL(2, sc_inbox_drain(&inbox, 2));
+  TEST_ASSERT_TRUE(post(0, 4));
+  TEST_ASSERT_EQUAL(3, sc_inbox_drain(&inbox, 10));
+  TEST_ASSERT_EQUAL(0, sc_inbox_drain(&inbox, 10));
+  TEST_ASSERT_EQUAL(5, received);
+  TEST_ASSERT_EQUAL(0, out_of_order);
+}
+
+void test_single_producer_hands_over_payloads(void) {
+  TEST_ASSERT_TRUE(sc_inbox_init(&inbox, &sm, inbox_slots, INBOX_CAPACITY, false));
+  run_producers(1);
+  TEST_ASSERT_EQUAL(EVENTS_PER_PRODUCER, received);
+  TEST_ASSERT_EQUAL(0, out_of_order);
+  TEST_ASSERT_EQUAL(0, bad_payloads);
+}
+
+void test_multi_producer_keeps_per_producer_order(void) {
+  TEST_ASSERT_TRUE(sc_inbox_init(&inbox, &sm, inbox_slots, INBOX_CAPACITY, true));
+  run_producers(NUM_PRODUCERS);
+  TEST_ASSERT_EQUAL(NUM_PRODUCERS * EVENTS_PER_PRODUCER, received);
+  TEST_ASSERT_EQUAL(0, out_of_order);
+  TEST_ASSERT_EQUAL(0, bad_payloads);
+  TEST_ASSERT_EQUAL(0, sc_inbox_drain(&inbox, INBOX_CAPACITY));
+}
+
+void test_full_inbox_rejects_every_producer(void) {
+  TEST_ASSERT_TRUE(sc_inbox_init(&inbox, &sm, inbox_slots, 8, true));
+  pthread_t producers[NUM_PRODUCERS];
+  for (intptr_t p = 0; p < NUM_PRODUCERS; ++p) {
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&producers[p], NULL, overflow_main, (void *)p));
+  }
+  intptr_t accepted = 0;
+  for (intptr_t p = 0; p < NUM_PRODUCERS; ++p) {
+    void *n;
+    pthread_join(producers[p], &n);
+    accepted += (intptr_t)n;
+  }
+
+  // Nothing is overwritten: Exactly the accepted events are drained, each producer's in order
+  TEST_ASSERT_EQUAL(8, accepted);
+  TEST_ASSERT_EQUAL(8, sc_inbox_drain(&inbox, INBOX_CAPACITY));
+  TEST_ASSERT_EQUAL(8, received);
+  TEST_ASSERT_EQUAL(0, out_of_order);
+  TEST_ASSERT_EQUAL(0, bad_payloads);
+  TEST_ASSERT_TRUE(post(0, INBOX_CAPACITY));
+  TEST_ASSERT_EQUAL(1, sc_inbox_drain(&inbox, INBOX_CAPACITY));
+}
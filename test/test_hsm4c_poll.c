@@ -0,0 +1,135 @@
+#include "unity.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../lib/hsm4c.h"
+#include "../lib/hsm4c_stats.h"
+#include "machine_fixture.h"
+
+/* -------- TEST FIXTURE -------- */
+
+enum states {
+  ROOT,
+  POLLING,
+  WAITING,
+  _NUM_STATES,
+};
+
+enum events {
+  EV_GO = 1,
+  EV_DATA,
+  EV_OTHER,
+  _NUM_EVENTS,
+};
+
+static ChartStats stats;
+static uint64_t stats_mem[512];
+
+/** \brief Run function calls per state and event type */
+static int calls[_NUM_STATES][_NUM_EVENTS];
+
+static State const *poll(Machine *sm, State const *s, Event const *e) {
+  calls[s - states][e->type]++;
+  return NULL;
+}
+
+static Transition const transitions_polling[] = {
+    {&states[POLLING], &states[WAITING], EV_GO},
+    SC_TRANSITIONS_END,
+};
+
+static Transition const transitions_waiting[] = {
+    {&states[WAITING], &states[POLLING], EV_GO},
+    SC_TRANSITIONS_END,
+};
+
+static EventType const data_only[] = {EV_DATA, SC_NO_EVENT};
+static EventType const ticks_only[] = {SC_NO_EVENT};
+
+static StateConfig const statecfgs[_NUM_STATES] = {
+    [ROOT] = {.name = "ROOT",
+              .initial = &states[POLLING],
+              .type = SC_TYPE_ROOT,
+              .run_fn = poll,
+              .run_events = data_only,
+              .run_no_ticks = true},
+    [POLLING] = {.name = "POLLING",
+                 .parent = &states[ROOT],
+                 .transitions = transitions_polling,
+                 .run_fn = poll,
+                 .run_every = 10},
+    [WAITING] = {.name = "WAITING",
+                 .parent = &states[ROOT],
+                 .transitions = transitions_waiting,
+                 .run_fn = poll,
+                 .run_events = ticks_only},
+};
+
+static void tick(int n) {
+  for (int i = 0; i < n; ++i) {
+    sc_run(&sm, SC_NO_EVENT);
+  }
+}
+
+void setUp(void) {
+  fixture_init(_NUM_STATES, statecfgs);
+  for (size_t i = 0; i < _NUM_STATES; ++i) {
+    for (size_t e = 0; e < _NUM_EVENTS; ++e) {
+      calls[i][e] = 0;
+    }
+  }
+  sc_init(&sm);
+}
+
+void tearDown(void) { sc_stats_detach(&chart); }
+
+/* -------- TESTS -------- */
+
+void test_tick_divisor_counts_from_entry(void) {
+  tick(25);
+  TEST_ASSERT_EQUAL(2, calls[POLLING][SC_NO_EVENT]);
+
+  // Leaving and entering again restarts the count
+  sc_run(&sm, EV_GO);
+  sc_run(&sm, EV_GO);
+  tick(9);
+  TEST_ASSERT_EQUAL(2, calls[POLLING][SC_NO_EVENT]);
+  tick(1);
+  TEST_ASSERT_EQUAL(3, calls[POLLING][SC_NO_EVENT]);
+
+  // Events are not thinned out
+  sc_run(&sm, EV_OTHER);
+  TEST_ASSERT_EQUAL(1, calls[POLLING][EV_OTHER]);
+  TEST_ASSERT_EQUAL(0, calls[ROOT][SC_NO_EVENT]);
+}
+
+void test_event_list_selects_calls(void) {
+  TEST_ASSERT_EQUAL_PTR(&states[WAITING], sc_run(&sm, EV_GO));
+  sc_run(&sm, EV_DATA);
+  sc_run(&sm, EV_OTHER);
+  sc_run(&sm, 42);
+  tick(3);
+
+  TEST_ASSERT_EQUAL(3, calls[WAITING][SC_NO_EVENT]);
+  TEST_ASSERT_EQUAL(0, calls[WAITING][EV_DATA] + calls[WAITING][EV_OTHER] + calls[WAITING][EV_GO]);
+  TEST_ASSERT_EQUAL(1, calls[ROOT][EV_DATA]);
+  TEST_ASSERT_EQUAL(0, calls[ROOT][SC_NO_EVENT] + calls[ROOT][EV_OTHER] + calls[ROOT][EV_GO]);
+}
+
+void test_stats_count_executed_and_skipped_runs(void) {
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(stats_mem),
+                            sc_stats_attach(&chart, &stats, stats_mem, sizeof(stats_mem), NULL));
+  sc_init(&sm);
+  tick(30);
+  sc_run(&sm, EV_DATA);
+
+  StateStats root;
+  StateStats polling;
+  sc_stats_state(&chart, &states[ROOT], &root);
+  sc_stats_state(&chart, &states[POLLING], &polling);
+  TEST_ASSERT_EQUAL(3 + 1, polling.runs);
+  TEST_ASSERT_EQUAL(27, polling.run_skips);
+  TEST_ASSERT_EQUAL(1, root.runs);
+  TEST_ASSERT_EQUAL(30, root.run_skips);
+}
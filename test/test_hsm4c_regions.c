@@ -0,0 +1,243 @@
+#include "unity.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../lib/hsm4c.h"
+
+#define ARRAY_LEN(a) (sizeof(a) / sizeof(*a))
+
+/* -------- TEST FIXTURE -------- */
+
+enum states {
+  ROOT,
+  P,
+  R1,
+  R1A,
+  R1B,
+  R2,
+  R2A,
+  R2B,
+  P_DH,
+  Q,
+  _NUM_STATES,
+};
+
+enum events {
+  EV_BOTH = 1,
+  EV_BACK,
+  EV_LEAVE,
+  EV_RESTORE,
+  EV_CONFLICT,
+  EV_INTO,
+};
+
+static State states[_NUM_STATES];
+static Chart chart;
+static uint64_t chart_mem[128];
+static Machine sm;
+static StateId sm_slots[32];
+
+static char trace[512];
+static int root_runs;
+
+static void record(char const *what, State const *s) {
+  size_t const len = strlen(trace);
+  snprintf(&trace[len], sizeof(trace) - len, "%s%s ", what, s->config->name);
+}
+
+static void entry(Machine *sm, State const *s) { record("+", s); }
+static void exit_(Machine *sm, State const *s) { record("-", s); }
+static State const *root_run(Machine *sm, State const *s, Event const *e) {
+  root_runs++;
+  return NULL;
+}
+
+static Transition const transitions_p[] = {
+    {&states[P], &states[Q], EV_LEAVE},
+    {&states[P], &states[Q], EV_CONFLICT},
+    SC_TRANSITIONS_END,
+};
+
+static Transition const transitions_r1a[] = {
+    {&states[R1A], &states[R1B], EV_BOTH},
+    {&states[R1A], &states[R1B], EV_CONFLICT},
+    SC_TRANSITIONS_END,
+};
+
+static Transition const transitions_r1b[] = {
+    {&states[R1B], &states[R1A], EV_BACK},
+    SC_TRANSITIONS_END,
+};
+
+static Transition const transitions_r2a[] = {
+    {&states[R2A], &states[R2B], EV_BOTH},
+    SC_TRANSITIONS_END,
+};
+
+static Transition const transitions_q[] = {
+    {&states[Q], &states[P_DH], EV_RESTORE},
+    {&states[Q], &states[R2B], EV_INTO},
+    SC_TRANSITIONS_END,
+};
+
+static StateConfig const statecfgs[_NUM_STATES] = {
+    [ROOT] =
+        {
+            .name = "ROOT",
+            .run_fn = root_run,
+            .initial = &states[P],
+            .type = SC_TYPE_ROOT,
+        },
+    [P] =
+        {
+            .name = "P",
+            .entry_fn = entry,
+            .exit_fn = exit_,
+            .parent = &states[ROOT],
+            .type = SC_TYPE_PARALLEL,
+            .transitions = transitions_p,
+        },
+    [R1] =
+        {
+            .name = "R1",
+            .entry_fn = entry,
+            .exit_fn = exit_,
+            .parent = &states[P],
+            .initial = &states[R1A],
+        },
+    [R1A] =
+        {
+            .name = "R1A",
+            .entry_fn = entry,
+            .exit_fn = exit_,
+            .parent = &states[R1],
+            .transitions = transitions_r1a,
+        },
+    [R1B] =
+        {
+            .name = "R1B",
+            .entry_fn = entry,
+            .exit_fn = exit_,
+            .parent = &states[R1],
+            .transitions = transitions_r1b,
+        },
+    [R2] =
+        {
+            .name = "R2",
+            .entry_fn = entry,
+            .exit_fn = exit_,
+            .parent = &states[P],
+            .initial = &states[R2A],
+        },
+    [R2A] =
+        {
+            .name = "R2A",
+            .entry_fn = entry,
+            .exit_fn = exit_,
+            .parent = &states[R2],
+            .transitions = transitions_r2a,
+        },
+    [R2B] =
+        {
+            .name = "R2B",
+            .entry_fn = entry,
+            .exit_fn = exit_,
+            .parent = &states[R2],
+        },
+    [P_DH] =
+        {
+            .name = "P_DH",
+            .parent = &states[P],
+            .type = SC_TYPE_HISTORY_DEEP,
+        },
+    [Q] =
+        {
+            .name = "Q",
+            .entry_fn = entry,
+            .exit_fn = exit_,
+            .parent = &states[ROOT],
+            .transitions = transitions_q,
+        },
+};
+
+static void run_and_trace(EventType event) {
+  trace[0] = '\0';
+  sc_run(&sm, event);
+}
+
+static void assert_active(size_t n, enum states const expected[n]) {
+  size_t count = 0;
+  for (size_t i = 0; i < _NUM_STATES; ++i) {
+    count += sc_is_in(&sm, &states[i]);
+  }
+  for (size_t i = 0; i < n; ++i) {
+    TEST_ASSERT_TRUE_MESSAGE(sc_is_in(&sm, &states[expected[i]]),
+                             states[expected[i]].config->name);
+  }
+  TEST_ASSERT_EQUAL(n, count);
+}
+
+void setUp(void) {
+  sc_map_stateconfig_to_states(_NUM_STATES, states, statecfgs);
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(chart_mem),
+                            sc_compile(&chart, _NUM_STATES, states, chart_mem, sizeof(chart_mem)));
+  TEST_ASSERT_LESS_OR_EQUAL(ARRAY_LEN(sm_slots), chart.machine_slots);
+  sc_machine_init(&sm, &chart, sm_slots, NULL);
+  trace[0] = '\0';
+  root_runs = 0;
+  sc_init(&sm);
+}
+
+void tearDown(void) {}
+
+/* -------- TESTS -------- */
+
+void test_init_enters_all_regions(void) {
+  TEST_ASSERT_EQUAL_STRING("+P +R1 +R1A +R2 +R2A ", trace);
+  assert_active(6, (enum states const[]){ROOT, P, R1, R1A, R2, R2A});
+}
+
+void test_event_goes_to_all_regions(void) {
+  run_and_trace(EV_BOTH);
+
+  TEST_ASSERT_EQUAL_STRING("-R1A +R1B -R2A +R2B ", trace);
+  assert_active(6, (enum states const[]){ROOT, P, R1, R1B, R2, R2B});
+  TEST_ASSERT_EQUAL(1, root_runs);
+}
+
+void test_event_in_one_region(void) {
+  run_and_trace(EV_BOTH);
+  run_and_trace(EV_BACK);
+
+  TEST_ASSERT_EQUAL_STRING("-R1B +R1A ", trace);
+  assert_active(6, (enum states const[]){ROOT, P, R1, R1A, R2, R2B});
+}
+
+void test_leave_and_restore_deep_history(void) {
+  run_and_trace(EV_BOTH);
+  run_and_trace(EV_LEAVE);
+
+  TEST_ASSERT_EQUAL_STRING("-R1B -R1 -R2B -R2 -P +Q ", trace);
+  assert_active(2, (enum states const[]){ROOT, Q});
+
+  run_and_trace(EV_RESTORE);
+
+  TEST_ASSERT_EQUAL_STRING("-Q +P +R1 +R1B +R2 +R2B ", trace);
+  assert_active(6, (enum states const[]){ROOT, P, R1, R1B, R2, R2B});
+}
+
+void test_inner_transition_blocks_outer_one(void) {
+  run_and_trace(EV_CONFLICT);
+
+  TEST_ASSERT_EQUAL_STRING("-R1A +R1B ", trace);
+  assert_active(6, (enum states const[]){ROOT, P, R1, R1B, R2, R2A});
+}
+
+void test_enter_region_from_outside(void) {
+  run_and_trace(EV_LEAVE);
+  run_and_trace(EV_INTO);
+
+  TEST_ASSERT_EQUAL_STRING("-Q +P +R1 +R1A +R2 +R2B ", trace);
+  assert_active(6, (enum states const[]){ROOT, P, R1, R1A, R2, R2B});
+}
@@ -0,0 +1,129 @@
+#include "unity.h"
+
+#include "../lib/hsm4c.h"
+#include "../lib/hsm4c_stats.h"
+#include "machine_fixture.h"
+
+/* -------- TEST FIXTURE -------- */
+
+enum states {
+  ROOT,
+  A,
+  B,
+  _NUM_STATES,
+};
+
+enum events {
+  EV_GO = 1,
+  EV_BACK,
+};
+
+
+static ChartStats stats;
+static uint64_t stats_mem[512];
+static uint64_t now;
+
+static uint64_t fake_clock(void) { return now; }
+static void slow_entry(Machine *sm, State const *s) { now += 100; }
+
+static Transition const transitions_a[] = {
+    {&states[A], &states[B], EV_GO},
+    SC_TRANSITIONS_END,
+};
+
+static Transition const transitions_b[] = {
+    {&states[B], &states[A], EV_BACK},
+    SC_TRANSITIONS_END,
+};
+
+static StateConfig const statecfgs[_NUM_STATES] = {
+    [ROOT] = {.name = "ROOT", .initial = &states[A], .type = SC_TYPE_ROOT},
+    [A] = {.name = "A", .parent = &states[ROOT], .transitions = transitions_a},
+    [B] = {.name = "B",
+           .entry_fn = slow_entry,
+           .parent = &states[ROOT],
+           .transitions = transitions_b},
+};
+
+void setUp(void) {
+  fixture_init(_NUM_STATES, statecfgs);
+  TEST_ASSERT_LESS_OR_EQUAL(
+      sizeof(stats_mem), sc_stats_attach(&chart, &stats, stats_mem, sizeof(stats_mem), fake_clock));
+  now = 0;
+  sc_init(&sm);
+}
+
+void tearDown(void) {}
+
+/* -------- TESTS -------- */
+
+void test_stats_count_transitions_entries_and_exits(void) {
+  sc_run(&sm, EV_GO);
+  sc_run(&sm, EV_BACK);
+  sc_run(&sm, EV_GO);
+
+  StateStats a;
+  sc_stats_state(&chart, &states[A], &a);
+  TEST_ASSERT_EQUAL(2, sc_stats_transition(&chart, &transitions_a[0]));
+  TEST_ASSERT_EQUAL(1, sc_stats_transition(&chart, &transitions_b[0]));
+  TEST_ASSERT_EQUAL(2, a.entries);
+  TEST_ASSERT_EQUAL(2, a.exits);
+}
+
+void test_stats_residency_includes_active_states(void) {
+  now = 50;
+  sc_run(&sm, EV_GO);
+  now = 80;
+
+  StateStats a;
+  StateStats b;
+  sc_stats_state(&chart, &states[A], &a);
+  sc_stats_state(&chart, &states[B], &b);
+  TEST_ASSERT_EQUAL(50, a.residency);
+  TEST_ASSERT_EQUAL(80 - 50, b.residency);
+}
+
+void test_stats_callback_and_run_latency(void) {
+  sc_run(&sm, EV_GO);
+
+  StateStats b;
+  StatsHistogram run;
+  sc_stats_state(&chart, &states[B], &b);
+  sc_stats_run(&chart, &run);
+  // 100 ticks are in bucket 64 .. 127
+  TEST_ASSERT_EQUAL(1, b.entry_fn.count[7]);
+  TEST_ASSERT_EQUAL(100, b.entry_fn.total);
+  TEST_ASSERT_EQUAL(1, run.count[7]);
+  TEST_ASSERT_EQUAL(127, sc_stats_quantile(&run, 0.5));
+}
+
+void test_stats_reinit_and_restore_replace_active_states(void) {
+  unsigned char snapshot[64];
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(snapshot), sc_snapshot_size(&chart));
+  now = 10;
+  sc_run(&sm, EV_GO);
+  TEST_ASSERT_EQUAL(sc_snapshot_size(&chart), sc_snapshot(&sm, snapshot, sizeof(snapshot)));
+
+  // B is left without its exit, the restore enters it again
+  now = 200;
+  sc_init(&sm);
+  now = 300;
+  TEST_ASSERT_TRUE(sc_restore(&sm, snapshot, sc_snapshot_size(&chart)));
+  now = 400;
+
+  StateStats root;
+  StateStats a;
+  StateStats b;
+  sc_stats_state(&chart, &states[ROOT], &root);
+  sc_stats_state(&chart, &states[A], &a);
+  sc_stats_state(&chart, &states[B], &b);
+  TEST_ASSERT_EQUAL(400, root.residency);
+  TEST_ASSERT_EQUAL(10 + 300 - 200, a.residency);
+  TEST_ASSERT_EQUAL(200 - 10 + 400 - 300, b.residency);
+  TEST_ASSERT_EQUAL(2, a.entries);
+  TEST_ASSERT_EQUAL(2, a.exits);
+  TEST_ASSERT_EQUAL(2, b.entries);
+  TEST_ASSERT_EQUAL(1, b.exits);
+  // Only the entry from the transition called the entry function
+  TEST_ASSERT_EQUAL(100, b.entry_fn.total);
+}
@@ -0,0 +1,119 @@
+#include "unity.h"
+
+#include <stdbool.h>
+
+#include "../lib/hsm4c.h"
+#include "machine_fixture.h"
+
+/* -------- TEST FIXTURE -------- */
+
+enum states {
+  ROOT,
+  A,
+  B,
+  C,
+  D,
+  P,
+  Q,
+  _NUM_STATES,
+};
+
+enum events {
+  EV_GO = 1,
+  EV_PING,
+};
+
+
+static bool ping;
+static int entries;
+
+static bool pinging(Machine const *sm, Event const *e) { return ping; }
+static void count_entry(Machine *sm, State const *s) { entries++; }
+
+static Transition const transitions_a[] = {
+    {&states[A], &states[B], EV_GO},
+    {&states[A], &states[P], EV_PING},
+    SC_TRANSITIONS_END,
+};
+
+static Transition const transitions_b[] = {
+    {&states[B], &states[C]},
+    SC_TRANSITIONS_END,
+};
+
+static Transition const transitions_c[] = {
+    {&states[C], &states[D]},
+    SC_TRANSITIONS_END,
+};
+
+// P and Q hand over to each other as long as ping is set
+static Transition const transitions_p[] = {
+    {&states[P], &states[Q], .guard_fn = pinging},
+    SC_TRANSITIONS_END,
+};
+
+static Transition const transitions_q[] = {
+    {&states[Q], &states[P], .guard_fn = pinging},
+    SC_TRANSITIONS_END,
+};
+
+static StateConfig const statecfgs[_NUM_STATES] = {
+    [ROOT] = {.name = "ROOT", .initial = &states[A], .type = SC_TYPE_ROOT},
+    [A] = {.name = "A", .parent = &states[ROOT], .transitions = transitions_a},
+    [B] = {.name = "B", .parent = &states[ROOT], .transitions = transitions_b},
+    [C] = {.name = "C", .parent = &states[ROOT], .transitions = transitions_c},
+    [D] = {.name = "D", .entry_fn = count_entry, .parent = &states[ROOT]},
+    [P] = {.name = "P", .parent = &states[ROOT], .transitions = transitions_p},
+    [Q] = {.name = "Q", .parent = &states[ROOT], .transitions = transitions_q},
+};
+
+static State const *leaf(void) { return &states[sm._leaf]; }
+
+void setUp(void) {
+  fixture_init(_NUM_STATES, statecfgs);
+  ping = true;
+  entries = 0;
+  sc_init(&sm);
+}
+
+void tearDown(void) {}
+
+/* -------- TESTS -------- */
+
+void test_step_takes_one_transition_at_a_time(void) {
+  TEST_ASSERT_EQUAL(SC_STEP_DONE, sc_step(&sm));
+
+  sc_begin(&sm, &(Event const){.type = EV_GO});
+  TEST_ASSERT_EQUAL_PTR(&states[A], leaf());
+  TEST_ASSERT_EQUAL(SC_STEP_PENDING, sc_step(&sm));
+  TEST_ASSERT_EQUAL_PTR(&states[B], leaf());
+  TEST_ASSERT_EQUAL(SC_STEP_PENDING, sc_step(&sm));
+  TEST_ASSERT_EQUAL_PTR(&states[C], leaf());
+  TEST_ASSERT_EQUAL(SC_STEP_PENDING, sc_step(&sm));
+  TEST_ASSERT_EQUAL_PTR(&states[D], leaf());
+  TEST_ASSERT_EQUAL(1, entries);
+  TEST_ASSERT_EQUAL(SC_STEP_DONE, sc_step(&sm));
+  TEST_ASSERT_EQUAL(SC_STEP_DONE, sc_step(&sm));
+  TEST_ASSERT_EQUAL_PTR(&states[D], leaf());
+}
+
+void test_run_budget_resumes(void) {
+  sc_begin(&sm, &(Event const){.type = EV_GO});
+  TEST_ASSERT_EQUAL(SC_STEP_PENDING, sc_run_budget(&sm, 2, 0));
+  TEST_ASSERT_EQUAL_PTR(&states[C], leaf());
+  TEST_ASSERT_EQUAL(SC_STEP_PENDING, sc_run_budget(&sm, 0, 0));
+
+  TEST_ASSERT_EQUAL(SC_STEP_DONE, sc_run_budget(&sm, 100, 1000000000u));
+  TEST_ASSERT_EQUAL_PTR(&states[D], leaf());
+  TEST_ASSERT_EQUAL(SC_STEP_DONE, sc_run_budget(&sm, 100, 0));
+}
+
+void test_run_budget_reports_cycles(void) {
+  sc_begin(&sm, &(Event const){.type = EV_PING});
+  TEST_ASSERT_EQUAL(SC_STEP_CYCLE, sc_run_budget(&sm, 100, 0));
+  TEST_ASSERT_TRUE(sc_is_in(&sm, &states[P]) || sc_is_in(&sm, &states[Q]));
+
+  // The cycle only depended on the guard
+  ping = false;
+  TEST_ASSERT_EQUAL(SC_STEP_DONE, sc_run_budget(&sm, 100, 0));
+}
@@ -0,0 +1,217 @@
+#include "unity.h"
+
+#include <stdbool.h>
+
+#include "../lib/hsm4c.h"
+#include "../lib/hsm4c_timer.h"
+
+#define ARRAY_LEN(a) (sizeof(a) / sizeof(*a))
+#define NUM_MACHINES 1000
+
+/* -------- TEST FIXTURE -------- */
+
+enum states {
+  ROOT,
+  A,
+  B,
+  C,
+  _NUM_STATES,
+};
+
+enum events {
+  EV_GO = 1,
+  EV_RESTART,
+};
+
+static State states[_NUM_STATES];
+static Chart chart;
+static uint64_t chart_mem[64];
+static TimerWheel wheel;
+static Machine sm;
+static StateId sm_slots[8];
+static Timer sm_timers[4];
+static bool allow;
+
+static Machine machines[NUM_MACHINES];
+static StateId machine_slots[NUM_MACHINES][8];
+static Timer machine_timers[NUM_MACHINES][4];
+static uint64_t entered_b[NUM_MACHINES];
+
+static bool guard(Machine const *sm, Event const *e) { return allow; }
+
+static int runs;
+static int timeouts_run;
+
+static State const *root_run(Machine *sm, State const *s, Event const *e) {
+  runs++;
+  timeouts_run += e->type == SC_TIMEOUT;
+  return NULL;
+}
+
+/** \brief Records when a machine of the set first entered B. */
+static void b_entry(Machine *sm, State const *s) {
+  uint64_t *const entered = sm->ctx;
+  if (entered && !*entered) {
+    *entered = sc_wheel_now(&wheel);
+  }
+}
+
+static Transition const transitions_a[] = {
+    {&states[A], &states[B], .after = 500},
+    {&states[A], &states[C], EV_GO},
+    SC_TRANSITIONS_END,
+};
+
+static Transition const transitions_b[] = {
+    {&states[B], &states[A], .guard_fn = guard, .after = 1000},
+    {&states[B], &states[B], EV_RESTART},
+    SC_TRANSITIONS_END,
+};
+
+static Transition const transitions_c[] = {
+    {&states[C], &states[A], EV_GO},
+    {&states[C], &states[A], .after = 3000000},
+    SC_TRANSITIONS_END,
+};
+
+static StateConfig const statecfgs[_NUM_STATES] = {
+    [ROOT] = {.name = "ROOT",
+              .run_fn = root_run,
+              .initial = &states[A],
+              .type = SC_TYPE_ROOT},
+    [A] = {.name = "A", .parent = &states[ROOT], .transitions = transitions_a},
+    [B] = {.name = "B",
+           .entry_fn = b_entry,
+           .parent = &states[ROOT],
+           .transitions = transitions_b},
+    [C] = {.name = "C", .parent = &states[ROOT], .transitions = transitions_c},
+};
+
+static void start(Machine *m, StateId slots[], Timer timers[], void *ctx) {
+  sc_machine_init(m, &chart, slots, ctx);
+  sc_machine_timers(m, &wheel, timers);
+  sc_init(m);
+}
+
+void setUp(void) {
+  sc_map_stateconfig_to_states(_NUM_STATES, states, statecfgs);
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(chart_mem),
+                            sc_compile(&chart, _NUM_STATES, states, chart_mem, sizeof(chart_mem)));
+  TEST_ASSERT_LESS_OR_EQUAL(ARRAY_LEN(sm_slots), chart.machine_slots);
+  TEST_ASSERT_EQUAL(3, chart.num_timers);
+  allow = true;
+  runs = 0;
+  timeouts_run = 0;
+  sc_wheel_init(&wheel, 0);
+  start(&sm, sm_slots, sm_timers, NULL);
+}
+
+void tearDown(void) {}
+
+/* -------- TESTS -------- */
+
+void test_timer_fires_after_ticks(void) {
+  TEST_ASSERT_EQUAL_UINT64(500, sc_next_deadline(&wheel));
+  TEST_ASSERT_EQUAL(0, sc_wheel_advance(&wheel, 499));
+  TEST_ASSERT_EQUAL_PTR(&states[A], &states[sm._leaf]);
+
+  TEST_ASSERT_EQUAL(1, sc_wheel_advance(&wheel, 500));
+  TEST_ASSERT_EQUAL_PTR(&states[B], &states[sm._leaf]);
+  TEST_ASSERT_EQUAL_UINT64(1500, sc_next_deadline(&wheel));
+
+  // A timed transition is never taken as an automatic one
+  TEST_ASSERT_EQUAL_PTR(&states[B], sc_run(&sm, SC_NO_EVENT));
+}
+
+void test_exit_cancels_and_entry_restarts_timers(void) {
+  sc_wheel_advance(&wheel, 200);
+  TEST_ASSERT_EQUAL_PTR(&states[C], sc_run(&sm, EV_GO));
+  TEST_ASSERT_EQUAL_UINT64(200 + 3000000, sc_next_deadline(&wheel));
+
+  TEST_ASSERT_EQUAL(0, sc_wheel_advance(&wheel, 10000));
+  TEST_ASSERT_EQUAL_PTR(&states[A], sc_run(&sm, EV_GO));
+  TEST_ASSERT_EQUAL_UINT64(10500, sc_next_deadline(&wheel));
+
+  // External self transition exits and enters again
+  sc_wheel_advance(&wheel, 10500);
+  sc_wheel_advance(&wheel, 10700);
+  TEST_ASSERT_EQUAL_PTR(&states[B], sc_run(&sm, EV_RESTART));
+  TEST_ASSERT_EQUAL_UINT64(11700, sc_next_deadline(&wheel));
+}
+
+void test_guard_blocks_timed_transition(void) {
+  allow = false;
+  sc_wheel_advance(&wheel, 500);
+  TEST_ASSERT_EQUAL(1, sc_wheel_advance(&wheel, 5000));
+  TEST_ASSERT_EQUAL_PTR(&states[B], &states[sm._leaf]);
+  TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, sc_next_deadline(&wheel));
+
+  allow = true;
+  sc_run(&sm, EV_RESTART);
+  TEST_ASSERT_EQUAL(1, sc_wheel_advance(&wheel, 6000));
+  TEST_ASSERT_EQUAL_PTR(&states[A], &states[sm._leaf]);
+}
+
+void test_timeouts_do_not_reach_run_functions(void) {
+  allow = false;
+  // Fires A -> B, then the blocked B -> A
+  TEST_ASSERT_EQUAL(1, sc_wheel_advance(&wheel, 500));
+  TEST_ASSERT_EQUAL(1, sc_wheel_advance(&wheel, 1500));
+  TEST_ASSERT_EQUAL_PTR(&states[B], &states[sm._leaf]);
+  TEST_ASSERT_EQUAL(0, timeouts_run);
+  TEST_ASSERT_EQUAL(0, runs);
+
+  sc_run(&sm, SC_NO_EVENT);
+  TEST_ASSERT_EQUAL(1, runs);
+}
+
+void test_many_machines_fire_at_their_deadlines(void) {
+  // Start right below the range of the top level, deadlines cross it
+  uint64_t const base = (UINT64_C(1) << 36) - 100000;
+  uint64_t expected[NUM_MACHINES];
+  sc_wheel_init(&wheel, base);
+  for (size_t i = 0; i < NUM_MACHINES; ++i) {
+    sc_wheel_advance(&wheel, base + i * 97);
+    entered_b[i] = 0;
+    start(&machines[i], machine_slots[i], machine_timers[i], &entered_b[i]);
+    expected[i] = base + i * 97 + 500;
+    if (i % 3 == 0) {
+      sc_run(&machines[i], EV_GO);
+      expected[i] += 3000000;
+    }
+  }
+
+  // Tickless: Sleep until the next deadline, every wakeup fires something
+  uint64_t const end = base + 4000000;
+  uint64_t last = sc_wheel_now(&wheel);
+  for (uint64_t next = sc_next_deadline(&wheel); next <= end; next = sc_next_deadline(&wheel)) {
+    TEST_ASSERT_TRUE(next > last);
+    TEST_ASSERT_GREATER_THAN(0, sc_wheel_advance(&wheel, next));
+    last = next;
+  }
+
+  for (size_t i = 0; i < NUM_MACHINES; ++i) {
+    TEST_ASSERT_EQUAL_UINT64(expected[i], entered_b[i]);
+  }
+}
+
+void test_snapshot_keeps_remaining_ticks(void) {
+  Machine restored;
+  StateId restored_slots[8];
+  Timer restored_timers[4];
+  unsigned char blob[64];
+
+  sc_wheel_advance(&wheel, 200);
+  size_t const size = sc_snapshot(&sm, blob, sizeof(blob));
+  TEST_ASSERT_EQUAL(sc_snapshot_size(&chart), size);
+
+  // Restore on a wheel of another process, at a different time
+  sc_wheel_init(&wheel, 7000);
+  sc_machine_init(&restored, &chart, restored_slots, NULL);
+  sc_machine_timers(&restored, &wheel, restored_timers);
+  TEST_ASSERT_TRUE(sc_restore(&restored, blob, size));
+  TEST_ASSERT_EQUAL_UINT64(7300, sc_next_deadline(&wheel));
+
+  TEST_ASSERT_EQUAL(1, sc_wheel_advance(&wheel, 7300));
+  TEST_ASSERT_EQUAL_PTR(&states[B], &states[restored._leaf]);
+}
@@ -0,0 +1,106 @@
+#include "unity.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "../lib/hsm4c.h"
+#include "../lib/hsm4c_trace.h"
+#include "machine_fixture.h"
+
+/* -------- TEST FIXTURE -------- */
+
+enum states {
+  ROOT,
+  A,
+  B,
+  _NUM_STATES,
+};
+
+enum events {
+  EV_GO = 1,
+};
+
+
+static TraceBuffer trace;
+static TraceRecord records[16];
+static TraceRecord dump[16];
+static bool allow;
+
+static bool guard(Machine const *sm, Event const *e) { return allow; }
+
+static Transition const transitions_a[] = {
+    {&states[A], &states[B], EV_GO, .guard_fn = guard},
+    SC_TRANSITIONS_END,
+};
+
+static StateConfig const statecfgs[_NUM_STATES] = {
+    [ROOT] = {.name = "ROOT", .initial = &states[A], .type = SC_TYPE_ROOT},
+    [A] = {.name = "A", .parent = &states[ROOT], .transitions = transitions_a},
+    [B] = {.name = "B", .parent = &states[ROOT]},
+};
+
+static void assert_record(TraceRecord const *r, TraceKind kind, StateId from, StateId to) {
+  TEST_ASSERT_EQUAL(kind, r->kind);
+  TEST_ASSERT_EQUAL(from, r->from);
+  TEST_ASSERT_EQUAL(to, r->to);
+  TEST_ASSERT_EQUAL_PTR(&sm, r->machine);
+}
+
+void setUp(void) {
+  fixture_init(_NUM_STATES, statecfgs);
+  sc_init(&sm);
+  allow = false;
+  sc_trace_attach(&trace, records, ARRAY_LEN(records), NULL);
+}
+
+void tearDown(void) { sc_trace_attach(NULL, NULL, 0, NULL); }
+
+/* -------- TESTS -------- */
+
+void test_trace_records_guards_and_transition(void) {
+  sc_run(&sm, EV_GO);
+  allow = true;
+  sc_run(&sm, EV_GO);
+
+  size_t const n = sc_trace_dump(&trace, dump, ARRAY_LEN(dump));
+  TEST_ASSERT_EQUAL(7, n);
+  assert_record(&dump[0], SC_TRACE_EVENT, A, SC_NO_STATE);
+  assert_record(&dump[1], SC_TRACE_GUARD, A, B);
+  TEST_ASSERT_FALSE(dump[1].result);
+  assert_record(&dump[2], SC_TRACE_EVENT, A, SC_NO_STATE);
+  assert_record(&dump[3], SC_TRACE_GUARD, A, B);
+  TEST_ASSERT_TRUE(dump[3].result);
+  assert_record(&dump[4], SC_TRACE_TRANSITION, A, B);
+  assert_record(&dump[5], SC_TRACE_EXIT, A, SC_NO_STATE);
+  assert_record(&dump[6], SC_TRACE_ENTRY, B, SC_NO_STATE);
+  for (size_t i = 0; i < n; ++i) {
+    TEST_ASSERT_EQUAL(EV_GO, dump[i].event);
+    TEST_ASSERT_EQUAL(i, dump[i].timestamp);
+  }
+}
+
+void test_trace_decode_uses_state_names(void) {
+  allow = true;
+  sc_run(&sm, EV_GO);
+
+  char text[128];
+  size_t const n = sc_trace_dump(&trace, dump, ARRAY_LEN(dump));
+  TEST_ASSERT_EQUAL(5, n);
+  sc_trace_decode(&chart, &dump[1], text, sizeof(text));
+  TEST_ASSERT_NOT_NULL(strstr(text, "guard 1: A -> B = true"));
+  sc_trace_decode(&chart, &dump[4], text, sizeof(text));
+  TEST_ASSERT_NOT_NULL(strstr(text, "entry 1: B"));
+}
+
+void test_trace_keeps_newest_records(void) {
+  allow = true;
+  for (int i = 0; i < 10; ++i) {
+    sc_run(&sm, EV_GO);
+  }
+
+  TEST_ASSERT_EQUAL(5 + 9, trace.written);
+  size_t const n = sc_trace_dump(&trace, dump, 4);
+  TEST_ASSERT_EQUAL(4, n);
+  TEST_ASSERT_EQUAL(trace.written - 1, dump[3].timestamp);
+  TEST_ASSERT_EQUAL(trace.written - 4, dump[0].timestamp);
+}